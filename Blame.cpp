@@ -0,0 +1,126 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Blame.h"
+#include "Trace.h"
+
+static const char ENTRY_MAGIC[4] = {'M', 'G', 'B', 'L'};
+static const std::uint32_t ENTRY_VERSION = 1;
+
+static void write_be32(std::ofstream& stream, std::uint32_t value)
+{
+    const char bytes[4] = {char(value >> 24), char(value >> 16), char(value >> 8), char(value)};
+    stream.write(bytes, sizeof(bytes));
+}
+
+static bool read_be32(std::ifstream& stream, std::uint32_t& value)
+{
+    unsigned char bytes[4];
+    if(!stream.read(reinterpret_cast<char*>(bytes), sizeof(bytes)))
+    {
+        return false;
+    }
+    value = (std::uint32_t(bytes[0]) << 24) | (std::uint32_t(bytes[1]) << 16) | (std::uint32_t(bytes[2]) << 8) | bytes[3];
+    return true;
+}
+
+BlameCache::BlameCache(const std::filesystem::path& cache_path) : cache_path(cache_path)
+{
+}
+
+std::filesystem::path BlameCache::entry_path(const ObjectId& blob_id, const ObjectId& commit_id) const
+{
+    return cache_path / (blob_id.to_hex() + "-" + commit_id.to_hex());
+}
+
+bool BlameCache::load(const ObjectId& blob_id, const ObjectId& commit_id, std::vector<ObjectId>& origins) const
+// Reads the line origins of the entry. Returns false if there is no complete entry.
+{
+    TraceSpan span("load_blame_cache");
+
+    std::ifstream entry(entry_path(blob_id, commit_id), std::ios::binary);
+    char magic[sizeof(ENTRY_MAGIC)];
+    std::uint32_t version = 0;
+    std::uint32_t line_count = 0;
+    if(!entry.read(magic, sizeof(magic)) || std::memcmp(magic, ENTRY_MAGIC, sizeof(magic)) != 0 ||
+        !read_be32(entry, version) || version != ENTRY_VERSION || !read_be32(entry, line_count))
+    {
+        return false;
+    }
+
+    origins.clear();
+    origins.reserve(line_count);
+    unsigned char id[ObjectId::MAX_SIZE];
+    std::uint32_t length = 0;
+    while(origins.size() < line_count && entry.read(reinterpret_cast<char*>(id), commit_id.size()) && read_be32(entry, length))
+    {
+        if(length > line_count - origins.size())
+        {
+            return false;
+        }
+        origins.insert(origins.end(), length, ObjectId::from_bytes(id, commit_id.size()));
+    }
+    return origins.size() == line_count;
+}
+
+void BlameCache::store(const ObjectId& blob_id, const ObjectId& commit_id, const std::vector<ObjectId>& origins) const
+// Writes the entry under a temporary name and renames it, so readers never see a partial entry.
+{
+    TraceSpan span("store_blame_cache");
+
+    std::error_code error;
+    std::filesystem::create_directories(cache_path, error);
+
+    std::filesystem::path path = entry_path(blob_id, commit_id);
+    std::filesystem::path temporary_path = path.string() + ".tmp";
+    {
+        std::ofstream entry(temporary_path, std::ios::binary | std::ios::trunc);
+        entry.write(ENTRY_MAGIC, sizeof(ENTRY_MAGIC));
+        write_be32(entry, ENTRY_VERSION);
+        write_be32(entry, static_cast<std::uint32_t>(origins.size()));
+        for(std::size_t i = 0; i < origins.size(); )
+        {
+            std::size_t run_end = i + 1;
+            while(run_end < origins.size() && origins[run_end] == origins[i])
+            {
+                run_end++;
+            }
+            entry.write(reinterpret_cast<const char*>(origins[i].data()), commit_id.size());
+            write_be32(entry, static_cast<std::uint32_t>(run_end - i));
+            i = run_end;
+        }
+    }
+    std::filesystem::rename(temporary_path, path, error);
+    if(error)
+    {
+        std::filesystem::remove(temporary_path, error);
+    }
+}
+
+void BlameCache::remove_if(const std::function<bool(const ObjectId& blob_id, const ObjectId& commit_id)>& stale) const
+// Deletes the entries for which stale returns true, and any file that is not an entry.
+{
+    std::error_code error;
+    if(!std::filesystem::exists(cache_path, error))
+    {
+        return;
+    }
+
+    for(auto const& dir_entry : std::filesystem::directory_iterator {cache_path})
+    {
+        std::string name = dir_entry.path().filename().string();
+        ObjectId blob_id;
+        ObjectId commit_id;
+        std::size_t hex_size = name.size() / 2;
+        bool is_entry = name.size() % 2 == 1 && name[hex_size] == '-' &&
+            ObjectId::from_hex(name.substr(0, hex_size), blob_id) &&
+            ObjectId::from_hex(name.substr(hex_size + 1), commit_id);
+        if(!is_entry || stale(blob_id, commit_id))
+        {
+            std::filesystem::remove(dir_entry.path(), error);
+        }
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef _BLAME_H_
+#define _BLAME_H_
+
+#include <filesystem>
+#include <functional>
+#include <vector>
+
+#include "ObjectId.h"
+
+class BlameCache
+// Computed blame results. An entry is keyed by one version of a file: its blob id and the commit that introduced
+// that blob on the first-parent line. It holds the commit each line of the version originates from, so blaming a
+// newer commit only diffs the versions written after the newest cached one.
+// Entries never change once written, so a damaged or unreadable entry is treated as missing.
+//
+// One file per entry, <cache>/<blob id>-<commit id>. File layout (integers big-endian): "MGBL", version,
+// line count, runs {commit id[id size], length} of consecutive lines with the same origin. The id size is that
+// of the commit id in the entry's name.
+{
+    public:
+        explicit BlameCache(const std::filesystem::path& cache_path);
+
+        bool load(const ObjectId& blob_id, const ObjectId& commit_id, std::vector<ObjectId>& origins) const;
+        void store(const ObjectId& blob_id, const ObjectId& commit_id, const std::vector<ObjectId>& origins) const;
+        void remove_if(const std::function<bool(const ObjectId& blob_id, const ObjectId& commit_id)>& stale) const;
+
+    private:
+        std::filesystem::path entry_path(const ObjectId& blob_id, const ObjectId& commit_id) const;
+
+        std::filesystem::path cache_path;
+};
+
+#endif
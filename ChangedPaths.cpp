@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <vector>
+
+#include "ChangedPaths.h"
+#include "Trace.h"
+
+static const char INDEX_MAGIC[4] = {'M', 'G', 'C', 'P'};
+static const std::uint32_t INDEX_VERSION = 1;
+static const std::uint32_t TOO_LARGE = 0xffffffff;
+static const std::uint32_t HASH_SEED_1 = 0x293ae76f;
+static const std::uint32_t HASH_SEED_2 = 0x7e646e2c;
+
+const std::size_t BloomFilter::BITS_PER_PATH;
+const std::size_t BloomFilter::MAX_PATHS;
+const std::size_t BloomFilter::MAX_SIZE;
+
+static std::uint32_t rotate_left(std::uint32_t value, int count)
+{
+    return (value << count) | (value >> (32 - count));
+}
+
+static std::uint32_t murmur3(std::uint32_t seed, std::string_view data)
+// 32-bit murmur3 (x86 variant), reading the blocks byte by byte so the result does not depend on endianness.
+{
+    const std::uint32_t c1 = 0xcc9e2d51;
+    const std::uint32_t c2 = 0x1b873593;
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data.data());
+    std::size_t block_count = data.size() / 4;
+    std::uint32_t hash = seed;
+
+    for(std::size_t i = 0; i < block_count; i++)
+    {
+        const unsigned char* block = bytes + 4 * i;
+        std::uint32_t k = block[0] | (block[1] << 8) | (block[2] << 16) | (std::uint32_t(block[3]) << 24);
+        k = rotate_left(k * c1, 15) * c2;
+        hash = rotate_left(hash ^ k, 13) * 5 + 0xe6546b64;
+    }
+
+    const unsigned char* tail = bytes + 4 * block_count;
+    std::uint32_t k = 0;
+    switch(data.size() & 3)
+    {
+        case 3:
+            k ^= tail[2] << 16;
+            [[fallthrough]];
+        case 2:
+            k ^= tail[1] << 8;
+            [[fallthrough]];
+        case 1:
+            k ^= tail[0];
+            hash ^= rotate_left(k * c1, 15) * c2;
+    }
+
+    hash ^= static_cast<std::uint32_t>(data.size());
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+BloomFilter::BloomFilter(const std::vector<std::string_view>& paths)
+{
+    if(paths.size() > MAX_PATHS)
+    {
+        too_large = true;
+        return;
+    }
+
+    bits.assign(std::max<std::size_t>(1, (paths.size() * BITS_PER_PATH + 7) / 8), 0);
+    std::uint64_t bit_count = bits.size() * 8;
+    for(auto const& path : paths)
+    {
+        std::uint32_t hash_1 = murmur3(HASH_SEED_1, path);
+        std::uint32_t hash_2 = murmur3(HASH_SEED_2, path);
+        for(int i = 0; i < HASH_COUNT; i++)
+        {
+            std::uint64_t bit = (hash_1 + std::uint64_t(i) * hash_2) % bit_count;
+            bits[bit / 8] |= 1 << (bit % 8);
+        }
+    }
+}
+
+bool BloomFilter::might_contain(std::string_view path) const
+{
+    if(too_large || bits.empty())
+    {
+        return true;
+    }
+
+    std::uint64_t bit_count = bits.size() * 8;
+    std::uint32_t hash_1 = murmur3(HASH_SEED_1, path);
+    std::uint32_t hash_2 = murmur3(HASH_SEED_2, path);
+    for(int i = 0; i < HASH_COUNT; i++)
+    {
+        std::uint64_t bit = (hash_1 + std::uint64_t(i) * hash_2) % bit_count;
+        if((bits[bit / 8] & (1 << (bit % 8))) == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void write_be32(std::ofstream& stream, std::uint32_t value)
+{
+    const char bytes[4] = {char(value >> 24), char(value >> 16), char(value >> 8), char(value)};
+    stream.write(bytes, sizeof(bytes));
+}
+
+static bool read_be32(std::ifstream& stream, std::uint32_t& value)
+{
+    unsigned char bytes[4];
+    if(!stream.read(reinterpret_cast<char*>(bytes), sizeof(bytes)))
+    {
+        return false;
+    }
+    value = (std::uint32_t(bytes[0]) << 24) | (std::uint32_t(bytes[1]) << 16) | (std::uint32_t(bytes[2]) << 8) | bytes[3];
+    return true;
+}
+
+static bool read_record_header(std::ifstream& stream, std::size_t id_size, unsigned char* id, std::uint32_t& size)
+// Reads the commit id and filter size of the next record. Returns false at the end of the file or at a size no
+// filter can have, as a record cut short by an interrupted add leaves the following ones misaligned.
+{
+    return stream.read(reinterpret_cast<char*>(id), id_size) && read_be32(stream, size) &&
+        (size == TOO_LARGE || (size > 0 && size <= BloomFilter::MAX_SIZE));
+}
+
+static bool read_file_header(std::ifstream& stream)
+{
+    char magic[sizeof(INDEX_MAGIC)];
+    std::uint32_t version = 0;
+    return stream.read(magic, sizeof(magic)) && std::memcmp(magic, INDEX_MAGIC, sizeof(magic)) == 0 &&
+        read_be32(stream, version) && version == INDEX_VERSION;
+}
+
+ChangedPathIndex::ChangedPathIndex(const std::filesystem::path& index_path, std::size_t id_size) :
+    index_path(index_path), id_size(id_size)
+{
+}
+
+bool ChangedPathIndex::find_end(std::uintmax_t& end) const
+// Sets end to the size of the file up to its last complete record (0 if there is no file yet).
+// Returns false if the file has an unknown header.
+{
+    end = 0;
+    std::error_code error;
+    std::uintmax_t file_size = std::filesystem::file_size(index_path, error);
+    if(error || file_size == 0)
+    {
+        return true;
+    }
+
+    std::ifstream index(index_path, std::ios::binary);
+    if(!read_file_header(index))
+    {
+        return false;
+    }
+
+    end = sizeof(INDEX_MAGIC) + 4;
+    unsigned char id[ObjectId::MAX_SIZE];
+    std::uint32_t size = 0;
+    while(read_record_header(index, id_size, id, size))
+    {
+        std::uintmax_t record_end = end + id_size + 4 + (size == TOO_LARGE ? 0 : size);
+        if(record_end > file_size)
+        {
+            break;
+        }
+        end = record_end;
+        index.ignore(size == TOO_LARGE ? 0 : size);
+    }
+    return true;
+}
+
+void ChangedPathIndex::add(const ObjectId& commit_id, const std::vector<std::string_view>& changed_paths)
+// Appends the filter of a commit, writing the file header first if the file is new. A truncated or damaged tail
+// left by an interrupted add is cut off first; a file with an unknown header is left alone.
+{
+    BloomFilter filter(changed_paths);
+
+    std::uintmax_t end = 0;
+    if(!find_end(end))
+    {
+        return;
+    }
+    std::error_code error;
+    if(end > 0 && std::filesystem::file_size(index_path, error) != end && !error)
+    {
+        std::filesystem::resize_file(index_path, end);
+    }
+
+    std::ofstream index(index_path, std::ios::binary | std::ios::app);
+    if(end == 0)
+    {
+        index.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+        write_be32(index, INDEX_VERSION);
+    }
+    index.write(reinterpret_cast<const char*>(commit_id.data()), id_size);
+    write_be32(index, filter.too_large ? TOO_LARGE : static_cast<std::uint32_t>(filter.bits.size()));
+    index.write(reinterpret_cast<const char*>(filter.bits.data()), filter.bits.size());
+
+    if(loaded)
+    {
+        filters[commit_id] = std::move(filter);
+    }
+}
+
+PathFilterMatch ChangedPathIndex::lookup(const ObjectId& commit_id, std::string_view path)
+{
+    load();
+
+    auto search = filters.find(commit_id);
+    if(search == filters.end())
+    {
+        return PathFilterMatch::Unknown;
+    }
+    return search->second.might_contain(path) ? PathFilterMatch::Maybe : PathFilterMatch::No;
+}
+
+void ChangedPathIndex::load()
+// Reads all filters with one sequential pass over the file, up to a truncated or damaged record.
+// A file with an unknown header is ignored.
+{
+    if(loaded)
+    {
+        return;
+    }
+    loaded = true;
+
+    TraceSpan span("load_changed_paths");
+
+    std::ifstream index(index_path, std::ios::binary);
+    if(!read_file_header(index))
+    {
+        return;
+    }
+
+    unsigned char id[ObjectId::MAX_SIZE];
+    std::uint32_t size = 0;
+    while(read_record_header(index, id_size, id, size))
+    {
+        BloomFilter filter;
+        if(size == TOO_LARGE)
+        {
+            filter.too_large = true;
+        }
+        else
+        {
+            filter.bits.resize(size);
+            if(!index.read(reinterpret_cast<char*>(filter.bits.data()), size))
+            {
+                break;
+            }
+        }
+        filters[ObjectId::from_bytes(id, id_size)] = std::move(filter);
+    }
+
+    if(span.enabled())
+    {
+        span.add_counter(TRACE_BYTES_READ, std::filesystem::file_size(index_path));
+    }
+}
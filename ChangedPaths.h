@@ -0,0 +1,70 @@
+#ifndef _CHANGED_PATHS_H_
+#define _CHANGED_PATHS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "ObjectId.h"
+
+enum class PathFilterMatch
+{
+    Unknown, // no filter recorded for the commit
+    No,      // the commit certainly did not change the path
+    Maybe    // the commit may have changed the path (about 1% false positives)
+};
+
+class BloomFilter
+// Bloom filter over the paths a commit changed, sized at BITS_PER_PATH bits per path with HASH_COUNT probes.
+// Probe positions come from two seeded 32-bit murmur3 hashes of the path (double hashing), so filters written by
+// one build are read correctly by any other. A commit changing more than MAX_PATHS paths gets no bits and matches
+// every path.
+{
+    public:
+        BloomFilter() = default;
+        explicit BloomFilter(const std::vector<std::string_view>& paths);
+
+        bool might_contain(std::string_view path) const;
+
+        static const std::size_t BITS_PER_PATH = 10;
+        static const int HASH_COUNT = 7;
+        static const std::size_t MAX_PATHS = 512;
+        static const std::size_t MAX_SIZE = (MAX_PATHS * BITS_PER_PATH + 7) / 8; // bytes of bits
+
+    private:
+        friend class ChangedPathIndex;
+
+        std::vector<unsigned char> bits;
+        bool too_large = false;
+};
+
+class ChangedPathIndex
+// Side file holding one BloomFilter per commit over the paths that differ from the commit's first parent,
+// so a path-limited log only has to load the commits whose filter matches.
+// Records are appended when commits are written; commits without a record (e.g. fetched ones) are filtered
+// by the caller and can be added later. Reading stops at a truncated or damaged record, and the next add cuts the file
+// back to the last complete one before appending.
+//
+// File layout (integers big-endian): "MGCP", version, records {commit id[id size], size, bits[size]},
+// where size 0xffffffff marks a commit with too many changed paths.
+{
+    public:
+        ChangedPathIndex(const std::filesystem::path& index_path, std::size_t id_size);
+
+        void add(const ObjectId& commit_id, const std::vector<std::string_view>& changed_paths);
+        PathFilterMatch lookup(const ObjectId& commit_id, std::string_view path);
+
+    private:
+        void load();
+        bool find_end(std::uintmax_t& end) const;
+
+        std::filesystem::path index_path;
+        std::size_t id_size;
+        bool loaded = false;
+        std::unordered_map<ObjectId, BloomFilter> filters;
+};
+
+#endif
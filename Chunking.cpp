@@ -0,0 +1,229 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Chunking.h"
+#include "Trace.h"
+
+static const char LIST_MAGIC[4] = {'M', 'G', 'C', 'L'};
+static const std::uint32_t LIST_VERSION = 1;
+static const std::size_t LIST_HEADER_SIZE = sizeof(LIST_MAGIC) + 4 + 8 + 4;
+static const std::size_t LIST_ENTRY_MAX_SIZE = ObjectId::MAX_SIZE + 4;
+
+// Cut when the hash has these top bits clear: 2 bits more than the average size calls for before the
+// average, 2 bits fewer after it (FastCDC's normalized chunking), so chunk sizes cluster around the average
+static const std::uint64_t MASK_SMALL = ~std::uint64_t(0) << (64 - 18);
+static const std::uint64_t MASK_LARGE = ~std::uint64_t(0) << (64 - 14);
+
+static const std::uint64_t* gear_table()
+// 256 fixed pseudo-random values (splitmix64 from a constant seed), the same in every build.
+{
+    static const std::vector<std::uint64_t> table = []
+    {
+        std::vector<std::uint64_t> values(256);
+        std::uint64_t state = 0x4d696e6947697421;
+        for(auto& value : values)
+        {
+            state += 0x9e3779b97f4a7c15;
+            std::uint64_t z = state;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+            value = z ^ (z >> 31);
+        }
+        return values;
+    }();
+    return table.data();
+}
+
+static void put_be(unsigned char* bytes, std::uint64_t value, int size)
+{
+    for(int i = size - 1; i >= 0; i--)
+    {
+        bytes[i] = static_cast<unsigned char>(value);
+        value >>= 8;
+    }
+}
+
+static std::uint64_t get_be(const unsigned char* bytes, int size)
+{
+    std::uint64_t value = 0;
+    for(int i = 0; i < size; i++)
+    {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+std::size_t find_chunk_end(const unsigned char* data, std::size_t size)
+// Length of the chunk starting at data, at most size. The first MIN_CHUNK_SIZE bytes are never hashed,
+// as no cut may fall there.
+{
+    if(size <= MIN_CHUNK_SIZE)
+    {
+        return size;
+    }
+
+    const std::uint64_t* gear = gear_table();
+    std::size_t normal_end = std::min(size, AVERAGE_CHUNK_SIZE);
+    std::size_t end = std::min(size, MAX_CHUNK_SIZE);
+    std::uint64_t hash = 0;
+    std::size_t i = MIN_CHUNK_SIZE;
+    for(; i < normal_end; i++)
+    {
+        hash = (hash << 1) + gear[data[i]];
+        if((hash & MASK_SMALL) == 0)
+        {
+            return i + 1;
+        }
+    }
+    for(; i < end; i++)
+    {
+        hash = (hash << 1) + gear[data[i]];
+        if((hash & MASK_LARGE) == 0)
+        {
+            return i + 1;
+        }
+    }
+    return end;
+}
+
+std::uint64_t write_chunked_blob(const std::filesystem::path& source, const std::filesystem::path& list_path,
+    const ObjectStore& store, const ObjectHasher& hasher)
+// Stores the chunks of source that the store does not hold yet, then writes the chunk list to list_path with the
+// last write time of source. The file is streamed through a buffer of a few chunks. Returns the bytes written.
+{
+    TraceSpan span("write_chunked_blob");
+
+    std::ifstream file(source, std::ios::binary);
+    std::vector<unsigned char> buffer(4 * MAX_CHUNK_SIZE);
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    bool at_end = false;
+    std::uint64_t file_size = 0;
+    std::uint64_t written = 0;
+    std::vector<ChunkRef> chunks;
+
+    std::filesystem::create_directories(store.local_path(ObjectType::Chunk, ObjectId()).parent_path());
+    std::filesystem::create_directories(list_path.parent_path());
+    while(true)
+    {
+        // Keep at least one maximal chunk buffered, so every cut sees the same bytes as it would in a whole file
+        if(!at_end && end - begin < MAX_CHUNK_SIZE)
+        {
+            std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+            end -= begin;
+            begin = 0;
+            file.read(reinterpret_cast<char*>(buffer.data() + end), buffer.size() - end);
+            end += static_cast<std::size_t>(file.gcount());
+            at_end = !file;
+        }
+        if(begin == end)
+        {
+            break;
+        }
+
+        std::size_t size = find_chunk_end(buffer.data() + begin, end - begin);
+        std::string_view data(reinterpret_cast<const char*>(buffer.data() + begin), size);
+        ChunkRef chunk {hasher.hash(data), static_cast<std::uint32_t>(size)};
+        if(!store.contains(ObjectType::Chunk, chunk.id))
+        {
+            std::filesystem::path chunk_path = store.local_path(ObjectType::Chunk, chunk.id);
+            // Named after the blob too, as another file being added at the same time may hold the same chunk
+            std::filesystem::path temporary_path = chunk_path.string() + "." + list_path.filename().string() + ".tmp";
+            std::ofstream(temporary_path, std::ios::binary | std::ios::trunc)
+                .write(reinterpret_cast<const char*>(buffer.data() + begin), size);
+            std::filesystem::rename(temporary_path, chunk_path);
+            written += size;
+        }
+        chunks.push_back(chunk);
+        file_size += size;
+        begin += size;
+    }
+
+    {
+        std::ofstream list(list_path, std::ios::binary | std::ios::trunc);
+        unsigned char header[LIST_HEADER_SIZE];
+        std::memcpy(header, LIST_MAGIC, sizeof(LIST_MAGIC));
+        put_be(header + 4, LIST_VERSION, 4);
+        put_be(header + 8, file_size, 8);
+        put_be(header + 16, chunks.size(), 4);
+        list.write(reinterpret_cast<const char*>(header), sizeof(header));
+        std::size_t id_size = hasher.id_size();
+        for(auto const& chunk : chunks)
+        {
+            unsigned char entry[LIST_ENTRY_MAX_SIZE];
+            std::memcpy(entry, chunk.id.data(), id_size);
+            put_be(entry + id_size, chunk.size, 4);
+            list.write(reinterpret_cast<const char*>(entry), id_size + 4);
+        }
+        written += LIST_HEADER_SIZE + chunks.size() * (id_size + 4);
+    }
+    std::filesystem::last_write_time(list_path, std::filesystem::last_write_time(source));
+
+    span.add_counter(TRACE_BYTES_WRITTEN, written);
+    return written;
+}
+
+bool read_chunk_list(const std::filesystem::path& list_path, std::size_t id_size, std::vector<ChunkRef>& chunks)
+// Reads the chunks of a chunked blob. Returns false if the file is not a complete chunk list for ids of id_size bytes.
+{
+    std::error_code error;
+    std::uintmax_t size = std::filesystem::file_size(list_path, error);
+    std::ifstream list(list_path, std::ios::binary);
+    unsigned char header[LIST_HEADER_SIZE];
+    if(error || !list.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+        std::memcmp(header, LIST_MAGIC, sizeof(LIST_MAGIC)) != 0 || get_be(header + 4, 4) != LIST_VERSION)
+    {
+        return false;
+    }
+
+    std::uint64_t count = get_be(header + 16, 4);
+    if(size != LIST_HEADER_SIZE + count * (id_size + 4))
+    {
+        return false;
+    }
+    chunks.clear();
+    chunks.reserve(count);
+    for(std::uint64_t i = 0; i < count; i++)
+    {
+        unsigned char entry[LIST_ENTRY_MAX_SIZE];
+        if(!list.read(reinterpret_cast<char*>(entry), id_size + 4))
+        {
+            return false;
+        }
+        chunks.push_back({ObjectId::from_bytes(entry, id_size), static_cast<std::uint32_t>(get_be(entry + id_size, 4))});
+    }
+    return true;
+}
+
+bool read_chunked_blob(const std::vector<ChunkRef>& chunks, const ObjectStore& store, std::string& content)
+// Concatenates the chunks into content. Returns false if a chunk is missing or has the wrong size.
+{
+    TraceSpan span("read_chunked_blob");
+
+    std::uint64_t size = 0;
+    for(auto const& chunk : chunks)
+    {
+        size += chunk.size;
+    }
+    content.resize(size);
+
+    std::size_t position = 0;
+    for(auto const& chunk : chunks)
+    {
+        std::ifstream file(store.find(ObjectType::Chunk, chunk.id), std::ios::binary);
+        if(!file.read(content.data() + position, chunk.size))
+        {
+            return false;
+        }
+        position += chunk.size;
+    }
+
+    span.add_counter(TRACE_BYTES_READ, size);
+    return true;
+}
@@ -0,0 +1,43 @@
+#ifndef _CHUNKING_H_
+#define _CHUNKING_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "Hash.h"
+#include "ObjectId.h"
+#include "ObjectStore.h"
+
+// Content-defined chunking of large files.
+//
+// A file of at least CHUNKING_THRESHOLD bytes is not copied into its blob. It is cut into chunks at positions
+// chosen by its content (FastCDC: a gear rolling hash, with a stricter cut condition before the average chunk size
+// than after it), each chunk is stored once as a Chunk object named by the object hash of its bytes, and the blob is
+// stored as a ChunkList object listing them. An edit then only adds the chunks around it, since the cut points
+// elsewhere stay the same. Chunk lists live in their own directory, so a file whose bytes happen to look like a list
+// is still stored and read as a plain blob. The list keeps the file's last write time, so blob ids do not depend on
+// how the blob is stored.
+//
+// Chunk list layout (integers big-endian): "MGCL", version, file size (64-bit), count, chunks {id[id size], size}.
+
+typedef struct ChunkRef
+{
+    ObjectId id;
+    std::uint32_t size = 0;
+} ChunkRef;
+
+const std::uint64_t CHUNKING_THRESHOLD = 1 << 20;
+const std::size_t MIN_CHUNK_SIZE = 16 * 1024;
+const std::size_t AVERAGE_CHUNK_SIZE = 64 * 1024;
+const std::size_t MAX_CHUNK_SIZE = 256 * 1024;
+
+std::size_t find_chunk_end(const unsigned char* data, std::size_t size);
+std::uint64_t write_chunked_blob(const std::filesystem::path& source, const std::filesystem::path& list_path,
+    const ObjectStore& store, const ObjectHasher& hasher);
+bool read_chunk_list(const std::filesystem::path& list_path, std::size_t id_size, std::vector<ChunkRef>& chunks);
+bool read_chunked_blob(const std::vector<ChunkRef>& chunks, const ObjectStore& store, std::string& content);
+
+#endif
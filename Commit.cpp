@@ -1,10 +1,25 @@
 #include <ctime>
 #include <nlohmann/json.hpp>
 #include <string>
-#include <unordered_map>
 #include <vector>
 #include "Commit.h"
 
+void to_json(nlohmann::json& json_data, const FileChange& change)
+{
+    json_data = nlohmann::json {
+        {"path",    change.path},
+        {"added",   change.added},
+        {"removed", change.removed}
+    };
+}
+
+void from_json(const nlohmann::json& json_data, FileChange& change)
+{
+    json_data.at("path").get_to(change.path);
+    json_data.at("added").get_to(change.added);
+    json_data.at("removed").get_to(change.removed);
+}
+
 void to_json(nlohmann::json& json_data, const CommitInfo& commit)
 {
     json_data = nlohmann::json {
@@ -14,8 +29,12 @@ void to_json(nlohmann::json& json_data, const CommitInfo& commit)
         {"timestamp",   commit.timestamp},
         {"parent_1_id",   commit.parent_1_id},
         {"parent_2_id",   commit.parent_2_id},
-        {"file_hashes",   commit.file_hashes} // unordered_map serializes automatically
+        {"file_hashes",   commit.file_hashes}
     };
+    if(commit.changes_recorded)
+    {
+        json_data["changes"] = commit.changes;
+    }
 }
 
 void from_json(const nlohmann::json& json_data, CommitInfo& commit)
@@ -26,7 +45,14 @@ void from_json(const nlohmann::json& json_data, CommitInfo& commit)
     json_data.at("timestamp").get_to(commit.timestamp);
     json_data.at("parent_1_id").get_to(commit.parent_1_id);
     json_data.at("parent_2_id").get_to(commit.parent_2_id);
-    json_data.at("file_hashes").get_to(commit.file_hashes);  // works for unordered_map<string,string>
+    json_data.at("file_hashes").get_to(commit.file_hashes);
+
+    // Older commits have no change list
+    commit.changes_recorded = json_data.contains("changes");
+    if(commit.changes_recorded)
+    {
+        json_data.at("changes").get_to(commit.changes);
+    }
 }
 
 std::string timepoint_to_string(const std::chrono::system_clock::time_point& tp) {
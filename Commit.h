@@ -6,20 +6,34 @@
 #include <nlohmann/json.hpp>
 #include <sstream>
 #include <string>
-#include <unordered_map>
+#include <vector>
+
+#include "ObjectId.h"
+#include "PathMap.h"
+
+typedef struct FileChange
+{
+    std::string path;
+    std::size_t added = 0;   // lines
+    std::size_t removed = 0; // lines
+} FileChange;
 
 typedef struct CommitInfo
 {
-    std::string id;
+    ObjectId id;
     std::string author; 
     std::string message;
     std::string timestamp;
-    std::string parent_1_id; // current branch
-    std::string parent_2_id; // merged branch
-    std::unordered_map<std::string, std::string> file_hashes; // filename -> blob hash
+    ObjectId parent_1_id; // current branch
+    ObjectId parent_2_id; // merged branch
+    PathMap file_hashes; // filename -> blob hash, sorted by filename
+    bool changes_recorded = false; // false for commits written before changes were recorded
+    std::vector<FileChange> changes; // files that differ from parent 1, sorted by filename
 } CommitInfo;
 
 
+void to_json(nlohmann::json& json_data, const FileChange& change);
+void from_json(const nlohmann::json& json_data, FileChange& change);
 void to_json(nlohmann::json& json_data, const CommitInfo& commit);
 void from_json(const nlohmann::json& json_data, CommitInfo& commit);
 std::string timepoint_to_string(const std::chrono::system_clock::time_point& tp);
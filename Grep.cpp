@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Grep.h"
+#include "Trace.h"
+
+static std::size_t skip_bracketed(const std::string& pattern, std::size_t position)
+// Returns the position of the bracket closing the group, class or repetition count opened at position.
+{
+    char open = pattern[position];
+    char close = open == '(' ? ')' : open == '[' ? ']' : '}';
+    int depth = 0;
+    for(std::size_t i = position; i < pattern.size(); i++)
+    {
+        if(pattern[i] == '\\')
+        {
+            i++;
+        }
+        else if(pattern[i] == '[' && open == '(')
+        {
+            i = skip_bracketed(pattern, i);
+        }
+        else if(pattern[i] == open && (open == '(' || i == position))
+        {
+            depth++;
+        }
+        else if(pattern[i] == close && --depth == 0)
+        {
+            return i;
+        }
+    }
+    return pattern.size();
+}
+
+static std::size_t skip_escape(const std::string& pattern, std::size_t position)
+// Index of the last character of the escape starting with the backslash at position: \xHH, \uHHHH, \cX,
+// a back reference of any number of digits, or a single letter.
+{
+    std::size_t end = position + 1;
+    if(end >= pattern.size())
+    {
+        return position;
+    }
+
+    char kind = pattern[end];
+    std::size_t length = kind == 'x' ? 2 : kind == 'u' ? 4 : kind == 'c' ? 1 : 0;
+    if(std::isdigit(static_cast<unsigned char>(kind)))
+    {
+        while(end + 1 < pattern.size() && std::isdigit(static_cast<unsigned char>(pattern[end + 1])))
+        {
+            end++;
+        }
+    }
+    return std::min(end + length, pattern.size() - 1);
+}
+
+static std::string find_required_literal(const std::string& pattern, bool& literal_only)
+// Longest run of plain characters that every match contains. Characters inside groups and classes, or made
+// optional by a following quantifier, end a run; a pattern with alternation has no required literal.
+// literal_only is set if the whole pattern is one run.
+{
+    literal_only = false;
+    if(pattern.find('|') != std::string::npos)
+    {
+        return {};
+    }
+
+    std::string longest;
+    std::string run;
+    bool plain_only = true;
+    for(std::size_t i = 0; i < pattern.size(); i++)
+    {
+        char character = pattern[i];
+        bool plain = std::strchr(".^$*+?()[]{}\\|", character) == nullptr;
+        if(character == '\\' && i + 1 < pattern.size() && !std::isalnum(static_cast<unsigned char>(pattern[i + 1])))
+        {
+            character = pattern[++i];
+            plain = true;
+        }
+
+        if(!plain)
+        {
+            plain_only = false;
+            if(run.size() > longest.size())
+            {
+                longest = run;
+            }
+            run.clear();
+            if(character == '(' || character == '[' || character == '{')
+            {
+                i = skip_bracketed(pattern, i);
+            }
+            else if(character == '\\')
+            {
+                i = skip_escape(pattern, i);
+            }
+            continue;
+        }
+
+        char next = i + 1 < pattern.size() ? pattern[i + 1] : '\0';
+        if(next == '*' || next == '?' || next == '{' || next == '+')
+        {
+            // The character may be absent (or repeated), so the run cannot continue past it
+            plain_only = false;
+            if(next == '+')
+            {
+                run += character;
+            }
+            if(run.size() > longest.size())
+            {
+                longest = run;
+            }
+            run.clear();
+            continue;
+        }
+        run += character;
+    }
+    if(run.size() > longest.size())
+    {
+        longest = run;
+    }
+
+    literal_only = plain_only && !pattern.empty();
+    return longest;
+}
+
+bool LinePattern::compile(const std::string& pattern)
+// Returns false if the pattern is not a valid regular expression.
+{
+    try
+    {
+        expression = std::regex(pattern, std::regex::ECMAScript | std::regex::optimize);
+    }
+    catch(const std::regex_error&)
+    {
+        return false;
+    }
+    literal = find_required_literal(pattern, literal_only);
+    return true;
+}
+
+void LinePattern::search(const FileLines& file, std::vector<std::size_t>& matching_lines) const
+// Appends the (0-based) numbers of the lines that contain a match, in order.
+{
+    auto matches = [this](std::string_view line)
+    {
+        return literal_only || std::regex_search(line.begin(), line.end(), expression);
+    };
+
+    if(literal.empty())
+    {
+        for(std::size_t i = 0; i < file.lines.size(); i++)
+        {
+            if(matches(file.lines[i]))
+            {
+                matching_lines.push_back(i);
+            }
+        }
+        return;
+    }
+
+    // Jump from one occurrence of the literal to the next (find scans with memchr), then check only its line
+    std::string_view content = file.content;
+    std::size_t position = content.find(literal);
+    while(position != std::string_view::npos)
+    {
+        const char* occurrence = content.data() + position;
+        auto line = std::upper_bound(file.lines.begin(), file.lines.end(), occurrence,
+            [](const char* address, std::string_view line) { return address < line.data(); }) - 1;
+        std::size_t line_end = line->data() + line->size() - content.data();
+        // An occurrence spanning a line break belongs to no line
+        if(position + literal.size() > line_end)
+        {
+            position = content.find(literal, position + 1);
+            continue;
+        }
+        if(matches(*line))
+        {
+            matching_lines.push_back(line - file.lines.begin());
+        }
+        position = content.find(literal, line_end);
+    }
+}
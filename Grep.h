@@ -0,0 +1,27 @@
+#ifndef _GREP_H_
+#define _GREP_H_
+
+#include <cstddef>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "Merge.h"
+
+class LinePattern
+// Regular expression (ECMAScript syntax) searched for in single lines.
+// The longest literal that every match must contain is taken from the pattern, and a file is first scanned for it
+// as a whole, so only the lines holding it are handed to the regex engine. A pattern that is nothing but a literal
+// never runs the regex engine at all.
+{
+    public:
+        bool compile(const std::string& pattern);
+        void search(const FileLines& file, std::vector<std::size_t>& matching_lines) const;
+
+    private:
+        std::regex expression;
+        std::string literal;
+        bool literal_only = false;
+};
+
+#endif
@@ -0,0 +1,116 @@
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <openssl/evp.h>
+
+#include "Hash.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+static const std::size_t READ_BUFFER_SIZE = 64 * 1024;
+
+const std::size_t ObjectHasher::PARALLEL_BATCH_SIZE;
+
+static const EVP_MD* digest_of(HashAlgorithm algorithm)
+// The digest implementation, looked up once. With OpenSSL 3 an explicit fetch avoids the implicit
+// lookup the EVP_sha*() shortcuts cost on every initialization.
+{
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    static const EVP_MD* sha1 = EVP_MD_fetch(nullptr, "SHA1", nullptr);
+    static const EVP_MD* sha256 = EVP_MD_fetch(nullptr, "SHA256", nullptr);
+#else
+    static const EVP_MD* sha1 = EVP_sha1();
+    static const EVP_MD* sha256 = EVP_sha256();
+#endif
+    return algorithm == HashAlgorithm::Sha256 ? sha256 : sha1;
+}
+
+HashStream::HashStream(HashAlgorithm algorithm) : context(EVP_MD_CTX_new(), &EVP_MD_CTX_free)
+{
+    EVP_DigestInit_ex(context.get(), digest_of(algorithm), nullptr);
+}
+
+void HashStream::update(const void* data, std::size_t size)
+{
+    EVP_DigestUpdate(context.get(), data, size);
+}
+
+ObjectId HashStream::finish()
+{
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_size = 0;
+    EVP_DigestFinal_ex(context.get(), digest, &digest_size);
+    EVP_DigestInit_ex(context.get(), nullptr, nullptr);
+    return ObjectId::from_bytes(digest, digest_size);
+}
+
+std::size_t ObjectHasher::id_size() const
+{
+    return hash_algorithm == HashAlgorithm::Sha256 ? MINIGIT_SHA256_DIGEST_LENGTH : MINIGIT_SHA_DIGEST_LENGTH;
+}
+
+ObjectId ObjectHasher::hash(std::string_view data) const
+{
+    HashStream stream(hash_algorithm);
+    stream.update(data.data(), data.size());
+    return stream.finish();
+}
+
+bool ObjectHasher::hash_file(const std::filesystem::path& path, ObjectId& id, std::uint64_t& size) const
+// Hashes the contents of a file, streamed through a fixed buffer, and returns its size in size.
+// Returns false if the file cannot be read.
+{
+    std::ifstream file(path, std::ios::binary);
+    if(!file)
+    {
+        return false;
+    }
+
+    HashStream stream(hash_algorithm);
+    std::vector<char> buffer(READ_BUFFER_SIZE);
+    size = 0;
+    while(file)
+    {
+        file.read(buffer.data(), buffer.size());
+        stream.update(buffer.data(), static_cast<std::size_t>(file.gcount()));
+        size += static_cast<std::uint64_t>(file.gcount());
+    }
+    if(!file.eof())
+    {
+        return false;
+    }
+    id = stream.finish();
+    return true;
+}
+
+void ObjectHasher::hash_batch(const std::vector<std::string>& inputs, std::vector<ObjectId>& ids) const
+// Hashes a batch of small inputs into ids (in the same order). This is a plain loop, one input after another,
+// that reuses one digest context per range since setting one up costs more than hashing a few dozen bytes.
+// Batches of at least PARALLEL_BATCH_SIZE inputs are split across threads.
+{
+    TraceSpan span("hash_batch");
+    span.add_counter("inputs", inputs.size());
+
+    ids.resize(inputs.size());
+    auto hash_range = [this, &inputs, &ids](std::size_t begin, std::size_t end)
+    {
+        HashStream stream(hash_algorithm);
+        for(std::size_t i = begin; i < end; i++)
+        {
+            stream.update(inputs[i].data(), inputs[i].size());
+            ids[i] = stream.finish();
+        }
+    };
+
+    if(inputs.size() < PARALLEL_BATCH_SIZE)
+    {
+        hash_range(0, inputs.size());
+    }
+    else
+    {
+        ThreadPool pool;
+        parallel_for(pool, inputs.size(), hash_range);
+    }
+}
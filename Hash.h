@@ -0,0 +1,49 @@
+#ifndef _HASH_H_
+#define _HASH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ObjectId.h"
+
+struct evp_md_ctx_st;
+
+class HashStream
+// Incremental digest over data fed in pieces (OpenSSL's EVP interface, which uses the SHA extensions of the CPU
+// when present). finish() returns the id and resets the stream, so one stream can hash many inputs in turn.
+{
+    public:
+        explicit HashStream(HashAlgorithm algorithm);
+
+        void update(const void* data, std::size_t size);
+        ObjectId finish();
+
+    private:
+        std::unique_ptr<evp_md_ctx_st, void (*)(evp_md_ctx_st*)> context;
+};
+
+class ObjectHasher
+// Computes object ids with the hash algorithm of a repository.
+{
+    public:
+        explicit ObjectHasher(HashAlgorithm algorithm = HashAlgorithm::Sha1) : hash_algorithm(algorithm) {}
+
+        HashAlgorithm algorithm() const { return hash_algorithm; }
+        std::size_t id_size() const;
+
+        ObjectId hash(std::string_view data) const;
+        bool hash_file(const std::filesystem::path& path, ObjectId& id, std::uint64_t& size) const;
+        void hash_batch(const std::vector<std::string>& inputs, std::vector<ObjectId>& ids) const;
+
+        static const std::size_t PARALLEL_BATCH_SIZE = 4096;
+
+    private:
+        HashAlgorithm hash_algorithm;
+};
+
+#endif
@@ -6,6 +6,7 @@
 #include <nlohmann/json.hpp>
 
 #include "Log.h"
+#include "Trace.h"
 
 void to_json(nlohmann::json& json_data, const LogEntry& log_entry)
 {
@@ -36,6 +37,12 @@ void read_log(std::string log_filename, std::vector<LogEntry>& entries)
     bool index_exists = std::filesystem::exists(log_filename);
     if(index_exists)
     {
+        TraceSpan span("read_log");
+        if(span.enabled())
+        {
+            span.add_counter(TRACE_BYTES_READ, std::filesystem::file_size(log_filename));
+        }
+
         std::ifstream file(log_filename);
         nlohmann::json json_data;
         file >> json_data;
@@ -45,6 +52,8 @@ void read_log(std::string log_filename, std::vector<LogEntry>& entries)
 
 void write_log_entry(std::string log_filename, const LogEntry& log_entry)
 {
+    TraceSpan span("write_log_entry");
+
     // Read log file and append newest entry
     std::vector<LogEntry> entries;
     read_log(log_filename, entries);
@@ -6,15 +6,17 @@
 
 #include <nlohmann/json.hpp>
 
+#include "ObjectId.h"
+
 typedef struct LogEntry
 {
-    std::string old_commit_id;
-    std::string new_commit_id;
+    ObjectId old_commit_id;
+    ObjectId new_commit_id;
     std::string author; 
     std::string timestamp;
     std::string message;
-    bool merge;
-    std::string other_commit_id; // HEAD commit id of the branch being merged into current branch
+    bool merge = false;
+    ObjectId other_commit_id; // HEAD commit id of the branch being merged into current branch
 } LogEntry;
 
 
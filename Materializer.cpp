@@ -0,0 +1,445 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#ifdef MINIGIT_HAVE_IO_URING
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "Materializer.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+static void concatenate_chunks(const FileCopy& copy)
+// Streams the chunks into the destination one after another.
+{
+    std::ofstream destination(copy.destination, std::ios::binary | std::ios::trunc);
+    for(auto const& chunk : copy.chunks)
+    {
+        std::ifstream source(chunk, std::ios::binary);
+        if(!source || !(destination << source.rdbuf()))
+        {
+            throw std::filesystem::filesystem_error("cannot copy chunk", chunk, copy.destination,
+                std::make_error_code(std::errc::io_error));
+        }
+    }
+}
+
+static void copy_file_with_timestamp(const FileCopy& copy)
+// The portable path: replace the destination and preserve the source's last write time.
+{
+    if(std::filesystem::exists(copy.destination))
+    {
+        std::filesystem::remove(copy.destination);
+    }
+
+    if(copy.chunks.empty())
+    {
+        std::filesystem::copy_file(copy.source, copy.destination, std::filesystem::copy_options::none);
+    }
+    else
+    {
+        concatenate_chunks(copy);
+    }
+
+    auto timestamp = std::filesystem::last_write_time(copy.source);
+    std::filesystem::last_write_time(copy.destination, timestamp);
+}
+
+void Materializer::add(const std::filesystem::path& source, const std::filesystem::path& destination,
+    std::vector<std::filesystem::path> chunks)
+{
+    copies.push_back({source, destination, std::move(chunks)});
+}
+
+void Materializer::run()
+// Performs every added copy, then forgets them. Throws std::filesystem::filesystem_error if a copy fails.
+{
+    TraceSpan span("materialize");
+
+    std::vector<bool> done(copies.size(), false);
+    run_io_uring(done);
+    run_thread_pool(done);
+
+    copies.clear();
+}
+
+void Materializer::run_thread_pool(const std::vector<bool>& done) const
+// Copies whatever the io_uring backend did not, spread over a thread pool.
+{
+    std::vector<const FileCopy*> remaining;
+    for(std::size_t i = 0; i < copies.size(); i++)
+    {
+        if(!done[i])
+        {
+            remaining.push_back(&copies[i]);
+        }
+    }
+
+    if(remaining.empty())
+    {
+        return;
+    }
+
+    ThreadPool pool;
+    parallel_for(pool, remaining.size(), [&remaining](std::size_t begin, std::size_t end)
+    {
+        for(std::size_t i = begin; i < end; i++)
+        {
+            copy_file_with_timestamp(*remaining[i]);
+        }
+    });
+}
+
+#ifdef MINIGIT_HAVE_IO_URING
+
+namespace
+{
+
+class IoUring
+// Minimal io_uring ring driven through the raw system calls (no liburing dependency).
+// Only one thread may use a ring.
+{
+    public:
+        explicit IoUring(unsigned entries)
+        {
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+
+            ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+            if(ring_fd < 0)
+            {
+                return;
+            }
+
+            sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+            if(single_mmap)
+            {
+                sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+            }
+
+            sq_ring = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+            cq_ring = single_mmap ? sq_ring :
+                mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+            sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+            void* sqes_map = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+
+            if(sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqes_map == MAP_FAILED)
+            {
+                close(ring_fd);
+                ring_fd = -1;
+                return;
+            }
+
+            char* sq = static_cast<char*>(sq_ring);
+            char* cq = static_cast<char*>(cq_ring);
+            sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+            cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+            sqes = static_cast<io_uring_sqe*>(sqes_map);
+            capacity = params.sq_entries;
+        }
+
+        ~IoUring()
+        {
+            if(ring_fd < 0)
+            {
+                return;
+            }
+            munmap(sqes, sqes_size);
+            if(!single_mmap)
+            {
+                munmap(cq_ring, cq_ring_size);
+            }
+            munmap(sq_ring, sq_ring_size);
+            close(ring_fd);
+        }
+
+        IoUring(const IoUring&) = delete;
+        IoUring& operator=(const IoUring&) = delete;
+
+        bool valid() const { return ring_fd >= 0; }
+        unsigned size() const { return capacity; }
+
+        bool register_sparse_files(unsigned count)
+        // Reserves count direct descriptor slots for IORING_OP_OPENAT with file_index.
+        {
+            std::vector<int> fds(count, -1);
+            return syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_FILES, fds.data(), count) == 0;
+        }
+
+        io_uring_sqe* next_sqe()
+        // Returns a cleared submission entry, queued with the next submit.
+        {
+            unsigned index = (*sq_tail + queued) & sq_mask;
+            io_uring_sqe* sqe = &sqes[index];
+            std::memset(sqe, 0, sizeof(*sqe));
+            sq_array[index] = index;
+            queued++;
+            return sqe;
+        }
+
+        template<typename Visitor>
+        bool submit_and_wait(Visitor visit)
+        // Submits the queued entries and calls visit(cqe) for each of their completions.
+        // Returns false if the kernel rejected the submission.
+        {
+            unsigned expected = queued;
+            __atomic_store_n(sq_tail, *sq_tail + queued, __ATOMIC_RELEASE);
+
+            unsigned to_submit = queued;
+            queued = 0;
+            unsigned completed = 0;
+            while(completed < expected)
+            {
+                int ret = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, expected - completed,
+                    IORING_ENTER_GETEVENTS, nullptr, 0));
+                if(ret < 0)
+                {
+                    if(errno == EINTR)
+                    {
+                        continue;
+                    }
+                    return false;
+                }
+                to_submit -= std::min<unsigned>(to_submit, static_cast<unsigned>(ret));
+
+                unsigned head = *cq_head;
+                unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+                for(; head != tail; head++, completed++)
+                {
+                    visit(cqes[head & cq_mask]);
+                }
+                __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+            }
+            return true;
+        }
+
+    private:
+        int ring_fd = -1;
+        bool single_mmap = false;
+        void* sq_ring = nullptr;
+        void* cq_ring = nullptr;
+        std::size_t sq_ring_size = 0;
+        std::size_t cq_ring_size = 0;
+        std::size_t sqes_size = 0;
+        unsigned* sq_tail = nullptr;
+        unsigned sq_mask = 0;
+        unsigned* sq_array = nullptr;
+        unsigned* cq_head = nullptr;
+        unsigned* cq_tail = nullptr;
+        unsigned cq_mask = 0;
+        io_uring_cqe* cqes = nullptr;
+        io_uring_sqe* sqes = nullptr;
+        unsigned capacity = 0;
+        unsigned queued = 0;
+};
+
+// Linked operations per file; the operation index is kept in the low bits of user_data
+enum FileOperation : unsigned
+{
+    OPEN_SOURCE,
+    READ_SOURCE,
+    OPEN_DESTINATION,
+    WRITE_DESTINATION,
+    CLOSE_SOURCE,
+    CLOSE_DESTINATION,
+    OPERATIONS_PER_FILE
+};
+
+const unsigned FILES_PER_BATCH = 64;
+
+static_assert(Materializer::MAX_BUFFERED_FILE_SIZE <= Materializer::BATCH_BUFFER_SIZE,
+    "every buffered file must fit in an empty batch");
+
+typedef struct PendingCopy
+{
+    std::size_t copy;
+    char* buffer; // a slice of the batch buffer
+    std::size_t size;
+    mode_t mode;
+    timespec modified;
+    bool failed;
+} PendingCopy;
+
+bool io_uring_disabled()
+{
+    const char* setting = std::getenv("MINIGIT_IO_URING");
+    return setting != nullptr && std::strcmp(setting, "0") == 0;
+}
+
+}
+
+void Materializer::run_io_uring(std::vector<bool>& done) const
+// Copies files through io_uring in batches and marks the ones that fully succeeded. A batch ends after
+// FILES_PER_BATCH files or when the next file does not fit in what is left of the BATCH_BUFFER_SIZE buffer,
+// which is allocated once and reused by every batch.
+// Chunked blobs and sources that cannot be stat'ed, are not regular files or are too large are left for the fallback.
+{
+    if(copies.empty() || io_uring_disabled())
+    {
+        return;
+    }
+
+    IoUring ring(FILES_PER_BATCH * OPERATIONS_PER_FILE);
+    if(!ring.valid() || !ring.register_sparse_files(2 * FILES_PER_BATCH))
+    {
+        return;
+    }
+
+    TraceSpan span("materialize_io_uring");
+
+    std::vector<PendingCopy> batch;
+    batch.reserve(FILES_PER_BATCH);
+    std::unique_ptr<char[]> buffer;
+
+    std::size_t next = 0;
+    while(next < copies.size())
+    {
+        batch.clear();
+        std::size_t buffered = 0;
+        for(; next < copies.size() && batch.size() < FILES_PER_BATCH; next++)
+        {
+            struct stat source_stat;
+            if(!copies[next].chunks.empty() || stat(copies[next].source.c_str(), &source_stat) != 0 || 
+                    !S_ISREG(source_stat.st_mode) || static_cast<std::size_t>(source_stat.st_size) > MAX_BUFFERED_FILE_SIZE)
+            {
+                continue;
+            }
+
+            std::size_t size = static_cast<std::size_t>(source_stat.st_size);
+            if(buffered + size > BATCH_BUFFER_SIZE)
+            {
+                // Left for the next batch
+                break;
+            }
+            if(!buffer)
+            {
+                // Only the pages the files are read into get touched, so a few small files stay cheap
+                buffer.reset(new char[BATCH_BUFFER_SIZE]);
+            }
+            batch.push_back({next, buffer.get() + buffered, size,
+                static_cast<mode_t>(source_stat.st_mode & 07777), source_stat.st_mtim, false});
+            buffered += size;
+        }
+
+        for(unsigned i = 0; i < batch.size(); i++)
+        {
+            const FileCopy& copy = copies[batch[i].copy];
+            unsigned source_slot = 2 * i;
+            unsigned destination_slot = 2 * i + 1;
+            std::uint64_t user_data = static_cast<std::uint64_t>(i) * OPERATIONS_PER_FILE;
+
+            io_uring_sqe* sqe = ring.next_sqe();
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = reinterpret_cast<std::uint64_t>(copy.source.c_str());
+            sqe->open_flags = O_RDONLY; // O_CLOEXEC is invalid for direct descriptors
+            sqe->file_index = source_slot + 1;
+            sqe->flags = IOSQE_IO_LINK;
+            sqe->user_data = user_data + OPEN_SOURCE;
+
+            sqe = ring.next_sqe();
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = static_cast<int>(source_slot);
+            sqe->addr = reinterpret_cast<std::uint64_t>(batch[i].buffer);
+            sqe->len = static_cast<unsigned>(batch[i].size);
+            sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_LINK;
+            sqe->user_data = user_data + READ_SOURCE;
+
+            sqe = ring.next_sqe();
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = reinterpret_cast<std::uint64_t>(copy.destination.c_str());
+            sqe->len = batch[i].mode;
+            sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC;
+            sqe->file_index = destination_slot + 1;
+            sqe->flags = IOSQE_IO_LINK;
+            sqe->user_data = user_data + OPEN_DESTINATION;
+
+            sqe = ring.next_sqe();
+            sqe->opcode = IORING_OP_WRITE;
+            sqe->fd = static_cast<int>(destination_slot);
+            sqe->addr = reinterpret_cast<std::uint64_t>(batch[i].buffer);
+            sqe->len = static_cast<unsigned>(batch[i].size);
+            sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_LINK;
+            sqe->user_data = user_data + WRITE_DESTINATION;
+
+            sqe = ring.next_sqe();
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->file_index = source_slot + 1;
+            sqe->flags = IOSQE_IO_LINK;
+            sqe->user_data = user_data + CLOSE_SOURCE;
+
+            sqe = ring.next_sqe();
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->file_index = destination_slot + 1;
+            sqe->user_data = user_data + CLOSE_DESTINATION;
+        }
+
+        // A failed operation cancels the rest of its file's chain, and a short read or write fails the link
+        bool submitted = ring.submit_and_wait([&batch](const io_uring_cqe& cqe)
+        {
+            PendingCopy& pending = batch[cqe.user_data / OPERATIONS_PER_FILE];
+            unsigned operation = cqe.user_data % OPERATIONS_PER_FILE;
+            bool transfer = operation == READ_SOURCE || operation == WRITE_DESTINATION;
+
+            if(cqe.res < 0 || (transfer && static_cast<std::size_t>(cqe.res) != pending.size))
+            {
+                pending.failed = true;
+            }
+        });
+        if(!submitted)
+        {
+            return;
+        }
+
+        std::size_t succeeded = 0;
+        for(auto const& pending : batch)
+        {
+            if(pending.failed)
+            {
+                continue;
+            }
+
+            // io_uring has no utimens operation
+            timespec times[2] = {{0, UTIME_OMIT}, pending.modified};
+            if(utimensat(AT_FDCWD, copies[pending.copy].destination.c_str(), times, 0) == 0)
+            {
+                done[pending.copy] = true;
+                succeeded++;
+                span.add_counter(TRACE_BYTES_WRITTEN, pending.size);
+            }
+        }
+
+        // If nothing in a batch worked the kernel most likely lacks a needed operation; use the fallback
+        if(succeeded == 0 && !batch.empty())
+        {
+            return;
+        }
+    }
+}
+
+#else
+
+void Materializer::run_io_uring(std::vector<bool>&) const
+{
+}
+
+#endif
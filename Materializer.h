@@ -0,0 +1,45 @@
+#ifndef _MATERIALIZER_H_
+#define _MATERIALIZER_H_
+
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+typedef struct FileCopy
+{
+    std::filesystem::path source;
+    std::filesystem::path destination;
+    std::vector<std::filesystem::path> chunks; // if set, the content is their concatenation and source only gives the time
+} FileCopy;
+
+class Materializer
+// Writes many files into the working directory at once, e.g. when checkout, revert or merge restore blobs.
+// Each destination is created or truncated and gets the last write time of its source, as blob hashes depend on it.
+// A chunked blob is added with the paths of its chunks and reassembled by streaming them into the destination.
+//
+// When built with MINIGIT_HAVE_IO_URING (Linux), the copies are submitted to io_uring in batches: per file an
+// open/read/open/write/close/close chain of linked operations on direct descriptors, so a batch of files costs
+// one io_uring_enter call. Timestamps are then set with utimensat, which io_uring has no operation for.
+// Without io_uring, when the ring cannot be set up, or when MINIGIT_IO_URING=0 is set, the copies run on a thread pool.
+// Any copy the io_uring backend could not complete is redone with std::filesystem, so failures are reported
+// as std::filesystem::filesystem_error in every case.
+{
+    public:
+        void add(const std::filesystem::path& source, const std::filesystem::path& destination,
+            std::vector<std::filesystem::path> chunks = {});
+        void run();
+        std::size_t size() const { return copies.size(); }
+
+        // Files larger than this are copied with std::filesystem rather than through an io_uring buffer
+        static const std::size_t MAX_BUFFERED_FILE_SIZE = 8 << 20;
+        // All files of one io_uring batch share a buffer of this size, which bounds the memory a batch uses
+        static const std::size_t BATCH_BUFFER_SIZE = 16 << 20;
+
+    private:
+        void run_io_uring(std::vector<bool>& done) const;
+        void run_thread_pool(const std::vector<bool>& done) const;
+
+        std::vector<FileCopy> copies;
+};
+
+#endif
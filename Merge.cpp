@@ -0,0 +1,287 @@
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Merge.h"
+#include "Trace.h"
+
+static const std::string_view CONFLICT_START = "<<<<<<< HEAD\n";
+static const std::string_view CONFLICT_SEPARATOR = "=======\n";
+static const std::string_view CONFLICT_END = ">>>>>>> MERGE\n";
+
+bool read_lines(const std::filesystem::path& path, FileLines& file)
+// Reads the whole file with a single read and splits it into lines the way std::getline does:
+// a final line without a trailing '\n' is still a line, an empty file has no lines.
+{
+    TraceSpan span("read_lines");
+
+    std::FILE* stream = std::fopen(path.string().c_str(), "rb");
+    if(stream == nullptr)
+    {
+        return false;
+    }
+
+    std::error_code error;
+    auto size = std::filesystem::file_size(path, error);
+    file.content.resize(error ? 0 : size);
+    file.content.resize(std::fread(file.content.data(), 1, file.content.size(), stream));
+    std::fclose(stream);
+    span.add_counter(TRACE_BYTES_READ, file.content.size());
+
+    split_lines(file);
+    return true;
+}
+
+void split_lines(FileLines& file)
+// Sets lines to views of the lines in content.
+{
+    std::string_view content = file.content;
+    file.lines.clear();
+    file.lines.reserve(std::count(content.begin(), content.end(), '\n') + 1);
+    while(!content.empty())
+    {
+        std::size_t end = content.find('\n');
+        if(end == std::string_view::npos)
+        {
+            end = content.size();
+        }
+        file.lines.push_back(content.substr(0, end));
+        content.remove_prefix(std::min(end + 1, content.size()));
+    }
+}
+
+bool merge_lines(const FileLines* base, const FileLines& branch_1, const FileLines& branch_2, std::string& out)
+// Merges the two branch versions line by line into out and returns true if there was a conflict.
+// Without a base (2-way merge) every differing line is a conflict. With a base (3-way merge) a line
+// changed on only one side takes that side's version.
+// out is sized once for the worst case (every line a conflict), so appending never reallocates.
+{
+    static const std::string_view empty;
+
+    std::size_t base_lines = base ? base->lines.size() : 0;
+    std::size_t max_lines = std::max({base_lines, branch_1.lines.size(), branch_2.lines.size()});
+
+    out.clear();
+    out.reserve(branch_1.content.size() + branch_2.content.size() + 
+        max_lines * (CONFLICT_START.size() + CONFLICT_SEPARATOR.size() + CONFLICT_END.size() + 2));
+
+    bool conflict = false;
+    for(std::size_t i = 0; i < max_lines; i++)
+    {
+        std::string_view base_line = (i < base_lines ? base->lines[i] : empty);
+        std::string_view branch_1_line = (i < branch_1.lines.size() ? branch_1.lines[i] : empty);
+        std::string_view branch_2_line = (i < branch_2.lines.size() ? branch_2.lines[i] : empty);
+
+        std::string_view line;
+        if(branch_1_line == branch_2_line)
+        {
+            line = branch_1_line;
+        }
+        else if(base && branch_1_line != base_line && branch_2_line == base_line)
+        {
+            // Only branch 1 line has changed
+            line = branch_1_line;
+        }
+        else if(base && branch_1_line == base_line && branch_2_line != base_line)
+        {
+            // Only branch 2 line has changed
+            line = branch_2_line;
+        }
+        else
+        {
+            conflict = true;
+
+            out.append(CONFLICT_START);
+            if(!branch_1_line.empty())
+            {
+                out.append(branch_1_line).push_back('\n');
+            }
+            out.append(CONFLICT_SEPARATOR);
+            if(!branch_2_line.empty())
+            {
+                out.append(branch_2_line).push_back('\n');
+            }
+            out.append(CONFLICT_END);
+            continue;
+        }
+
+        out.append(line).push_back('\n');
+    }
+
+    return conflict;
+}
+
+static long shortest_edit(const std::vector<std::string_view>& a, const std::vector<std::string_view>& b,
+    std::size_t start, long n, long m, std::vector<std::vector<long>>* trace)
+// Myers' O(ND) forward pass over a[start, start + n) and b[start, start + m). Returns the edit distance D,
+// or -1 if it exceeds MAX_LINE_DIFF_COST. With trace, the furthest x reached on each diagonal k = x - y
+// is kept after every round d < D, as trace[d][k + d], for walking the edit path back.
+{
+    long limit = std::min<long>(n + m, MAX_LINE_DIFF_COST);
+    std::vector<long> furthest(2 * limit + 3, 0);
+    long offset = limit + 1;
+
+    for(long d = 0; d <= limit; d++)
+    {
+        for(long k = -d; k <= d; k += 2)
+        {
+            long x = (k == -d || (k != d && furthest[offset + k - 1] < furthest[offset + k + 1])) ?
+                furthest[offset + k + 1] : furthest[offset + k - 1] + 1;
+            long y = x - k;
+            while(x < n && y < m && a[start + x] == b[start + y])
+            {
+                x++;
+                y++;
+            }
+            furthest[offset + k] = x;
+
+            if(x >= n && y >= m)
+            {
+                return d;
+            }
+        }
+        if(trace != nullptr)
+        {
+            trace->emplace_back(furthest.begin() + offset - d, furthest.begin() + offset + d + 1);
+        }
+    }
+    return -1;
+}
+
+static void trim_common_lines(const std::vector<std::string_view>& a, const std::vector<std::string_view>& b,
+    std::size_t& start, std::size_t& end_a, std::size_t& end_b)
+// Narrows both sides to the range between their common prefix and common suffix.
+{
+    start = 0;
+    while(start < a.size() && start < b.size() && a[start] == b[start])
+    {
+        start++;
+    }
+    end_a = a.size();
+    end_b = b.size();
+    while(end_a > start && end_b > start && a[end_a - 1] == b[end_b - 1])
+    {
+        end_a--;
+        end_b--;
+    }
+}
+
+void count_line_changes(const FileLines& old_file, const FileLines& new_file, std::size_t& added, std::size_t& removed)
+// Counts the lines added and removed between two versions of a file, as a line diff would show them:
+// both sides minus their longest common subsequence. The common prefix and suffix are skipped, then Myers'
+// O(ND) algorithm finds the edit distance D. If D exceeds MAX_LINE_DIFF_COST, the lines the two sides
+// have in common regardless of order are used instead, which can only understate the counts.
+{
+    TraceSpan span("count_line_changes");
+
+    const std::vector<std::string_view>& a = old_file.lines;
+    const std::vector<std::string_view>& b = new_file.lines;
+
+    std::size_t start, end_a, end_b;
+    trim_common_lines(a, b, start, end_a, end_b);
+    long n = static_cast<long>(end_a - start);
+    long m = static_cast<long>(end_b - start);
+
+    long d = shortest_edit(a, b, start, n, m, nullptr);
+    if(d >= 0)
+    {
+        std::size_t common = static_cast<std::size_t>(n + m - d) / 2;
+        added = m - common;
+        removed = n - common;
+        return;
+    }
+
+    std::unordered_map<std::string_view, long> counts;
+    for(std::size_t i = start; i < end_a; i++)
+    {
+        counts[a[i]]++;
+    }
+    std::size_t common = 0;
+    for(std::size_t i = start; i < end_b; i++)
+    {
+        if(auto search = counts.find(b[i]); search != counts.end() && search->second > 0)
+        {
+            search->second--;
+            common++;
+        }
+    }
+    added = m - common;
+    removed = n - common;
+}
+
+void match_lines(const FileLines& old_file, const FileLines& new_file, std::vector<long>& old_line_of)
+// Sets old_line_of[i] to the line of old_file that line i of new_file is kept from in a minimal line diff,
+// or -1 for an added line. If the edit distance exceeds MAX_LINE_DIFF_COST, only the common prefix and
+// suffix are matched.
+{
+    TraceSpan span("match_lines");
+
+    const std::vector<std::string_view>& a = old_file.lines;
+    const std::vector<std::string_view>& b = new_file.lines;
+
+    std::size_t start, end_a, end_b;
+    trim_common_lines(a, b, start, end_a, end_b);
+    long n = static_cast<long>(end_a - start);
+    long m = static_cast<long>(end_b - start);
+
+    old_line_of.assign(b.size(), -1);
+    for(std::size_t i = 0; i < start; i++)
+    {
+        old_line_of[i] = static_cast<long>(i);
+    }
+    for(std::size_t i = end_b; i < b.size(); i++)
+    {
+        old_line_of[i] = static_cast<long>(i - end_b + end_a);
+    }
+
+    std::vector<std::vector<long>> trace;
+    long d = shortest_edit(a, b, start, n, m, &trace);
+    if(d < 0)
+    {
+        return;
+    }
+
+    // Walk the edit path back from (n, m), recording the diagonal (matching) steps
+    long x = n;
+    long y = m;
+    for(; d > 0; d--)
+    {
+        const std::vector<long>& previous = trace[d - 1];
+        long k = x - y;
+        long previous_k = (k == -d || (k != d && previous[k - 1 + d - 1] < previous[k + 1 + d - 1])) ? k + 1 : k - 1;
+        long previous_x = previous[previous_k + d - 1];
+        long previous_y = previous_x - previous_k;
+        while(x > previous_x && y > previous_y)
+        {
+            x--;
+            y--;
+            old_line_of[start + y] = static_cast<long>(start + x);
+        }
+        x = previous_x;
+        y = previous_y;
+    }
+    while(x > 0 && y > 0)
+    {
+        x--;
+        y--;
+        old_line_of[start + y] = static_cast<long>(start + x);
+    }
+}
+
+void write_file(const std::filesystem::path& path, const std::string& content)
+// Replaces the file with content using a single write.
+{
+    TraceSpan span("write_file");
+
+    std::FILE* stream = std::fopen(path.string().c_str(), "wb");
+    if(stream != nullptr)
+    {
+        std::fwrite(content.data(), 1, content.size(), stream);
+        std::fclose(stream);
+        span.add_counter(TRACE_BYTES_WRITTEN, content.size());
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef _MERGE_H_
+#define _MERGE_H_
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Line based file merging. Each input file is read into one contiguous buffer and split into views,
+// so merging allocates one buffer per input and one for the output, independent of the line count.
+
+typedef struct FileLines
+{
+    std::string content;                 // whole file
+    std::vector<std::string_view> lines; // views into content, without the '\n'
+} FileLines;
+
+bool read_lines(const std::filesystem::path& path, FileLines& file);
+void split_lines(FileLines& file);
+bool merge_lines(const FileLines* base, const FileLines& branch_1, const FileLines& branch_2, std::string& out);
+void count_line_changes(const FileLines& old_file, const FileLines& new_file, std::size_t& added, std::size_t& removed);
+void match_lines(const FileLines& old_file, const FileLines& new_file, std::vector<long>& old_line_of);
+void write_file(const std::filesystem::path& path, const std::string& content);
+
+// Edit distance beyond which count_line_changes and match_lines stop running the exact diff
+const std::size_t MAX_LINE_DIFF_COST = 1024;
+
+#endif
@@ -1,3 +1,7 @@
+#ifndef _MINIGIT_H_
+#define _MINIGIT_H_
+
+#include <cstddef>
 #include <filesystem>
 #include <string>
 
@@ -5,16 +9,33 @@ const std::string MINIGIT_FILES_PATH = ".minigit";
 const std::filesystem::path MINIGIT_HEAD_PATH = std::filesystem::path(MINIGIT_FILES_PATH) / "HEAD";
 const std::filesystem::path MINIGIT_MERGING_FLAG_PATH = std::filesystem::path(MINIGIT_FILES_PATH) / "MERGING";
 const std::filesystem::path MINIGIT_MERGE_HEAD_PATH = std::filesystem::path(MINIGIT_FILES_PATH) / "MERGE_HEAD";
+const std::filesystem::path MINIGIT_CONFIG_PATH = std::filesystem::path(MINIGIT_FILES_PATH) / "config.json";
 const std::filesystem::path MINIGIT_INDEX_PATH = std::filesystem::path(MINIGIT_FILES_PATH) / "index.json";
+const std::filesystem::path MINIGIT_UNTRACKED_CACHE_PATH = std::filesystem::path(MINIGIT_FILES_PATH) / "untracked-cache";
 const std::filesystem::path MINIGIT_REFS_PATH = std::filesystem::path(MINIGIT_FILES_PATH) / "refs";
 const std::filesystem::path MINIGIT_BRANCHES_PATH = std::filesystem::path(MINIGIT_FILES_PATH) / "refs" / "heads";
 const std::filesystem::path MINIGIT_OBJECTS_PATH = std::filesystem::path(MINIGIT_FILES_PATH) / "objects";
 const std::filesystem::path MINIGIT_COMMITS_PATH = std::filesystem::path(MINIGIT_FILES_PATH) / "objects" / "commits";
 const std::filesystem::path MINIGIT_BLOBS_PATH = std::filesystem::path(MINIGIT_FILES_PATH) / "objects" / "blobs";
+const std::filesystem::path MINIGIT_CHUNKS_PATH = std::filesystem::path(MINIGIT_FILES_PATH) / "objects" / "chunks";
+const std::filesystem::path MINIGIT_CHUNK_LISTS_PATH = std::filesystem::path(MINIGIT_FILES_PATH) / "objects" / "chunk-lists";
+const std::filesystem::path MINIGIT_COMMITS_INDEX_PATH = std::filesystem::path(MINIGIT_FILES_PATH) / "objects" / "commits.idx";
+const std::filesystem::path MINIGIT_CHANGED_PATHS_PATH = std::filesystem::path(MINIGIT_FILES_PATH) / "objects" / "changed-paths";
+const std::filesystem::path MINIGIT_BLAME_CACHE_PATH = std::filesystem::path(MINIGIT_FILES_PATH) / "blame-cache";
+const std::filesystem::path MINIGIT_INFO_PATH = std::filesystem::path(MINIGIT_FILES_PATH) / "info";
+const std::filesystem::path MINIGIT_SPARSE_CHECKOUT_PATH = std::filesystem::path(MINIGIT_FILES_PATH) / "info" / "sparse-checkout";
 const std::filesystem::path MINIGIT_LOGS_PATH = std::filesystem::path(MINIGIT_FILES_PATH) / "logs";
 const std::filesystem::path MINIGIT_HEAD_LOG_PATH = std::filesystem::path(MINIGIT_FILES_PATH) / "logs" / "HEAD";
 const std::filesystem::path MINIGIT_LOG_REFS_PATH = std::filesystem::path(MINIGIT_FILES_PATH) / "logs" / "refs";
 const std::filesystem::path MINIGIT_BRANCHES_LOG_PATH = std::filesystem::path(MINIGIT_FILES_PATH) / "logs" / "refs" / "heads";
+const std::filesystem::path MINIGIT_BRANCH_COMMITS_PATH = std::filesystem::path(MINIGIT_FILES_PATH) / "branch-commits";
+const std::filesystem::path MINIGIT_COMMONDIR_PATH = std::filesystem::path(MINIGIT_FILES_PATH) / "commondir";
+const std::filesystem::path MINIGIT_WORKTREES_PATH = std::filesystem::path(MINIGIT_FILES_PATH) / "worktrees";
 const std::string MINIGIT_MASTER_BRANCH_NAME = "master";
 const int MINIGIT_SHA_DIGEST_LENGTH = 20;
+const int MINIGIT_SHA256_DIGEST_LENGTH = 32;
+const std::size_t MINIGIT_MIN_ABBREV_LENGTH = 4; // shortest accepted abbreviated id
+const long long MINIGIT_GC_DEFAULT_PRUNE_SECONDS = 14LL * 24 * 60 * 60;
+const unsigned MINIGIT_ADD_QUEUE_DEPTH = 2; // blobs queued or being written per worker during add
 
+#endif
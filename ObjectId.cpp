@@ -0,0 +1,114 @@
+#include "ObjectId.h"
+
+namespace
+{
+    const char HEX_DIGITS[] = "0123456789abcdef";
+
+    int hex_value(char c)
+    {
+        if(c >= '0' && c <= '9') return c - '0';
+        if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+}
+
+bool parse_hash_algorithm(std::string_view name, HashAlgorithm& algorithm)
+{
+    if(name == "sha1")
+    {
+        algorithm = HashAlgorithm::Sha1;
+    }
+    else if(name == "sha256")
+    {
+        algorithm = HashAlgorithm::Sha256;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+const char* hash_algorithm_name(HashAlgorithm algorithm)
+{
+    return algorithm == HashAlgorithm::Sha256 ? "sha256" : "sha1";
+}
+
+const std::size_t ObjectId::MAX_SIZE;
+const std::size_t ObjectId::MAX_HEX_SIZE;
+
+ObjectId ObjectId::from_bytes(const unsigned char* bytes, std::size_t size)
+// size must not exceed MAX_SIZE.
+{
+    ObjectId id;
+    std::memcpy(id.bytes.data(), bytes, size);
+    id.length = size;
+    return id;
+}
+
+bool ObjectId::from_hex(std::string_view hex, ObjectId& id)
+// Parses a full-length hex id of either digest size. Returns false (leaving id unchanged) if hex is not a valid id.
+{
+    if(hex.size() != 2 * MINIGIT_SHA_DIGEST_LENGTH && hex.size() != 2 * MINIGIT_SHA256_DIGEST_LENGTH)
+    {
+        return false;
+    }
+
+    ObjectId parsed;
+    parsed.length = hex.size() / 2;
+    for(std::size_t i = 0; i < parsed.length; i++)
+    {
+        int high = hex_value(hex[2 * i]);
+        int low = hex_value(hex[2 * i + 1]);
+        if(high < 0 || low < 0)
+        {
+            return false;
+        }
+        parsed.bytes[i] = static_cast<unsigned char>((high << 4) | low);
+    }
+
+    id = parsed;
+    return true;
+}
+
+void ObjectId::to_hex(char* out) const
+// Writes hex_size() characters (no terminator) to out.
+{
+    for(std::size_t i = 0; i < length; i++)
+    {
+        out[2 * i] = HEX_DIGITS[bytes[i] >> 4];
+        out[2 * i + 1] = HEX_DIGITS[bytes[i] & 0x0f];
+    }
+}
+
+std::string ObjectId::to_hex() const
+{
+    std::string hex(hex_size(), '0');
+    to_hex(hex.data());
+    return hex;
+}
+
+bool ObjectId::is_null() const
+{
+    for(auto byte : bytes)
+    {
+        if(byte != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void to_json(nlohmann::json& json_data, const ObjectId& id)
+// The null id is stored as an empty string, as commit and log files always have.
+{
+    json_data = id.is_null() ? std::string() : id.to_hex();
+}
+
+void from_json(const nlohmann::json& json_data, ObjectId& id)
+{
+    id = ObjectId();
+    ObjectId::from_hex(json_data.get<std::string>(), id);
+}
@@ -0,0 +1,77 @@
+#ifndef _OBJECT_ID_H_
+#define _OBJECT_ID_H_
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include <nlohmann/json.hpp>
+
+#include "MiniGit.h"
+
+// Object hash algorithms. The algorithm is chosen when a repository is initialized and recorded in its config.
+// Ids are the full digest: 20 bytes with SHA-1, 32 with SHA-256. The binary side files (object indexes, changed
+// path filters, blame cache, chunk lists, packs) store ids at the size of the repository's algorithm.
+enum class HashAlgorithm
+{
+    Sha1,
+    Sha256
+};
+
+bool parse_hash_algorithm(std::string_view name, HashAlgorithm& algorithm);
+const char* hash_algorithm_name(HashAlgorithm algorithm);
+
+class ObjectId
+// Binary object hash: MINIGIT_SHA_DIGEST_LENGTH bytes in a SHA-1 repository, MINIGIT_SHA256_DIGEST_LENGTH in
+// a SHA-256 one. A default constructed ObjectId is the null id, used where no object exists (e.g. the parent
+// of the first commit). On disk and in user-facing text ids are lowercase hex.
+{
+    public:
+        static const std::size_t MAX_SIZE = MINIGIT_SHA256_DIGEST_LENGTH;
+        static const std::size_t MAX_HEX_SIZE = 2 * MAX_SIZE;
+
+        ObjectId() = default;
+
+        static ObjectId from_bytes(const unsigned char* bytes, std::size_t size);
+        static bool from_hex(std::string_view hex, ObjectId& id);
+
+        std::string to_hex() const;
+        void to_hex(char* out) const;
+        bool is_null() const;
+        const unsigned char* data() const { return bytes.data(); }
+        std::size_t size() const { return length; }
+        std::size_t hex_size() const { return 2 * length; }
+
+        // Unused bytes are zero, so ids compare as whole arrays (and the null id equals an all-zero id of any size)
+        bool operator==(const ObjectId& other) const { return bytes == other.bytes; }
+        bool operator!=(const ObjectId& other) const { return !(*this == other); }
+        bool operator<(const ObjectId& other) const { return bytes < other.bytes; }
+
+        std::size_t hash() const
+        {
+            // The bytes are already uniformly distributed, so a prefix is a good hash
+            std::size_t value;
+            std::memcpy(&value, bytes.data(), sizeof(value));
+            return value;
+        }
+
+    private:
+        std::array<unsigned char, MAX_SIZE> bytes {};
+        std::size_t length = MINIGIT_SHA_DIGEST_LENGTH; // the null id prints as the SHA-1 sized zero id it always was
+};
+
+namespace std
+{
+    template<> struct hash<ObjectId>
+    {
+        std::size_t operator()(const ObjectId& id) const { return id.hash(); }
+    };
+}
+
+void to_json(nlohmann::json& json_data, const ObjectId& id);
+void from_json(const nlohmann::json& json_data, ObjectId& id);
+
+#endif
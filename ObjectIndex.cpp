@@ -0,0 +1,379 @@
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ObjectIndex.h"
+#include "Trace.h"
+
+static const char INDEX_MAGIC[4] = {'M', 'G', 'I', 'X'};
+static const std::uint32_t INDEX_VERSION = 1;
+static const std::size_t INDEX_HEADER_SIZE = sizeof(INDEX_MAGIC) + 4 + 256 * 4;
+
+static std::uint32_t read_be32(const unsigned char* bytes)
+{
+    return (std::uint32_t(bytes[0]) << 24) | (std::uint32_t(bytes[1]) << 16) | (std::uint32_t(bytes[2]) << 8) | bytes[3];
+}
+
+static void write_be32(std::ofstream& stream, std::uint32_t value)
+{
+    const char bytes[4] = {char(value >> 24), char(value >> 16), char(value >> 8), char(value)};
+    stream.write(bytes, sizeof(bytes));
+}
+
+static bool read_id(std::istream& stream, std::size_t id_size, ObjectId& id)
+{
+    unsigned char bytes[ObjectId::MAX_SIZE];
+    if(!stream.read(reinterpret_cast<char*>(bytes), id_size))
+    {
+        return false;
+    }
+    id = ObjectId::from_bytes(bytes, id_size);
+    return true;
+}
+
+static std::size_t common_hex_prefix(const ObjectId& a, const ObjectId& b)
+// Number of leading hex digits the two ids share.
+{
+    std::size_t length = 0;
+    for(std::size_t i = 0; i < std::min(a.size(), b.size()); i++)
+    {
+        unsigned char difference = a.data()[i] ^ b.data()[i];
+        if(difference != 0)
+        {
+            return length + ((difference & 0xf0) == 0 ? 1 : 0);
+        }
+        length += 2;
+    }
+    return length;
+}
+
+static bool has_hex_prefix(const ObjectId& id, std::string_view hex_prefix)
+{
+    char hex[ObjectId::MAX_HEX_SIZE];
+    id.to_hex(hex);
+    return std::string_view(hex, hex_prefix.size()) == hex_prefix;
+}
+
+const std::size_t ObjectIndex::MIN_PREFIX_LENGTH;
+const std::size_t ObjectIndex::LOOSE_LIMIT;
+
+ObjectIndex::ObjectIndex(const std::filesystem::path& objects_path, const std::filesystem::path& index_path,
+    std::size_t id_size) :
+    ObjectIndex([objects_path](std::vector<ObjectId>& ids)
+    {
+        if(std::filesystem::exists(objects_path))
+        {
+            for(auto const& dir_entry : std::filesystem::directory_iterator {objects_path})
+            {
+                ObjectId id;
+                if(dir_entry.is_regular_file() && ObjectId::from_hex(dir_entry.path().filename().string(), id))
+                {
+                    ids.push_back(id);
+                }
+            }
+        }
+    }, index_path, id_size)
+{
+}
+
+ObjectIndex::ObjectIndex(IdSource list_ids, const std::filesystem::path& index_path, std::size_t id_size) :
+    list_ids(std::move(list_ids)), id_size(id_size), index_path(index_path), loose_path(index_path.string() + ".loose")
+{
+}
+
+bool ObjectIndex::open()
+// Loads the fan-out table and the loose ids, rebuilding the index first if it is missing or damaged.
+{
+    if(opened)
+    {
+        return true;
+    }
+
+    for(int attempt = 0; attempt < 2 && !opened; attempt++)
+    {
+        sorted.close();
+        sorted.clear();
+        sorted.open(index_path, std::ios::binary);
+
+        unsigned char header[INDEX_HEADER_SIZE];
+        bool valid = sorted.read(reinterpret_cast<char*>(header), sizeof(header)) &&
+            std::equal(INDEX_MAGIC, INDEX_MAGIC + sizeof(INDEX_MAGIC), header) &&
+            read_be32(header + 4) == INDEX_VERSION;
+
+        if(valid)
+        {
+            for(int b = 0; b < 256; b++)
+            {
+                fanout[b] = read_be32(header + 8 + 4 * b);
+                valid = valid && (b == 0 || fanout[b] >= fanout[b - 1]);
+            }
+            std::error_code error;
+            valid = valid && std::filesystem::file_size(index_path, error) == INDEX_HEADER_SIZE + sorted_count() * id_size;
+        }
+
+        if(valid)
+        {
+            opened = true;
+        }
+        else if(attempt == 0)
+        {
+            rebuild();
+        }
+    }
+
+    if(opened)
+    {
+        loose.clear();
+        std::ifstream loose_file(loose_path, std::ios::binary);
+        ObjectId id;
+        while(read_id(loose_file, id_size, id))
+        {
+            loose.push_back(id);
+        }
+    }
+    return opened;
+}
+
+ObjectId ObjectIndex::sorted_id(std::size_t position)
+{
+    ObjectId id;
+    sorted.clear();
+    sorted.seekg(INDEX_HEADER_SIZE + position * id_size);
+    read_id(sorted, id_size, id);
+    return id;
+}
+
+std::size_t ObjectIndex::lower_bound(const ObjectId& id)
+// Position of the first sorted id not less than id. Only the fan-out range of id's first byte is searched.
+{
+    unsigned char first = id.data()[0];
+    std::size_t low = first == 0 ? 0 : fanout[first - 1];
+    std::size_t high = fanout[first];
+
+    while(low < high)
+    {
+        std::size_t middle = low + (high - low) / 2;
+        if(sorted_id(middle) < id)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+bool ObjectIndex::contains(const ObjectId& id)
+{
+    if(!open())
+    {
+        return false;
+    }
+
+    std::size_t position = lower_bound(id);
+    if(position < sorted_count() && sorted_id(position) == id)
+    {
+        return true;
+    }
+    return std::find(loose.begin(), loose.end(), id) != loose.end();
+}
+
+PrefixMatch ObjectIndex::resolve(std::string_view hex_prefix, ObjectId& id)
+// Finds the id starting with hex_prefix (case-insensitive, at least MIN_PREFIX_LENGTH digits).
+// Returns Ambiguous if more than one id matches.
+{
+    TraceSpan span("resolve_object_id");
+
+    std::size_t hex_size = 2 * id_size;
+    if(hex_prefix.size() < MIN_PREFIX_LENGTH || hex_prefix.size() > hex_size || !open())
+    {
+        return PrefixMatch::None;
+    }
+
+    std::string prefix(hex_prefix);
+    for(auto& digit : prefix)
+    {
+        if(!std::isxdigit(static_cast<unsigned char>(digit)))
+        {
+            return PrefixMatch::None;
+        }
+        digit = static_cast<char>(std::tolower(static_cast<unsigned char>(digit)));
+    }
+
+    // The smallest id with this prefix is the prefix padded with zeros
+    ObjectId lowest;
+    ObjectId::from_hex(prefix + std::string(hex_size - prefix.size(), '0'), lowest);
+
+    std::vector<ObjectId> matches;
+    for(std::size_t position = lower_bound(lowest); position < sorted_count() && matches.size() < 2; position++)
+    {
+        ObjectId candidate = sorted_id(position);
+        if(!has_hex_prefix(candidate, prefix))
+        {
+            break;
+        }
+        matches.push_back(candidate);
+    }
+    for(auto const& candidate : loose)
+    {
+        if(has_hex_prefix(candidate, prefix) && std::find(matches.begin(), matches.end(), candidate) == matches.end())
+        {
+            matches.push_back(candidate);
+        }
+    }
+
+    if(matches.empty())
+    {
+        return PrefixMatch::None;
+    }
+    if(matches.size() > 1)
+    {
+        return PrefixMatch::Ambiguous;
+    }
+    id = matches.front();
+    return PrefixMatch::Unique;
+}
+
+std::size_t ObjectIndex::unique_prefix_length(const ObjectId& id, std::size_t min_length)
+// Shortest prefix length (at least min_length) that no other indexed id shares.
+// In sorted order only the two neighbours of id can share a longer prefix than any other id.
+{
+    std::size_t length = std::min(min_length, id.hex_size());
+    if(!open())
+    {
+        return id.hex_size();
+    }
+
+    auto extend = [&](const ObjectId& other)
+    {
+        if(other != id)
+        {
+            length = std::max(length, std::min(common_hex_prefix(id, other) + 1, id.hex_size()));
+        }
+    };
+
+    std::size_t position = lower_bound(id);
+    if(position > 0)
+    {
+        extend(sorted_id(position - 1));
+    }
+    if(position < sorted_count())
+    {
+        extend(sorted_id(position));
+    }
+    if(position + 1 < sorted_count())
+    {
+        extend(sorted_id(position + 1));
+    }
+    for(auto const& other : loose)
+    {
+        extend(other);
+    }
+    return length;
+}
+
+void ObjectIndex::insert(const std::vector<ObjectId>& ids)
+// Records newly written objects. The ids are appended to the loose list, which is merged into the
+// sorted index once it holds more than LOOSE_LIMIT ids.
+{
+    if(ids.empty())
+    {
+        return;
+    }
+
+    if(!std::filesystem::exists(index_path))
+    {
+        // The ids are already in the source, so a rebuild picks them up
+        rebuild();
+        return;
+    }
+
+    {
+        std::ofstream loose_file(loose_path, std::ios::binary | std::ios::app);
+        for(auto const& id : ids)
+        {
+            loose_file.write(reinterpret_cast<const char*>(id.data()), id_size);
+        }
+    }
+
+    std::error_code error;
+    if(std::filesystem::file_size(loose_path, error) / id_size > LOOSE_LIMIT && !error)
+    {
+        TraceSpan span("compact_object_index");
+
+        opened = false;
+        if(open())
+        {
+            std::vector<ObjectId> all_ids;
+            all_ids.reserve(sorted_count() + loose.size());
+            sorted.clear();
+            sorted.seekg(INDEX_HEADER_SIZE);
+            ObjectId id;
+            for(std::size_t i = 0; i < sorted_count() && read_id(sorted, id_size, id); i++)
+            {
+                all_ids.push_back(id);
+            }
+            all_ids.insert(all_ids.end(), loose.begin(), loose.end());
+            write_sorted(all_ids);
+        }
+    }
+    opened = false;
+}
+
+void ObjectIndex::rebuild()
+// Recreates the index from its source (the names in the object directory, by default).
+{
+    TraceSpan span("rebuild_object_index");
+
+    std::vector<ObjectId> ids;
+    list_ids(ids);
+    span.add_counter("ids", ids.size());
+
+    write_sorted(ids);
+    opened = false;
+}
+
+void ObjectIndex::write_sorted(std::vector<ObjectId>& ids) const
+// Sorts ids and replaces the index with them, then empties the loose list.
+// The file is written under a temporary name and renamed, so readers never see a partial index.
+{
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    std::error_code error;
+    std::filesystem::create_directories(index_path.parent_path(), error);
+    std::filesystem::path temporary_path = index_path.string() + ".tmp";
+    {
+        std::ofstream index_file(temporary_path, std::ios::binary | std::ios::trunc);
+        index_file.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+        write_be32(index_file, INDEX_VERSION);
+
+        std::size_t position = 0;
+        for(int b = 0; b < 256; b++)
+        {
+            while(position < ids.size() && ids[position].data()[0] == b)
+            {
+                position++;
+            }
+            write_be32(index_file, static_cast<std::uint32_t>(position));
+        }
+        for(auto const& id : ids)
+        {
+            index_file.write(reinterpret_cast<const char*>(id.data()), id_size);
+        }
+    }
+    // Fails for read-only (e.g. shared alternate) directories; the index then stays unavailable
+    std::filesystem::rename(temporary_path, index_path, error);
+    if(error)
+    {
+        std::filesystem::remove(temporary_path, error);
+        return;
+    }
+    std::filesystem::remove(loose_path, error);
+}
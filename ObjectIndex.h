@@ -0,0 +1,69 @@
+#ifndef _OBJECT_INDEX_H_
+#define _OBJECT_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+#include "ObjectId.h"
+
+enum class PrefixMatch
+{
+    None,
+    Unique,
+    Ambiguous
+};
+
+class ObjectIndex
+// Sorted lookup index over a set of ids: those in an object directory (objects/commits), or those listed by
+// another source such as a branch log.
+//
+// <index> holds the ids sorted, preceded by a 256 entry fan-out table: entry b is the number of ids whose first
+// byte is <= b, so the ids starting with a given byte are found without searching. Lookups binary search that range
+// with one small read per step, so they are O(log n) regardless of the number of objects.
+// New ids are appended unsorted to <index>.loose and folded into the sorted file once LOOSE_LIMIT have accumulated,
+// which bounds the linear part of a lookup. A missing or damaged index is rebuilt from its source.
+//
+// All ids in one index have the repository's id size; an index with another size is treated as damaged.
+//
+// File layout (integers big-endian): "MGIX", version, fanout[256], ids[fanout[255]].
+{
+    public:
+        typedef std::function<void(std::vector<ObjectId>& ids)> IdSource;
+
+        ObjectIndex(const std::filesystem::path& objects_path, const std::filesystem::path& index_path, std::size_t id_size);
+        ObjectIndex(IdSource list_ids, const std::filesystem::path& index_path, std::size_t id_size);
+
+        void insert(const std::vector<ObjectId>& ids);
+        void rebuild();
+
+        bool contains(const ObjectId& id);
+        PrefixMatch resolve(std::string_view hex_prefix, ObjectId& id);
+        std::size_t unique_prefix_length(const ObjectId& id, std::size_t min_length);
+
+        static const std::size_t MIN_PREFIX_LENGTH = MINIGIT_MIN_ABBREV_LENGTH;
+        static const std::size_t LOOSE_LIMIT = 1024;
+
+    private:
+        bool open();
+        std::size_t sorted_count() const { return fanout[255]; }
+        ObjectId sorted_id(std::size_t position);
+        std::size_t lower_bound(const ObjectId& id);
+        void write_sorted(std::vector<ObjectId>& ids) const;
+
+        IdSource list_ids;
+        std::size_t id_size;
+        std::filesystem::path index_path;
+        std::filesystem::path loose_path;
+
+        bool opened = false;
+        std::ifstream sorted;
+        std::uint32_t fanout[256] {};
+        std::vector<ObjectId> loose;
+};
+
+#endif
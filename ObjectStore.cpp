@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "MiniGit.h"
+#include "ObjectStore.h"
+
+ObjectStore::ObjectStore(const std::filesystem::path& objects_path) : objects_path(objects_path)
+// objects_path is the .minigit/objects directory of a repository, by default the one in the current directory.
+{
+    load_alternates(objects_path, 0);
+}
+
+void ObjectStore::load_alternates(const std::filesystem::path& directory, int depth)
+// Appends the alternates listed by the object directory, then theirs, skipping directories already known.
+{
+    if(depth >= MAX_ALTERNATE_DEPTH)
+    {
+        return;
+    }
+
+    std::ifstream alternates_file(directory / "info" / "alternates");
+    std::string line;
+    while(std::getline(alternates_file, line))
+    {
+        if(line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        std::filesystem::path alternate {line};
+        if(alternate.is_relative())
+        {
+            alternate = directory / alternate;
+        }
+
+        std::error_code error;
+        alternate = std::filesystem::weakly_canonical(alternate, error);
+        if(error || std::find(alternates.begin(), alternates.end(), alternate) != alternates.end())
+        {
+            continue;
+        }
+
+        alternates.push_back(alternate);
+        load_alternates(alternate, depth + 1);
+    }
+}
+
+std::filesystem::path ObjectStore::object_path(const std::filesystem::path& directory, ObjectType type, const ObjectId& id)
+{
+    const char* type_directory = type == ObjectType::Blob ? "blobs" : type == ObjectType::Commit ? "commits" :
+        type == ObjectType::Chunk ? "chunks" : "chunk-lists";
+    return directory / type_directory / id.to_hex();
+}
+
+std::filesystem::path ObjectStore::local_path(ObjectType type, const ObjectId& id) const
+// Where a new object of this repository is written.
+{
+    return object_path(objects_path, type, id);
+}
+
+std::filesystem::path ObjectStore::find(ObjectType type, const ObjectId& id) const
+// Returns the path of the object in the first directory that has it, or its local path if none does.
+{
+    std::filesystem::path path = local_path(type, id);
+    if(alternates.empty() || std::filesystem::exists(path))
+    {
+        return path;
+    }
+
+    for(auto const& alternate : alternates)
+    {
+        std::filesystem::path alternate_path = object_path(alternate, type, id);
+        if(std::filesystem::exists(alternate_path))
+        {
+            return alternate_path;
+        }
+    }
+    return path;
+}
+
+bool ObjectStore::contains(ObjectType type, const ObjectId& id) const
+{
+    return std::filesystem::exists(find(type, id));
+}
+
+std::filesystem::path ObjectStore::find_blob(const ObjectId& id, bool& chunked) const
+// Returns the path of the blob, or of its chunk list if it is stored chunked (chunked is set accordingly).
+{
+    std::filesystem::path path = find(ObjectType::Blob, id);
+    chunked = !std::filesystem::exists(path) && contains(ObjectType::ChunkList, id);
+    return chunked ? find(ObjectType::ChunkList, id) : path;
+}
+
+bool ObjectStore::contains_blob(const ObjectId& id) const
+// Whether the blob is stored, whole or as a chunk list.
+{
+    return contains(ObjectType::Blob, id) || contains(ObjectType::ChunkList, id);
+}
+
+bool ObjectStore::add_alternate(const std::filesystem::path& alternate_path, std::string& error)
+// Records alternate_path (a .minigit/objects directory, or a repository containing one) as an alternate.
+{
+    std::filesystem::path alternate = alternate_path;
+    if(std::filesystem::exists(alternate / MINIGIT_OBJECTS_PATH))
+    {
+        alternate /= MINIGIT_OBJECTS_PATH;
+    }
+
+    std::error_code canonical_error;
+    alternate = std::filesystem::canonical(alternate, canonical_error);
+    if(canonical_error || !std::filesystem::is_directory(alternate / "blobs") || 
+            !std::filesystem::is_directory(alternate / "commits"))
+    {
+        error = alternate_path.string() + " is not an object directory.";
+        return false;
+    }
+    if(alternate == std::filesystem::weakly_canonical(objects_path))
+    {
+        error = "A repository cannot use its own object directory as an alternate.";
+        return false;
+    }
+    if(std::find(alternates.begin(), alternates.end(), alternate) != alternates.end())
+    {
+        return true;
+    }
+
+    std::filesystem::create_directories(objects_path / "info");
+    std::ofstream(objects_path / "info" / "alternates", std::ios::app) << alternate.string() << '\n';
+
+    alternates.push_back(alternate);
+    load_alternates(alternate, 1);
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef _OBJECT_STORE_H_
+#define _OBJECT_STORE_H_
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "MiniGit.h"
+#include "ObjectId.h"
+
+enum class ObjectType
+{
+    Blob,
+    Commit,
+    Chunk, // piece of a large blob, see Chunking.h
+    ChunkList // a large blob stored as the list of its chunks, kept apart from blobs so file bytes are never read as one
+};
+
+class ObjectStore
+// Locates objects in the repository's own object directory and in shared, read-only object directories
+// listed in .minigit/objects/info/alternates (one path per line, absolute or relative to .minigit/objects).
+// Alternates of alternates are followed as well. Reads fall through to the first directory holding the object;
+// new objects are only written locally, and only if no directory holds them yet.
+// gc never removes objects from an alternate, but pruning a shared directory can break the repositories using it.
+{
+    public:
+        explicit ObjectStore(const std::filesystem::path& objects_path = MINIGIT_OBJECTS_PATH);
+
+        std::filesystem::path find(ObjectType type, const ObjectId& id) const;
+        bool contains(ObjectType type, const ObjectId& id) const;
+        std::filesystem::path local_path(ObjectType type, const ObjectId& id) const;
+        std::filesystem::path find_blob(const ObjectId& id, bool& chunked) const;
+        bool contains_blob(const ObjectId& id) const;
+
+        const std::vector<std::filesystem::path>& get_alternates() const { return alternates; }
+        bool add_alternate(const std::filesystem::path& alternate_path, std::string& error);
+
+        static const int MAX_ALTERNATE_DEPTH = 5;
+
+    private:
+        void load_alternates(const std::filesystem::path& directory, int depth);
+        static std::filesystem::path object_path(const std::filesystem::path& directory, ObjectType type, const ObjectId& id);
+
+        std::filesystem::path objects_path;
+        std::vector<std::filesystem::path> alternates; // object directories, in lookup order after the local one
+};
+
+#endif
@@ -0,0 +1,75 @@
+#include <sstream>
+
+#include "OutputWriter.h"
+
+OutputWriter::OutputWriter(std::FILE* stream) : stream(stream)
+{
+    buffer.reserve(FLUSH_THRESHOLD);
+}
+
+OutputWriter::~OutputWriter()
+{
+    flush();
+}
+
+void OutputWriter::set_nul_terminated(bool nul_terminated)
+{
+    record_terminator = nul_terminated ? '\0' : '\n';
+}
+
+void OutputWriter::end_record()
+{
+    *this << record_terminator;
+}
+
+void OutputWriter::flush()
+// Writes the buffered output in a single call.
+{
+    if(!buffer.empty())
+    {
+        std::fwrite(buffer.data(), 1, buffer.size(), stream);
+        std::fflush(stream);
+        buffer.clear();
+    }
+}
+
+OutputWriter& OutputWriter::operator<<(std::string_view text)
+{
+    buffer.append(text);
+    if(buffer.size() >= FLUSH_THRESHOLD)
+    {
+        flush();
+    }
+    return *this;
+}
+
+OutputWriter& OutputWriter::operator<<(const char* text)
+{
+    return *this << std::string_view(text);
+}
+
+OutputWriter& OutputWriter::operator<<(const std::string& text)
+{
+    return *this << std::string_view(text);
+}
+
+OutputWriter& OutputWriter::operator<<(char character)
+{
+    return *this << std::string_view(&character, 1);
+}
+
+OutputWriter& OutputWriter::operator<<(const std::filesystem::path& path)
+// Paths are quoted, matching how std::ostream prints them.
+{
+    std::ostringstream quoted;
+    quoted << path;
+    return *this << quoted.str();
+}
+
+OutputWriter& OutputWriter::operator<<(const ObjectId& id)
+// Ids are written as hex, straight into the buffer.
+{
+    char hex[ObjectId::MAX_HEX_SIZE];
+    id.to_hex(hex);
+    return *this << std::string_view(hex, id.hex_size());
+}
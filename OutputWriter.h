@@ -0,0 +1,49 @@
+#ifndef _OUTPUT_WRITER_H_
+#define _OUTPUT_WRITER_H_
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "ObjectId.h"
+
+class OutputWriter
+// Buffers command output and writes it with as few write calls as possible.
+// The buffer is flushed when it grows past FLUSH_THRESHOLD and when the writer is destroyed.
+// end_record() terminates a machine-readable record with '\n', or with '\0' in NUL-terminated (-z) mode.
+{
+    public:
+        explicit OutputWriter(std::FILE* stream);
+        ~OutputWriter();
+
+        OutputWriter(const OutputWriter&) = delete;
+        OutputWriter& operator=(const OutputWriter&) = delete;
+
+        void set_nul_terminated(bool nul_terminated);
+        void end_record();
+        void flush();
+
+        OutputWriter& operator<<(std::string_view text);
+        OutputWriter& operator<<(const char* text);
+        OutputWriter& operator<<(const std::string& text);
+        OutputWriter& operator<<(char character);
+        OutputWriter& operator<<(const std::filesystem::path& path);
+        OutputWriter& operator<<(const ObjectId& id);
+
+        template<typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+        OutputWriter& operator<<(T value)
+        {
+            return *this << std::string_view(std::to_string(value));
+        }
+
+        static const std::size_t FLUSH_THRESHOLD = 1 << 20;
+
+    private:
+        std::FILE* stream;
+        std::string buffer;
+        char record_terminator = '\n';
+};
+
+#endif
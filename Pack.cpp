@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "Hash.h"
+#include "Pack.h"
+#include "Trace.h"
+
+static const char PACK_MAGIC[4] = {'M', 'G', 'P', 'K'};
+static const std::uint32_t PACK_VERSION = 2;
+static const std::size_t PACK_HEADER_SIZE = sizeof(PACK_MAGIC) + 4 + 4 + 4;
+static const std::size_t OBJECT_HEADER_MAX_SIZE = 1 + ObjectId::MAX_SIZE + 8 + 8;
+static const std::size_t PACK_TRAILER_SIZE = 20;
+static const std::size_t COPY_BUFFER_SIZE = 64 * 1024;
+
+static void put_be(unsigned char* bytes, std::uint64_t value, int size)
+{
+    for(int i = size - 1; i >= 0; i--)
+    {
+        bytes[i] = static_cast<unsigned char>(value);
+        value >>= 8;
+    }
+}
+
+static std::uint64_t get_be(const unsigned char* bytes, int size)
+{
+    std::uint64_t value = 0;
+    for(int i = 0; i < size; i++)
+    {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+class HashingWriter
+// Writes to the pack file and feeds the same bytes to the trailer checksum.
+{
+    public:
+        explicit HashingWriter(const std::filesystem::path& path) : file(path, std::ios::binary | std::ios::trunc) {}
+
+        void write(const void* data, std::size_t size)
+        {
+            file.write(static_cast<const char*>(data), size);
+            checksum.update(data, size);
+            written += size;
+        }
+
+        void finish()
+        {
+            ObjectId digest = checksum.finish();
+            file.write(reinterpret_cast<const char*>(digest.data()), PACK_TRAILER_SIZE);
+            written += PACK_TRAILER_SIZE;
+        }
+
+        std::uint64_t size() const { return written; }
+
+    private:
+        std::ofstream file;
+        HashStream checksum {HashAlgorithm::Sha1};
+        std::uint64_t written = 0;
+};
+
+std::uint64_t write_pack(const std::filesystem::path& pack_path, const std::vector<PackObject>& objects, std::size_t id_size)
+// Writes the objects, whose ids are id_size bytes, into one pack file and returns its size.
+// Object data is streamed, never held whole in memory.
+{
+    TraceSpan span("write_pack");
+
+    HashingWriter pack(pack_path);
+
+    unsigned char header[PACK_HEADER_SIZE];
+    std::memcpy(header, PACK_MAGIC, sizeof(PACK_MAGIC));
+    put_be(header + 4, PACK_VERSION, 4);
+    put_be(header + 8, id_size, 4);
+    put_be(header + 12, objects.size(), 4);
+    pack.write(header, sizeof(header));
+    std::size_t object_header_size = 1 + id_size + 8 + 8;
+
+    std::vector<char> buffer(COPY_BUFFER_SIZE);
+    for(auto const& object : objects)
+    {
+        std::uint64_t size = std::filesystem::file_size(object.path);
+        auto timestamp = std::filesystem::last_write_time(object.path).time_since_epoch().count();
+
+        unsigned char object_header[OBJECT_HEADER_MAX_SIZE];
+        object_header[0] = object.type == ObjectType::Blob ? 'b' : object.type == ObjectType::Commit ? 'c' :
+            object.type == ObjectType::Chunk ? 'k' : 'l';
+        std::memcpy(object_header + 1, object.id.data(), id_size);
+        put_be(object_header + 1 + id_size, static_cast<std::uint64_t>(timestamp), 8);
+        put_be(object_header + 9 + id_size, size, 8);
+        pack.write(object_header, object_header_size);
+
+        std::ifstream source(object.path, std::ios::binary);
+        for(std::uint64_t remaining = size; remaining > 0; )
+        {
+            std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(remaining, buffer.size()));
+            if(!source.read(buffer.data(), chunk))
+            {
+                throw std::filesystem::filesystem_error("object changed while packing", object.path,
+                    std::make_error_code(std::errc::io_error));
+            }
+            pack.write(buffer.data(), chunk);
+            remaining -= chunk;
+        }
+    }
+    pack.finish();
+
+    span.add_counter(TRACE_BYTES_WRITTEN, pack.size());
+    return pack.size();
+}
+
+static bool verify_trailer(const std::filesystem::path& pack_path)
+// Compares the SHA-1 of the pack contents with its trailer.
+{
+    std::error_code error;
+    std::uint64_t size = std::filesystem::file_size(pack_path, error);
+    if(error || size < PACK_HEADER_SIZE + PACK_TRAILER_SIZE)
+    {
+        return false;
+    }
+
+    std::ifstream pack(pack_path, std::ios::binary);
+    HashStream checksum(HashAlgorithm::Sha1);
+    std::vector<char> buffer(COPY_BUFFER_SIZE);
+    for(std::uint64_t remaining = size - PACK_TRAILER_SIZE; remaining > 0; )
+    {
+        std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(remaining, buffer.size()));
+        if(!pack.read(buffer.data(), chunk))
+        {
+            return false;
+        }
+        checksum.update(buffer.data(), chunk);
+        remaining -= chunk;
+    }
+
+    ObjectId digest = checksum.finish();
+
+    char trailer[PACK_TRAILER_SIZE];
+    return pack.read(trailer, sizeof(trailer)) && std::memcmp(trailer, digest.data(), sizeof(trailer)) == 0;
+}
+
+bool read_pack(const std::filesystem::path& pack_path, const ObjectStore& destination, std::vector<ObjectId>& commits)
+// Unpacks the objects the destination does not have yet into its local object directories and appends the ids
+// of the new commits to commits. Each object is written under a temporary name and renamed once complete.
+// Returns false, before writing anything, if the pack is damaged.
+{
+    TraceSpan span("read_pack");
+
+    if(!verify_trailer(pack_path))
+    {
+        return false;
+    }
+
+    std::uint64_t data_end = std::filesystem::file_size(pack_path) - PACK_TRAILER_SIZE;
+    std::ifstream pack(pack_path, std::ios::binary);
+
+    unsigned char header[PACK_HEADER_SIZE];
+    if(!pack.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+        !std::equal(PACK_MAGIC, PACK_MAGIC + sizeof(PACK_MAGIC), header) || get_be(header + 4, 4) != PACK_VERSION ||
+        get_be(header + 8, 4) == 0 || get_be(header + 8, 4) > ObjectId::MAX_SIZE)
+    {
+        return false;
+    }
+
+    std::size_t id_size = static_cast<std::size_t>(get_be(header + 8, 4));
+    std::size_t object_header_size = 1 + id_size + 8 + 8;
+    std::uint64_t count = get_be(header + 12, 4);
+    std::uint64_t written = 0;
+    std::vector<char> buffer(COPY_BUFFER_SIZE);
+    for(std::uint64_t i = 0; i < count; i++)
+    {
+        unsigned char object_header[OBJECT_HEADER_MAX_SIZE];
+        if(!pack.read(reinterpret_cast<char*>(object_header), object_header_size) ||
+            (object_header[0] != 'b' && object_header[0] != 'c' && object_header[0] != 'k' && object_header[0] != 'l'))
+        {
+            return false;
+        }
+
+        ObjectType type = object_header[0] == 'b' ? ObjectType::Blob : 
+            object_header[0] == 'c' ? ObjectType::Commit : object_header[0] == 'k' ? ObjectType::Chunk : ObjectType::ChunkList;
+        ObjectId id = ObjectId::from_bytes(object_header + 1, id_size);
+        auto timestamp = static_cast<std::filesystem::file_time_type::rep>(get_be(object_header + 1 + id_size, 8));
+        std::uint64_t size = get_be(object_header + 9 + id_size, 8);
+        if(size > data_end - static_cast<std::uint64_t>(pack.tellg()))
+        {
+            return false;
+        }
+
+        if(destination.contains(type, id))
+        {
+            pack.seekg(size, std::ios::cur);
+            continue;
+        }
+
+        std::filesystem::path object_path = destination.local_path(type, id);
+        std::filesystem::path temporary_path = object_path.string() + ".tmp";
+        if(type == ObjectType::Chunk || type == ObjectType::ChunkList)
+        {
+            // Repositories without large files have no chunk directories yet
+            std::filesystem::create_directories(object_path.parent_path());
+        }
+        {
+            std::ofstream object(temporary_path, std::ios::binary | std::ios::trunc);
+            for(std::uint64_t remaining = size; remaining > 0; )
+            {
+                std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(remaining, buffer.size()));
+                pack.read(buffer.data(), chunk);
+                object.write(buffer.data(), chunk);
+                remaining -= chunk;
+            }
+        }
+        std::filesystem::last_write_time(temporary_path,
+            std::filesystem::file_time_type(std::filesystem::file_time_type::duration(timestamp)));
+        std::filesystem::rename(temporary_path, object_path);
+        written += size;
+
+        if(type == ObjectType::Commit)
+        {
+            commits.push_back(id);
+        }
+    }
+
+    span.add_counter(TRACE_BYTES_WRITTEN, written);
+    return true;
+}
@@ -0,0 +1,31 @@
+#ifndef _PACK_H_
+#define _PACK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "ObjectId.h"
+#include "ObjectStore.h"
+
+// Object transfer between repositories in a single packed stream.
+//
+// A pack holds the objects one after another, each with its type, id, last write time (blob ids depend on it)
+// and size, and ends with the SHA-1 of everything before it. The receiver checks the trailer before it unpacks
+// anything, so a truncated or damaged pack leaves its object directory untouched.
+//
+// File layout (integers big-endian): "MGPK", version, id size, object count,
+// objects[count] {type ('b', 'c', 'k' for a chunk or 'l' for a chunk list), id[id size], last write time (int64), size (uint64), data[size]}, sha1[20].
+
+typedef struct PackObject
+{
+    ObjectType type;
+    ObjectId id;
+    std::filesystem::path path; // where the sender stores the object
+} PackObject;
+
+std::uint64_t write_pack(const std::filesystem::path& pack_path, const std::vector<PackObject>& objects, std::size_t id_size);
+bool read_pack(const std::filesystem::path& pack_path, const ObjectStore& destination, std::vector<ObjectId>& commits);
+
+#endif
@@ -0,0 +1,126 @@
+#include <algorithm>
+
+#include "PathMap.h"
+
+PathTable& PathTable::instance()
+{
+    static PathTable table;
+    return table;
+}
+
+PathId PathTable::intern(std::string_view path)
+// Returns the id of path, adding it to the table if it has not been seen before.
+{
+    std::lock_guard<std::mutex> lock(intern_mutex);
+
+    if(auto search = ids.find(path); search != ids.end())
+    {
+        return search->second;
+    }
+
+    PathId id = static_cast<PathId>(paths.size());
+    paths.emplace_back(path);
+    ids.emplace(paths.back(), id);
+    return id;
+}
+
+const ObjectId* PathMap::find(std::string_view path) const
+// Binary search by path. Returns nullptr if the path is not in the map.
+{
+    const PathTable& table = PathTable::instance();
+    auto search = std::lower_bound(entries.begin(), entries.end(), path,
+        [&table](const PathEntry& entry, std::string_view key) { return table.path(entry.path) < key; });
+
+    if(search != entries.end() && table.path(search->path) == path)
+    {
+        return &search->id;
+    }
+    return nullptr;
+}
+
+void PathMap::set(std::string_view path, const ObjectId& id)
+// Inserts or replaces a single entry.
+{
+    const PathTable& table = PathTable::instance();
+    auto search = std::lower_bound(entries.begin(), entries.end(), path,
+        [&table](const PathEntry& entry, std::string_view key) { return table.path(entry.path) < key; });
+
+    if(search != entries.end() && table.path(search->path) == path)
+    {
+        search->id = id;
+    }
+    else
+    {
+        entries.insert(search, {PathTable::instance().intern(path), id});
+    }
+}
+
+void PathMap::set(std::vector<PathEntry> updates)
+// Inserts or replaces many entries with one sort of the updates and one linear merge.
+// When a path appears several times in updates the last occurrence wins.
+{
+    const PathTable& table = PathTable::instance();
+    auto by_path = [&table](const PathEntry& a, const PathEntry& b) { return table.compare(a.path, b.path) < 0; };
+
+    std::stable_sort(updates.begin(), updates.end(), by_path);
+
+    std::vector<PathEntry> merged;
+    merged.reserve(entries.size() + updates.size());
+
+    auto current = entries.begin();
+    for(std::size_t i = 0; i < updates.size(); i++)
+    {
+        if(i + 1 < updates.size() && updates[i + 1].path == updates[i].path)
+        {
+            continue;
+        }
+
+        while(current != entries.end() && by_path(*current, updates[i]))
+        {
+            merged.push_back(*current++);
+        }
+        if(current != entries.end() && current->path == updates[i].path)
+        {
+            ++current;
+        }
+        merged.push_back(updates[i]);
+    }
+    merged.insert(merged.end(), current, entries.end());
+
+    entries = std::move(merged);
+}
+
+void PathMap::push_back(PathId path, const ObjectId& id)
+// Appends an entry. The caller must append in path order, as merge_join produces it.
+{
+    entries.push_back({path, id});
+}
+
+bool PathMap::operator==(const PathMap& other) const
+{
+    return entries.size() == other.entries.size() &&
+        std::equal(entries.begin(), entries.end(), other.entries.begin(),
+            [](const PathEntry& a, const PathEntry& b) { return a.path == b.path && a.id == b.id; });
+}
+
+void to_json(nlohmann::json& json_data, const PathMap& path_map)
+{
+    json_data = nlohmann::json::object();
+    for(auto const& entry : path_map)
+    {
+        json_data[path_of(entry)] = entry.id;
+    }
+}
+
+void from_json(const nlohmann::json& json_data, PathMap& path_map)
+// JSON objects iterate in key order, which is also PathMap order, so no sort is needed.
+{
+    PathTable& table = PathTable::instance();
+
+    path_map.clear();
+    path_map.reserve(json_data.size());
+    for(auto const& [path, id] : json_data.items())
+    {
+        path_map.push_back(table.intern(path), id.get<ObjectId>());
+    }
+}
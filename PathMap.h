@@ -0,0 +1,142 @@
+#ifndef _PATH_MAP_H_
+#define _PATH_MAP_H_
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "ObjectId.h"
+
+typedef std::uint32_t PathId;
+
+class PathTable
+// Process-wide table of interned paths. Each distinct path string is stored once and referred to by a PathId,
+// so the index, HEAD and merge inputs share their path strings.
+// intern() may be called from several threads; path() may run concurrently with other path() calls
+// but not with intern().
+{
+    public:
+        static PathTable& instance();
+
+        PathId intern(std::string_view path);
+        const std::string& path(PathId id) const { return paths[id]; }
+
+        // Orders ids by their path strings, the order PathMap entries are kept in
+        int compare(PathId a, PathId b) const
+        {
+            return a == b ? 0 : paths[a].compare(paths[b]);
+        }
+
+    private:
+        PathTable() = default;
+
+        std::mutex intern_mutex;
+        std::deque<std::string> paths;
+        std::unordered_map<std::string_view, PathId> ids; // views into paths
+};
+
+typedef struct PathEntry
+{
+    PathId path;
+    ObjectId id;
+} PathEntry;
+
+class PathMap
+// Flat map from path to object id, kept as a vector sorted by path string.
+// Two maps can be compared with a single linear merge-join (see merge_join below).
+{
+    public:
+        typedef std::vector<PathEntry>::const_iterator const_iterator;
+
+        const_iterator begin() const { return entries.begin(); }
+        const_iterator end() const { return entries.end(); }
+        std::size_t size() const { return entries.size(); }
+        bool empty() const { return entries.empty(); }
+        void reserve(std::size_t count) { entries.reserve(count); }
+        void clear() { entries.clear(); }
+
+        const ObjectId* find(std::string_view path) const;
+        void set(std::string_view path, const ObjectId& id);
+        void set(std::vector<PathEntry> updates);
+        void push_back(PathId path, const ObjectId& id);
+
+        bool operator==(const PathMap& other) const;
+
+    private:
+        std::vector<PathEntry> entries;
+};
+
+inline const std::string& path_of(const PathEntry& entry)
+{
+    return PathTable::instance().path(entry.path);
+}
+
+template<typename Visitor>
+void merge_join(const PathMap& left, const PathMap& right, Visitor visit)
+// Calls visit(path, left_id, right_id) once per path present in either map, in path order.
+// An id pointer is null when the path is missing from that map.
+{
+    const PathTable& table = PathTable::instance();
+    auto l = left.begin();
+    auto r = right.begin();
+
+    while(l != left.end() || r != right.end())
+    {
+        int order = (l == left.end()) ? 1 : (r == right.end()) ? -1 : table.compare(l->path, r->path);
+        PathId path = order <= 0 ? l->path : r->path;
+        const ObjectId* left_id = order <= 0 ? &l->id : nullptr;
+        const ObjectId* right_id = order >= 0 ? &r->id : nullptr;
+
+        visit(path, left_id, right_id);
+
+        if(order <= 0) ++l;
+        if(order >= 0) ++r;
+    }
+}
+
+template<typename Visitor>
+void merge_join(const PathMap& first, const PathMap& second, const PathMap& third, Visitor visit)
+// Three-way variant: calls visit(path, first_id, second_id, third_id) once per path present in any map.
+{
+    const PathTable& table = PathTable::instance();
+    auto a = first.begin();
+    auto b = second.begin();
+    auto c = third.begin();
+
+    while(a != first.end() || b != second.end() || c != third.end())
+    {
+        // Smallest path among the three cursors
+        const PathEntry* smallest = nullptr;
+        for(const PathEntry* candidate : {a != first.end() ? &*a : nullptr,
+                                          b != second.end() ? &*b : nullptr,
+                                          c != third.end() ? &*c : nullptr})
+        {
+            if(candidate && (!smallest || table.compare(candidate->path, smallest->path) < 0))
+            {
+                smallest = candidate;
+            }
+        }
+        PathId path = smallest->path;
+
+        const ObjectId* first_id = (a != first.end() && a->path == path) ? &a->id : nullptr;
+        const ObjectId* second_id = (b != second.end() && b->path == path) ? &b->id : nullptr;
+        const ObjectId* third_id = (c != third.end() && c->path == path) ? &c->id : nullptr;
+
+        visit(path, first_id, second_id, third_id);
+
+        if(first_id) ++a;
+        if(second_id) ++b;
+        if(third_id) ++c;
+    }
+}
+
+void to_json(nlohmann::json& json_data, const PathMap& path_map);
+void from_json(const nlohmann::json& json_data, PathMap& path_map);
+
+#endif
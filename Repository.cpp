@@ -1,23 +1,189 @@
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <ctime>
 #include <filesystem>
 #include <fstream>
-#include <iomanip>
-#include <iostream>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <stack>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <nlohmann/json.hpp>
-#include <openssl/sha.h>
+#include <sys/stat.h>
 
+#include "Blame.h"
+#include "ChangedPaths.h"
+#include "Chunking.h"
+#include "Grep.h"
+#include "Hash.h"
 #include "Log.h"
+#include "Materializer.h"
+#include "Merge.h"
 #include "MiniGit.h"
+#include "Pack.h"
 #include "Repository.h"
+#include "RepositoryImpl.h"
+#include "SparseCheckout.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "UntrackedCache.h"
 
-void Repository::init()
-// Initializes the .minigit repository and subdirectories
+Repository::Repository() : impl(std::make_unique<RepositoryImpl>())
 {
+}
+
+Repository::~Repository() = default;
+
+InitResult Repository::init(HashAlgorithm algorithm)
+{
+    return impl->init(algorithm);
+}
+
+StatusResult Repository::status() const
+{
+    return impl->status();
+}
+
+StatusResult Repository::status(const StatusVisitor& visit, const std::function<void(const StatusResult&)>& begin) const
+{
+    return impl->status(visit, begin);
+}
+
+AddResult Repository::add(const std::vector<std::string>& filenames)
+{
+    return impl->add(filenames);
+}
+
+CommitResult Repository::commit(const std::string& message)
+{
+    return impl->commit(message);
+}
+
+RevertResult Repository::revert(const std::string& commit_id)
+{
+    return impl->revert(commit_id);
+}
+
+LogResult Repository::log(std::size_t abbrev_min_length, const std::string& path, bool stat) const
+{
+    return impl->log(abbrev_min_length, path, stat);
+}
+
+ShowResult Repository::show(const std::string& commit_id) const
+{
+    return impl->show(commit_id);
+}
+
+BlameResult Repository::blame(const std::string& filename) const
+{
+    return impl->blame(filename);
+}
+
+GrepResult Repository::grep(const std::string& pattern, const std::string& commit_id) const
+{
+    return impl->grep(pattern, commit_id);
+}
+
+CheckoutResult Repository::checkout(const std::string& branch)
+{
+    return impl->checkout(branch);
+}
+
+BranchResult Repository::create_branch(const std::string& branch)
+{
+    return impl->create_branch(branch);
+}
+
+BranchListResult Repository::list_branches() const
+{
+    return impl->list_branches();
+}
+
+MergeResult Repository::merge(const std::string& branch)
+{
+    return impl->merge(branch);
+}
+
+CountObjectsResult Repository::count_objects() const
+{
+    return impl->count_objects();
+}
+
+GcResult Repository::gc(long long prune_grace_seconds)
+{
+    return impl->gc(prune_grace_seconds);
+}
+
+FsckResult Repository::fsck(const ProgressCallback& progress) const
+{
+    return impl->fsck(progress);
+}
+
+SparseCheckoutResult Repository::sparse_checkout_list() const
+{
+    return impl->sparse_checkout_list();
+}
+
+SparseCheckoutResult Repository::sparse_checkout_set(const std::vector<std::string>& patterns)
+{
+    return impl->sparse_checkout_set(patterns);
+}
+
+AlternatesResult Repository::list_alternates() const
+{
+    return impl->list_alternates();
+}
+
+AlternatesResult Repository::add_alternate(const std::string& objects_path)
+{
+    return impl->add_alternate(objects_path);
+}
+
+TransferResult Repository::clone(const std::string& source)
+{
+    return impl->clone(source);
+}
+
+TransferResult Repository::fetch(const std::string& remote)
+{
+    return impl->fetch(remote);
+}
+
+TransferResult Repository::push(const std::string& remote, const std::string& branch)
+{
+    return impl->push(remote, branch);
+}
+
+WorktreeResult Repository::add_worktree(const std::string& path, const std::string& branch)
+{
+    return impl->add_worktree(path, branch);
+}
+
+WorktreeResult Repository::list_worktrees() const
+{
+    return impl->list_worktrees();
+}
+
+WorktreeResult Repository::prune_worktrees()
+{
+    return impl->prune_worktrees();
+}
+
+RepositoryImpl::RepositoryImpl() : common_root(find_common_root()), object_store(common_root / MINIGIT_OBJECTS_PATH),
+    hasher(read_hash_algorithm(common_root))
+{
+}
+
+InitResult RepositoryImpl::init(HashAlgorithm algorithm)
+// Initializes the .minigit repository and subdirectories, and records the hash algorithm of its objects in the config
+{
+    TraceSpan span("init");
+
+    InitResult result;
     bool repo_initialized = initialized();
 
     if(!repo_initialized)
@@ -39,93 +205,129 @@ void Repository::init()
             {
                 if (std::filesystem::create_directory(dir_name)) 
                 {
-                    std::cout << "Initialized MiniGit repository in: " << dir_name << std::endl;
+                    result.created_directories.push_back(dir_name);
                 } 
                 else 
                 {
-                    std::cout << "Error: Directory " << dir_name << " already exists or failed to create.\n";
+                    result.error = {ErrorCode::FilesystemError, 
+                        "Directory " + dir_name.string() + " already exists or failed to create."};
                 }
             }
         } 
         catch (const std::filesystem::filesystem_error& e) 
         {
-            std::cerr << "Error: " << e.what() << '\n';
+            result.error = {ErrorCode::FilesystemError, e.what()};
         }
 
         // We are now on branch master, so write this information into HEAD
         std::ofstream head(MINIGIT_HEAD_PATH.string());
         head << MINIGIT_MASTER_BRANCH_NAME;
         head.close();
+
+        nlohmann::json config;
+        config["object_format"] = hash_algorithm_name(algorithm);
+        std::ofstream config_file(MINIGIT_CONFIG_PATH.string());
+        config_file << config.dump(4);
+        config_file.close();
+        hasher = ObjectHasher(algorithm);
     }
     else
     {
-        std::cout << "Repository already initialized." << std::endl;
+        result.error = {ErrorCode::AlreadyInitialized, "Repository already initialized."};
     }
+
+    return result;
 }
 
-void Repository::add(const std::vector<std::string>& filenames)
+AddResult RepositoryImpl::add(const std::vector<std::string>& filenames)
 // Adds filenames to the staging area. 
+// All files are stat'ed first and their hashes (from their metadata) computed in one batch. The blobs that must
+// be written are then handed in order to a thread pool, so one file's copy overlaps the copying of the next ones.
+// At most MINIGIT_ADD_QUEUE_DEPTH blobs per worker are queued or being written at a time.
+// The index is updated once all blobs are written.
 // The repository must be initialized.
 {
+    TraceSpan span("add");
+
+    AddResult result;
     bool is_initialized = initialized();
 
     if(!is_initialized)
     {
-        std::cout << "Error: Repository not initialized." << std::endl;
+        result.error = not_initialized_error();
     }
     else
     {
         // First load the existing index, then update any entries if applicable
-        std::unordered_map<std::string, std::string> tracked_files;
+        PathMap tracked_files;
         load_tracked_files(tracked_files);
+        std::vector<PathEntry> index_updates;
+        std::unordered_set<ObjectId> queued_blobs;
 
-        for(auto filename : filenames)
+        std::vector<std::string> found;
+        std::vector<std::string> hash_inputs;
+        for(auto const& filename : filenames)
         {
             if (std::filesystem::exists(filename))
             {
-                // First try to see if this file is already in the index, if so check if hash has changed
-                auto search = tracked_files.find(filename);
-                
-                // If the file is not in the index or is in the index but the hash has changed 
-                // add the file to the index and copy the file
-                std::string current_hash = get_file_hash(filename);
-                if((search == tracked_files.end()) || 
-                        ((search != tracked_files.end()) && (search->second != current_hash)))
-                {
-                    tracked_files[filename] = current_hash;
-                    // Save blob for files that are staged, since this is the version that should be commited even
-                    // the file is modified before the next commit.
-
-                    std::filesystem::path dest_file_path = MINIGIT_BLOBS_PATH / current_hash;
-                    std::filesystem::copy_file(filename, 
-                        dest_file_path, 
-                        std::filesystem::copy_options::none);
-
-                    // Make sure to copy timestamp as well, otherwise the hash will differ 
-                    auto timestamp = std::filesystem::last_write_time(filename);
-                    std::filesystem::last_write_time(dest_file_path,  timestamp);                    
-                    
-                    std::cout << "Added " << filename << std::endl;                
-                }             
+                found.push_back(filename);
+                hash_inputs.push_back(file_hash_input(filename));
             }
             else
             {
-                std::cout << "ERROR: file " << filename << " did not match any files." << std::endl;
+                result.not_found.push_back(filename);
             }
         }
+        std::vector<ObjectId> hashes;
+        hasher.hash_batch(hash_inputs, hashes);
 
+        ThreadPool pool(static_cast<unsigned>(std::min<std::size_t>(found.size(), std::thread::hardware_concurrency())));
+        for(std::size_t i = 0; i < found.size(); i++)
+        {
+            const std::string& filename = found[i];
+            const ObjectId& current_hash = hashes[i];
+
+            // First try to see if this file is already in the index, if so check if hash has changed
+            const ObjectId* search = tracked_files.find(filename);
+            
+            // If the file is not in the index or is in the index but the hash has changed 
+            // add the file to the index and copy the file
+            if(search == nullptr || *search != current_hash)
+            {
+                index_updates.push_back({PathTable::instance().intern(filename), current_hash});
+                // Save blob for files that are staged, since this is the version that should be commited even
+                // the file is modified before the next commit.
+
+                if(queued_blobs.insert(current_hash).second && !object_store.contains_blob(current_hash))
+                {
+                    pool.wait_below(MINIGIT_ADD_QUEUE_DEPTH * pool.size());
+                    pool.submit([this, filename, current_hash] { store_blob(filename, current_hash); });
+                }
+                
+                result.added.push_back(filename);
+            }             
+        }
+
+        pool.wait();
+
+        tracked_files.set(std::move(index_updates));
         write_tracked_files(tracked_files);
     }
+
+    return result;
 }
 
-void Repository::commit(const std::string& message)
+CommitResult RepositoryImpl::commit(const std::string& message)
 // Save a snapshot of the files in the staging area. The commit data is saved in the log.
 // Repository must be initialized.
 {
+    TraceSpan span("commit");
+
+    CommitResult result;
     bool is_initialized = initialized();
     if(!is_initialized)
     {
-        std::cout << "Error: Repository not initialized." << std::endl;
+        result.error = not_initialized_error();
     }
     else
     {
@@ -138,7 +340,7 @@ void Repository::commit(const std::string& message)
 
         if(!staged.size())
         {
-            std::cout << "Nothing to commit." << std::endl;
+            result.error = {ErrorCode::NothingToCommit, "Nothing to commit."};
         }
         else // There are files to be commited
         {
@@ -147,15 +349,14 @@ void Repository::commit(const std::string& message)
             LogEntry log_entry;
             
             load_tracked_files(commit.file_hashes);
-            // TODO: Read author name from config file               
-            commit.author = "Author";
+            commit.author = author_name();
             log_entry.author = commit.author;
             auto now = std::chrono::system_clock::now();
             commit.timestamp = timepoint_to_string(now);
             log_entry.timestamp = commit.timestamp;
             commit.message = message;    
             log_entry.message = commit.message;    
-            commit.id = sha1(commit.author + commit.timestamp + commit.message);
+            commit.id = hash(commit.author + commit.timestamp + commit.message);
             log_entry.new_commit_id = commit.id;
             // Retrieve parent commit info
             CommitInfo parent_commit_info;
@@ -167,11 +368,7 @@ void Repository::commit(const std::string& message)
             {
                 std::filesystem::remove(MINIGIT_MERGING_FLAG_PATH);
                 
-                std::ifstream merge_head(MINIGIT_MERGE_HEAD_PATH.string());
-                std::stringstream buffer;
-                buffer << merge_head.rdbuf();
-                std::string other_commit_id = buffer.str();
-                merge_head.close();
+                ObjectId other_commit_id = read_ref(MINIGIT_MERGE_HEAD_PATH);
 
                 commit.parent_2_id = other_commit_id;
                 log_entry.merge = true;
@@ -183,36 +380,33 @@ void Repository::commit(const std::string& message)
             }    
             
             // Write commit ID in corresponding branch file
-            std::filesystem::path file_path = MINIGIT_BRANCHES_PATH / get_current_branch();
-            std::ofstream branch_file(file_path.string());
-            branch_file << commit.id;
-            branch_file.close();
+            write_ref(common_root / MINIGIT_BRANCHES_PATH / get_current_branch(), commit.id);
 
             // Write JSON file containing commit info 
             write_commit_info(commit);
 
             // log commit both in logs/HEAD and in logs/refs/heads/<branch_id>
             write_log_entry(MINIGIT_HEAD_LOG_PATH.string(), log_entry);
-            write_log_entry((MINIGIT_BRANCHES_LOG_PATH / get_current_branch()).string(), log_entry);
+            write_branch_log_entry(get_current_branch(), log_entry);
 
-            std::cout << "Committed: " << std::endl;
+            result.commit_id = commit.id;
             // List only the files that are in the index but are not in the previous commit or the hash has changed.
             // Under the hood all staged files hashes are saved in the commit info JSON file. 
-            for(auto const& pair : commit.file_hashes)
+            merge_join(commit.file_hashes, parent_commit_info.file_hashes, 
+                [&result](PathId path, const ObjectId* hash, const ObjectId* parent_hash)
             {
-                auto search = parent_commit_info.file_hashes.find(pair.first);
-                if(search == parent_commit_info.file_hashes.end() ||
-                        (search != parent_commit_info.file_hashes.end() && 
-                            search->second != pair.second))
+                if(hash != nullptr && (parent_hash == nullptr || *parent_hash != *hash))
                 {
-                    std::cout << "\t" << pair.first << std::endl;
-                }  
-            }
+                    result.changed_files.push_back(PathTable::instance().path(path));
+                }
+            });
         }
     }
+
+    return result;
 }
 
-void Repository::revert(const std::string& commit_id)
+RevertResult RepositoryImpl::revert(const std::string& commit_id)
 // Revert to an old commit id. Files in the working directory are replaced with the versions
 // associated with the commit id. The history is kept intact and a new commit is generated
 // and logged for this change.
@@ -220,10 +414,13 @@ void Repository::revert(const std::string& commit_id)
 // Revert not allowed if there are staged or unmodified changes.
 // Revert only allowed with a commit id from the history of the current branch.
 {
+    TraceSpan span("revert");
+
+    RevertResult result;
     bool is_initialized = initialized();
     if(!is_initialized)
     {
-        std::cout << "Error: Repository not initialized." << std::endl;
+        result.error = not_initialized_error();
     }
     else
     {
@@ -236,204 +433,391 @@ void Repository::revert(const std::string& commit_id)
 
         if(staged.size() || modified.size())
         {
-            std::cout << "ERROR: Cannot revert while there are modified or staged (uncommitted) files." << std::endl;
-            
-            if(staged.size())
-            {
-                std::cout << "Changes to be committed:" << std::endl;
-                for(auto file : staged)
-                {
-                    std::cout << "\t" << file << std::endl;
-                }
-            }
-
-            if(modified.size())
-            {
-                std::cout << "Changes not staged for commit:" << std::endl;
-                for(auto file : modified)
-                {
-                    std::cout << "\t" << file << std::endl;
-                }
-            }                 
+            result.error = {ErrorCode::UncommittedChanges, 
+                "Cannot revert while there are modified or staged (uncommitted) files."};
+            result.blocking_changes = {staged, modified};
         }
         else // There are no staged or modified files
         {
 
-            if(!is_revert_commit_id_valid(commit_id))
+            ObjectId revert_commit_id;
+            result.error = resolve_commit_id(commit_id, revert_commit_id);
+            if(!result.error && !is_revert_commit_id_valid(revert_commit_id))
             {
-                std::cout << "ERROR: commit id is not valid for this branch." << std::endl; 
+                result.error = {ErrorCode::InvalidCommitId, "commit id is not valid for this branch."};
             }
-            else
+            if(!result.error)
             {
                 // Assemble commit info and log entry
                 CommitInfo commit;
                 LogEntry log_entry;
                             
-                commit.author = "Author";
+                commit.author = author_name();
                 log_entry.author = commit.author;
                 auto now = std::chrono::system_clock::now();
                 commit.timestamp = timepoint_to_string(now);
                 log_entry.timestamp = commit.timestamp;
-                commit.message = "Reverting to " + commit_id;    
+                commit.message = "Reverting to " + revert_commit_id.to_hex();    
                 log_entry.message = commit.message;    
-                commit.id = sha1(commit.author + commit.timestamp + commit.message);
+                commit.id = hash(commit.author + commit.timestamp + commit.message);
                 log_entry.new_commit_id = commit.id;
                 // Retrieve parent commit info
                 CommitInfo parent_commit_info;
                 get_previous_commit_info(parent_commit_info);
                 commit.parent_1_id = parent_commit_info.id;
                 log_entry.old_commit_id = parent_commit_info.id;
+                log_entry.merge = false;
 
                 // First retrieve old commit info 
                 CommitInfo old_commit_info;
-                load_commit_info(commit_id, old_commit_info);
+                load_commit_info(revert_commit_id, old_commit_info);
 
                 // Retrieve file hashes from the old commit
-                for(auto const& pair : old_commit_info.file_hashes)
+                commit.file_hashes = old_commit_info.file_hashes;
+                SparseCheckout sparse_checkout;
+                sparse_checkout.load(MINIGIT_SPARSE_CHECKOUT_PATH);
+                Materializer materializer;
+                for(auto const& entry : old_commit_info.file_hashes)
                 {
-                    commit.file_hashes[pair.first] = pair.second;
-                    
                     // If the current hash is different from the old hash, 
                     // move blobs associated with old commit id back to working directory
+                    const std::string& filename = path_of(entry);
 
-                    std::string current_hash = get_file_hash(pair.first);
-
-                    if(current_hash != pair.second)
+                    if(!sparse_checkout.includes(filename))
+                    {
+                        continue;
+                    }
+                    if(!std::filesystem::exists(filename) || get_file_hash(filename) != entry.id)
                     {
-                        // remove file from working directory first
-                        std::filesystem::remove(pair.first);
-                        // now replace it with old version
-                        std::filesystem::path source_file_path = MINIGIT_BLOBS_PATH / pair.second;
-                        std::filesystem::copy_file(
-                            source_file_path, 
-                            pair.first, 
-                            std::filesystem::copy_options::none);
-
-                        // Make sure to copy timestamp as well, otherwise the hash will differ
-                        auto timestamp = std::filesystem::last_write_time(source_file_path);
-                        std::filesystem::last_write_time(pair.first,  timestamp);
-                      
+                        add_blob(materializer, entry.id, filename);
                     }        
                 }
+                materializer.run();
 
                 // Write index file to match old commit info file hashes
                 write_tracked_files(old_commit_info.file_hashes);
 
                 // Write commit ID in corresponding branch file
-                std::filesystem::path file_path = MINIGIT_BRANCHES_PATH / get_current_branch();
-                std::ofstream branch_file(file_path.string());
-                branch_file << commit.id;
-                branch_file.close();
+                write_ref(common_root / MINIGIT_BRANCHES_PATH / get_current_branch(), commit.id);
 
                 // Write JSON file containing commit info 
                 write_commit_info(commit);
 
                 // log commit both in logs/HEAD and in logs/refs/heads/<branch_id>
                 write_log_entry(MINIGIT_HEAD_LOG_PATH.string(), log_entry);
-                write_log_entry((MINIGIT_BRANCHES_LOG_PATH / get_current_branch()).string(), log_entry);
+                write_branch_log_entry(get_current_branch(), log_entry);
+
+                result.commit_id = commit.id;
             }
         }
     }   
+
+    return result;
 }
 
-void Repository::print_log() const
-// Print log information for the current branch (list of commits) in reverse chronological order. 
+LogResult RepositoryImpl::log(std::size_t abbrev_min_length, const std::string& path, bool stat) const
+// Returns log information for the current branch (list of commits) in reverse chronological order. 
+// If abbrev_min_length is set, abbrev_length is the shortest length (at least abbrev_min_length)
+// at which every listed commit id is still unique among all commits.
+// If path is set, only the commits that changed it (compared with their first parent) are listed.
+// If stat is set, changes holds the files each listed commit changed, read from the commit's change list.
 // Repository must be initialized.
 {
+    TraceSpan span("log");
+
+    LogResult result;
     bool is_initialized = initialized();
     if(!is_initialized)
     {
-        std::cout << "Error: Repository not initialized." << std::endl;
+        result.error = not_initialized_error();
     }
     else
     {    
-        std::vector<LogEntry> entries;
-        read_log((MINIGIT_BRANCHES_LOG_PATH / get_current_branch()).string(), entries);
+        read_log((common_root / MINIGIT_BRANCHES_LOG_PATH / get_current_branch()).string(), result.entries);
+
+        // Newest entry first
+        std::reverse(result.entries.begin(), result.entries.end());
+
+        if(!path.empty())
+        {
+            ChangedPathIndex changed_path_index(common_root / MINIGIT_CHANGED_PATHS_PATH, hasher.id_size());
+            result.entries.erase(std::remove_if(result.entries.begin(), result.entries.end(), [&](const LogEntry& entry)
+            {
+                return !commit_changed_path(changed_path_index, entry.new_commit_id, path);
+            }), result.entries.end());
+        }
+
+        if(abbrev_min_length > 0)
+        {
+            std::vector<ObjectIndex> indexes = commit_indexes();
+            result.abbrev_length = std::min(abbrev_min_length, 2 * hasher.id_size());
+            for(auto const& entry : result.entries)
+            {
+                for(const ObjectId* id : {&entry.new_commit_id, &entry.old_commit_id, &entry.other_commit_id})
+                {
+                    for(auto& commit_index : indexes)
+                    {
+                        if(!id->is_null())
+                        {
+                            result.abbrev_length = std::max(result.abbrev_length, 
+                                commit_index.unique_prefix_length(*id, abbrev_min_length));
+                        }
+                    }
+                }
+            }
+        }
+
+        if(stat)
+        {
+            result.changes.resize(result.entries.size());
+            for(std::size_t i = 0; i < result.entries.size(); i++)
+            {
+                CommitInfo commit_info;
+                if(load_commit_info(result.entries[i].new_commit_id, commit_info))
+                {
+                    get_commit_changes(commit_info, result.changes[i]);
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+ShowResult RepositoryImpl::show(const std::string& commit_id) const
+// Returns the commit with the given id (or unique id prefix) and the files it changed.
+// Repository must be initialized.
+{
+    TraceSpan span("show");
+
+    ShowResult result;
+    bool is_initialized = initialized();
+    if(!is_initialized)
+    {
+        result.error = not_initialized_error();
+    }
+    else
+    {
+        ObjectId id;
+        result.error = resolve_commit_id(commit_id, id);
+        if(!result.error && !load_commit_info(id, result.commit))
+        {
+            result.error = {ErrorCode::InvalidCommitId, "commit id is not valid."};
+        }
+        if(!result.error)
+        {
+            get_commit_changes(result.commit, result.changes);
+        }
+    }
+
+    return result;
+}
+
+BlameResult RepositoryImpl::blame(const std::string& filename) const
+// Returns each line of the file at the head of the current branch with the commit that last changed it.
+// Repository must be initialized.
+{
+    TraceSpan span("blame");
+
+    BlameResult result;
+    bool is_initialized = initialized();
+    if(!is_initialized)
+    {
+        result.error = not_initialized_error();
+    }
+    else
+    {
+        CommitInfo head;
+        get_previous_commit_info(head);
+        if(head.id.is_null())
+        {
+            result.error = {ErrorCode::NoCommitsOnBranch, 
+                "There are no commits on the current branch: " + get_current_branch()};
+        }
+        else if(head.file_hashes.find(filename) == nullptr)
+        {
+            result.error = {ErrorCode::PathNotFound, "no such path " + filename + " in HEAD."};
+        }
+        else
+        {
+            FileLines file;
+            read_blob_lines(*head.file_hashes.find(filename), file);
+            std::vector<ObjectId> origins;
+            blame_lines(head, filename, origins);
+            origins.resize(file.lines.size());
+
+            std::unordered_map<ObjectId, CommitInfo> origin_commits;
+            for(std::size_t i = 0; i < file.lines.size(); i++)
+            {
+                BlameLine line;
+                line.commit_id = origins[i];
+                auto search = origin_commits.find(line.commit_id);
+                if(search == origin_commits.end())
+                {
+                    search = origin_commits.emplace(line.commit_id, CommitInfo()).first;
+                    load_commit_info(line.commit_id, search->second);
+                }
+                line.author = search->second.author;
+                line.timestamp = search->second.timestamp;
+                line.text = file.lines[i];
+                result.lines.push_back(std::move(line));
+            }
+        }
+    }
+
+    return result;
+}
 
-        // Print in reverse order (newest entry first)
-        while(entries.size())
+GrepResult RepositoryImpl::grep(const std::string& pattern, const std::string& commit_id) const
+// Returns the lines matching the pattern (ECMAScript regular expression) in the tracked files of the working
+// tree or, if commit_id is set, in the files of that commit, read straight from the object store.
+// The files are searched in parallel.
+// Repository must be initialized.
+{
+    TraceSpan span("grep");
+
+    GrepResult result;
+    LinePattern line_pattern;
+    PathMap files;
+    bool is_initialized = initialized();
+    if(!is_initialized)
+    {
+        result.error = not_initialized_error();
+    }
+    else if(!line_pattern.compile(pattern))
+    {
+        result.error = {ErrorCode::InvalidPattern, "invalid pattern: " + pattern};
+    }
+    else if(!commit_id.empty())
+    {
+        ObjectId id;
+        CommitInfo commit_info;
+        result.error = resolve_commit_id(commit_id, id);
+        if(!result.error && !load_commit_info(id, commit_info))
         {
-            auto const& entry = entries.back();
-            std::cout <<"commit " << entry.new_commit_id << std::endl;
+            result.error = {ErrorCode::InvalidCommitId, "commit id is not valid."};
+        }
+        files = std::move(commit_info.file_hashes);
+    }
+    else
+    {
+        load_tracked_files(files);
+    }
+
+    if(!result.error)
+    {
+        SparseCheckout sparse_checkout;
+        sparse_checkout.load(MINIGIT_SPARSE_CHECKOUT_PATH);
 
-            if(entry.merge)
+        std::vector<std::vector<GrepMatch>> file_matches(files.size());
+        ThreadPool pool;
+        parallel_for(pool, files.size(), [&](std::size_t begin, std::size_t end)
+        {
+            std::vector<std::size_t> matching_lines;
+            for(std::size_t i = begin; i < end; i++)
             {
-                std::cout << "Merge " + entry.old_commit_id + " " + entry.other_commit_id << std::endl;
+                const PathEntry& entry = *(files.begin() + i);
+                const std::string& path = path_of(entry);
+                if(commit_id.empty() && !sparse_checkout.includes(path))
+                {
+                    continue;
+                }
+
+                FileLines file;
+                if(commit_id.empty() ? !read_lines(path, file) : !read_blob_lines(entry.id, file))
+                {
+                    continue;
+                }
+
+                matching_lines.clear();
+                line_pattern.search(file, matching_lines);
+                for(auto line : matching_lines)
+                {
+                    file_matches[i].push_back({path, line + 1, std::string(file.lines[line])});
+                }
             }
-           
-            std::cout <<"Author: " << entry.author << std::endl;
-            std::cout <<"Date: " << entry.timestamp << std::endl;
-            std::cout << std::endl;
-            std::cout << entry.message;
-            std::cout << std::endl << std::endl;
+        });
 
-            //Remove the last element
-            entries.pop_back();
+        for(auto& matches : file_matches)
+        {
+            std::move(matches.begin(), matches.end(), std::back_inserter(result.matches));
         }
+        span.add_counter(TRACE_FILES_STATED, files.size());
     }
+
+    return result;
 }
 
-void Repository::create_branch(const std::string& branch)
+BranchResult RepositoryImpl::create_branch(const std::string& branch)
 // Creates a new branch but does not switch to it.  
 // Precondition: There is at least a commit on the current branch
 {
+    TraceSpan span("create_branch");
+
+    BranchResult result;
+    result.branch = branch;
+
     // First check if repository is initialized
     bool is_initialized = initialized();
     if(!is_initialized)
     {
-        std::cout << "Error: Repository not initialized." << std::endl;
+        result.error = not_initialized_error();
     }
     else
     { 
         // Can only create a new branch if there is at least a commit on the current branch
 
-        std::filesystem::path file_path = MINIGIT_BRANCHES_PATH / get_current_branch();
+        std::filesystem::path file_path = common_root / MINIGIT_BRANCHES_PATH / get_current_branch();
         if(!std::filesystem::exists(file_path))
         {
-            std::cout << "ERROR: Cannot create new branch since there are no commits on the current branch: " 
-                << get_current_branch() 
-                << std::endl;
+            result.error = {ErrorCode::NoCommitsOnBranch, 
+                "Cannot create new branch since there are no commits on the current branch: " + get_current_branch()};
         }
         else
         {
             // Copy head commit id to the branch head file
-            std::ifstream head(file_path.string());  
-            std::stringstream buffer;
-            buffer << head.rdbuf();
-            std::string commit_id = buffer.str();
-            head.close();
-            std::filesystem::path branch_file_path = MINIGIT_BRANCHES_PATH / branch;
-            std::ofstream branch_file(branch_file_path.string());
-            branch_file << commit_id;
-            branch_file.close();        
+            ObjectId commit_id = read_ref(file_path);
+            write_ref(common_root / MINIGIT_BRANCHES_PATH / branch, commit_id);
 
             // Copy last log entry for the current branch to the new branch log file
             std::vector<LogEntry> entries;
-            read_log((MINIGIT_BRANCHES_LOG_PATH / get_current_branch()).string(), entries);   
-            write_log_entry((MINIGIT_BRANCHES_LOG_PATH / branch).string(), entries.back());
+            read_log((common_root / MINIGIT_BRANCHES_LOG_PATH / get_current_branch()).string(), entries);   
+            write_branch_log_entry(branch, entries.back());
+
+            result.commit_id = commit_id;
         }
     }
+
+    return result;
 }
 
-void Repository::checkout(const std::string& branch)
+CheckoutResult RepositoryImpl::checkout(const std::string& branch)
 // Checkout a branch (the index is reset to the last commit of the new branch, so is the working directory)
 // Preconditions: - repository is initialized
 //                - branch must exist
 //                - there are no staged or modified files
 {
+    TraceSpan span("checkout");
+
+    CheckoutResult result;
+
     // First check if repository is initialized
     bool is_initialized = initialized();
     if(!is_initialized)
     {
-        std::cout << "Error: Repository not initialized." << std::endl;
+        result.error = not_initialized_error();
     }
     else
     { 
         // Check if the branch exists
-        const std::filesystem::path branch_path = MINIGIT_BRANCHES_PATH / branch;
+        const std::filesystem::path branch_path = common_root / MINIGIT_BRANCHES_PATH / branch;
         if(!std::filesystem::exists(branch_path))
         {
-            std::cout << "ERROR: Branch does not exist." << std::endl;
+            result.error = {ErrorCode::BranchNotFound, "Branch does not exist."};
+        }
+        else if(branch != get_current_branch() && is_checked_out(branch))
+        {
+            result.error = {ErrorCode::BranchCheckedOut, "Branch " + branch + " is checked out in another working tree."};
         }
         else // branch exists
         {
@@ -446,35 +830,14 @@ void Repository::checkout(const std::string& branch)
 
             if(staged.size() || modified.size())
             {
-                std::cout << "ERROR: Cannot checkout another branch while there are modified or staged (uncommitted) files." << std::endl;
-                
-                if(staged.size())
-                {
-                    std::cout << "Changes to be committed:" << std::endl;
-                    for(auto file : staged)
-                    {
-                        std::cout << "\t" << file << std::endl;
-                    }
-                }
-
-                if(modified.size())
-                {
-                    std::cout << "Changes not staged for commit:" << std::endl;
-                    for(auto file : modified)
-                    {
-                        std::cout << "\t" << file << std::endl;
-                    }
-                }                 
+                result.error = {ErrorCode::UncommittedChanges, 
+                    "Cannot checkout another branch while there are modified or staged (uncommitted) files."};
+                result.blocking_changes = {staged, modified};
             }
             else // Preconditions are met, branch can be checked out
             {
                 // Retrieve old HEAD id 
-                std::filesystem::path file_path = MINIGIT_BRANCHES_PATH / get_current_branch();
-                std::ifstream branch_head(file_path.string());  
-                std::stringstream buffer;
-                buffer << branch_head.rdbuf();
-                std::string old_commit_id = buffer.str();
-                branch_head.close();
+                ObjectId old_commit_id = read_ref(common_root / MINIGIT_BRANCHES_PATH / get_current_branch());
 
                 // Point HEAD to the new branch
                 std::ofstream head(MINIGIT_HEAD_PATH.string());
@@ -487,89 +850,90 @@ void Repository::checkout(const std::string& branch)
                 write_tracked_files(commit_info.file_hashes);
 
                 // Replace the working directory to the latest commit of the new branch
-                
-                for(auto const& pair : commit_info.file_hashes)
+                // (only the paths selected by sparse checkout)
+                SparseCheckout sparse_checkout;
+                sparse_checkout.load(MINIGIT_SPARSE_CHECKOUT_PATH);
+                Materializer materializer;
+                for(auto const& entry : commit_info.file_hashes)
                 {
-                    // remove file from working directory first, if it exists
-                    if(std::filesystem::exists(pair.first))
+                    if(sparse_checkout.includes(path_of(entry)))
                     {
-                        std::filesystem::remove(pair.first);
+                        add_blob(materializer, entry.id, path_of(entry));
                     }
-                   
-                    // now replace it with latest version in the new branch
-                    std::filesystem::copy_file(
-                        MINIGIT_BLOBS_PATH / pair.second, 
-                        pair.first, 
-                        std::filesystem::copy_options::none);
-
-                    // Make sure to copy timestamp as well, otherwise the hash will differ
-                    auto timestamp = std::filesystem::last_write_time(MINIGIT_BLOBS_PATH / pair.second);
-                    std::filesystem::last_write_time(pair.first, timestamp);
                 }
+                materializer.run();
 
                 // Now log this HEAD change in the HEAD log
                 LogEntry log_entry;
-                // TODO: Read author name from config file               
-                log_entry.author = "Author";
+                log_entry.author = author_name();
                 auto now = std::chrono::system_clock::now();
                 log_entry.timestamp = timepoint_to_string(now);
                 log_entry.message = "Switched to branch " + branch;    
                 log_entry.new_commit_id = commit_info.id;
                 log_entry.old_commit_id = old_commit_id;
+                log_entry.merge = false;
 
                 // log commit both in logs/HEAD and in logs/refs/heads/<branch_id>
                 write_log_entry(MINIGIT_HEAD_LOG_PATH.string(), log_entry);
 
+                result.commit_id = commit_info.id;
             }         
         }
     }
+
+    return result;
 }
 
-void Repository::print_branches()
-// Prints the list of existing branches
+BranchListResult RepositoryImpl::list_branches() const
+// Returns the list of existing branches
 {
+    TraceSpan span("list_branches");
+
+    BranchListResult result;
     bool is_initialized = initialized();
 
     if(!is_initialized)
     {
-        std::cout << "Error: Repository not initialized." << std::endl;
+        result.error = not_initialized_error();
     }
     else
     {
-        std::vector<std::string> branches;
-
-        for(auto const& dir_entry : std::filesystem::directory_iterator {MINIGIT_BRANCHES_PATH})
+        for(auto const& dir_entry : std::filesystem::directory_iterator {common_root / MINIGIT_BRANCHES_PATH})
         {
             if(dir_entry.is_regular_file())
             {
-                branches.push_back(dir_entry.path().filename().string());
+                result.branches.push_back(dir_entry.path().filename().string());
             }     
         } 
 
         // Sort in order to have consistent output on Linux/Windows 
-        std::sort(branches.begin(), branches.end());
-        for(auto branch : branches)
-        {
-            std::cout << branch << std::endl;
-        }
+        std::sort(result.branches.begin(), result.branches.end());
     } 
+
+    return result;
 }
 
-void Repository::merge(const std::string& branch)
+MergeResult RepositoryImpl::merge(const std::string& branch)
 // Merges the branch into the current branch
 {
+    TraceSpan span("merge");
+
+    MergeResult result;
+    result.branch = branch;
     bool is_initialized = initialized();
 
     if(!is_initialized)
     {
-        std::cout << "Error: Repository not initialized." << std::endl;
+        result.error = not_initialized_error();
     }
     else
     {
+        result.current_branch = get_current_branch();
+
         // Check if branch name is valid
         bool branch_valid = false;
 
-        for(auto const& dir_entry : std::filesystem::directory_iterator {MINIGIT_BRANCHES_PATH})
+        for(auto const& dir_entry : std::filesystem::directory_iterator {common_root / MINIGIT_BRANCHES_PATH})
         {
             if(dir_entry.is_regular_file() && dir_entry.path().filename().string() == branch )
             {
@@ -579,7 +943,7 @@ void Repository::merge(const std::string& branch)
         } 
         if(!branch_valid)
         {
-            std::cout << "ERROR: no such branch: " + branch << std::endl;
+            result.error = {ErrorCode::BranchNotFound, "no such branch: " + branch};
         }
         else
         {
@@ -592,41 +956,28 @@ void Repository::merge(const std::string& branch)
 
             if(staged.size() || modified.size())
             {
-                std::cout << "ERROR: Cannot merge in branch while there are modified or staged (uncommitted) files." << std::endl;
-                
-                if(staged.size())
-                {
-                    std::cout << "Changes to be committed:" << std::endl;
-                    for(auto file : staged)
-                    {
-                        std::cout << "\t" << file << std::endl;
-                    }
-                }
-
-                if(modified.size())
-                {
-                    std::cout << "Changes not staged for commit:" << std::endl;
-                    for(auto file : modified)
-                    {
-                        std::cout << "\t" << file << std::endl;
-                    }
-                }                 
+                result.error = {ErrorCode::UncommittedChanges, 
+                    "Cannot merge in branch while there are modified or staged (uncommitted) files."};
+                result.blocking_changes = {staged, modified};
             }
             else // All preconditions are met, proceed with merge
             {
                 // First find the common ancestor
                 bool ancestor_found = false;
                 std::vector<LogEntry> entries_branch_1;
-                read_log((MINIGIT_BRANCHES_LOG_PATH / get_current_branch()).string(), entries_branch_1);
-                std::string last_commit_branch_1  = entries_branch_1.back().new_commit_id;
+                read_log((common_root / MINIGIT_BRANCHES_LOG_PATH / get_current_branch()).string(), entries_branch_1);
+                ObjectId last_commit_branch_1  = entries_branch_1.back().new_commit_id;
                 std::vector<LogEntry> entries_branch_2;
-                read_log((MINIGIT_BRANCHES_LOG_PATH / branch).string(), entries_branch_2);
+                read_log((common_root / MINIGIT_BRANCHES_LOG_PATH / branch).string(), entries_branch_2);
                 LogEntry last_entry_branch_2 = entries_branch_2.back();
-                std::string last_commit_branch_2  = entries_branch_2.back().new_commit_id;
-                std::string ancestor_id;
+                ObjectId last_commit_branch_2  = entries_branch_2.back().new_commit_id;
+                ObjectId ancestor_id;
                 bool conflict = false;
                 bool merge_performed = false;
 
+                result.old_commit_id = last_commit_branch_1;
+                result.other_commit_id = last_commit_branch_2;
+
                 while(!ancestor_found && entries_branch_2.size())
                 {
                     auto entry_2 = entries_branch_2.back();
@@ -645,15 +996,19 @@ void Repository::merge(const std::string& branch)
 
                 if (!ancestor_found)
                 {
-                    std::cout <<"ERROR: common ancestor not found." << std::endl;
+                    result.error = {ErrorCode::AncestorNotFound, "common ancestor not found."};
+                    return result;
                 }
                 else if (ancestor_id == last_commit_branch_2)
                 {
-                    std::cout << "Already up to date." << std::endl;
+                    result.outcome = MergeOutcome::UpToDate;
+                    result.new_commit_id = last_commit_branch_1;
+                    return result;
                 }
                 else
                 {
-                    perform_merge(ancestor_id, last_commit_branch_1, last_commit_branch_2, merge_performed, conflict);
+                    perform_merge(ancestor_id, last_commit_branch_1, last_commit_branch_2, merge_performed, conflict,
+                        result.conflicted_files);
                 }
 
                 if(!merge_performed)
@@ -661,19 +1016,15 @@ void Repository::merge(const std::string& branch)
                     // This was a fast-forward merge, so advance HEAD and copy the last commit entry of branch 2 to branch 1 
                     
                     // Write commit ID in corresponding branch file
-                    std::filesystem::path file_path = MINIGIT_BRANCHES_PATH / get_current_branch();
-                    std::ofstream branch_file(file_path.string());
-                    branch_file << last_commit_branch_2;
-                    branch_file.close();                    
+                    write_ref(common_root / MINIGIT_BRANCHES_PATH / get_current_branch(), last_commit_branch_2);
                     
                     // log commit both in logs/HEAD and in logs/refs/heads/<branch_id>
                     last_entry_branch_2.old_commit_id = last_commit_branch_1;
                     write_log_entry(MINIGIT_HEAD_LOG_PATH.string(), last_entry_branch_2);
-                    write_log_entry((MINIGIT_BRANCHES_LOG_PATH / get_current_branch()).string(), last_entry_branch_2);
+                    write_branch_log_entry(get_current_branch(), last_entry_branch_2);
 
-                    // Confirm fast-forward merge was performed 
-                    std::cout <<"Fast-forward " << last_commit_branch_1 << " to " << last_commit_branch_2 << std::endl;
-                    
+                    result.outcome = MergeOutcome::FastForward;
+                    result.new_commit_id = last_commit_branch_2;
                 }
                 else if(!conflict)
                 {
@@ -683,15 +1034,14 @@ void Repository::merge(const std::string& branch)
                     LogEntry log_entry;
                     
                     load_tracked_files(commit.file_hashes);
-                    // TODO: Read author name from config file               
-                    commit.author = "Author";
+                    commit.author = author_name();
                     log_entry.author = commit.author;
                     auto now = std::chrono::system_clock::now();
                     commit.timestamp = timepoint_to_string(now);
                     log_entry.timestamp = commit.timestamp;
                     commit.message = "Merged " + branch + " into " + get_current_branch();    
                     log_entry.message = commit.message;    
-                    commit.id = sha1(commit.author + commit.timestamp + commit.message);
+                    commit.id = hash(commit.author + commit.timestamp + commit.message);
                     log_entry.new_commit_id = commit.id;
                     commit.parent_1_id = last_commit_branch_1;
                     commit.parent_2_id = last_commit_branch_2;
@@ -700,534 +1050,2316 @@ void Repository::merge(const std::string& branch)
                     log_entry.other_commit_id = last_commit_branch_2;
 
                     // Write commit ID in corresponding branch file
-                    std::filesystem::path file_path = MINIGIT_BRANCHES_PATH / get_current_branch();
-                    std::ofstream branch_file(file_path);
-                    branch_file << commit.id;
-                    branch_file.close();
+                    write_ref(common_root / MINIGIT_BRANCHES_PATH / get_current_branch(), commit.id);
 
                     // Write JSON file containing commit info 
                     write_commit_info(commit);
 
                     // log commit both in logs/HEAD and in logs/refs/heads/<branch_id>
                     write_log_entry(MINIGIT_HEAD_LOG_PATH.string(), log_entry);
-                    write_log_entry((MINIGIT_BRANCHES_LOG_PATH / get_current_branch()).string(), log_entry);
-
-                    std::cout << "Auto-merge succeeded. Merged " << branch << " into " << get_current_branch() << std::endl;
+                    write_branch_log_entry(get_current_branch(), log_entry);
 
+                    result.outcome = MergeOutcome::Merged;
+                    result.new_commit_id = commit.id;
                 }
                 else
                 {
                     // There is a conflict, so cannot merge automatically.
-                    
-                    std::cout << "Automerge failed. Fix conflicts and then commit the result." << std::endl;
+                    result.outcome = MergeOutcome::Conflict;
                     
                     // Create a merge flag that will be removed when the merge is completed
                     std::ofstream merge_flag(MINIGIT_MERGING_FLAG_PATH.string());
                     merge_flag.close();
                     
                     // Store the head commit id of the other branch
-                    std::ofstream merge_head(MINIGIT_MERGE_HEAD_PATH.string());
-                    merge_head << last_commit_branch_2;
-                    merge_head.close(); 
+                    write_ref(MINIGIT_MERGE_HEAD_PATH, last_commit_branch_2);
                 }             
             }
         }
     } 
+
+    return result;
 }
 
-void Repository::status()
-// Prints branch name and the list of staged, modified and untracked files.
+StatusResult RepositoryImpl::status() const
+// Returns branch name and the list of staged, modified, deleted and untracked files.
 // Repository must be initialized.
 {
+    StatusResult result;
+    StatusResult header = status([&result](const StatusEntry& entry)
+    {
+        if(entry.unstaged == FileState::Untracked)
+        {
+            result.untracked.emplace_back(entry.path);
+            return;
+        }
+        if(entry.staged != FileState::Unchanged)
+        {
+            result.staged.emplace_back(entry.path);
+        }
+        if(entry.unstaged == FileState::Modified)
+        {
+            result.modified.emplace_back(entry.path);
+        }
+        else if(entry.unstaged == FileState::Deleted)
+        {
+            result.deleted.emplace_back(entry.path);
+        }
+    });
+
+    result.error = header.error;
+    result.branch = header.branch;
+    result.merging = header.merging;
+    return result;
+}
+
+StatusResult RepositoryImpl::status(const StatusVisitor& visit, const std::function<void(const StatusResult&)>& begin) const
+// Streams the status of each changed path to visit, in path order, without collecting them
+// (the inputs are still loaded whole, see walk_statuses).
+// begin (if set) is called with the branch name and merge state before the first entry.
+// The returned result only carries the error, branch and merge state; its file lists are empty.
+{
+    TraceSpan span("status");
+
+    StatusResult result;
     bool is_initialized = initialized();
 
     if(!is_initialized)
     {
-        std::cout << "Error: Repository not initialized." << std::endl;
+        result.error = not_initialized_error();
     }
     else
     {
-        std::cout<< "On branch " << get_current_branch() << std::endl;
+        result.branch = get_current_branch();
+        result.merging = std::filesystem::exists(MINIGIT_MERGING_FLAG_PATH.string());
 
-        if(std::filesystem::exists(MINIGIT_MERGING_FLAG_PATH.string()))
+        if(begin)
         {
-            std::cout << "You have unmerged paths. Fix conflicts, stage to mark resolutions then commit." << std::endl;
+            begin(result);
         }
+        walk_statuses(visit);
+    }
 
-        std::vector<std::string> staged;
-        std::vector<std::string> modified;
-        std::vector<std::string> untracked;
+    return result;
+}
 
-        get_working_directory_files_statuses(staged, modified, untracked);
+CountObjectsResult RepositoryImpl::count_objects() const
+// Returns the number and size of objects, log files and index entries in the repository.
+// Object sizes are gathered with a parallel scan of the objects directory.
+{
+    TraceSpan span("count_objects");
+
+    CountObjectsResult result;
+    bool is_initialized = initialized();
+
+    if(!is_initialized)
+    {
+        result.error = not_initialized_error();
+    }
+    else
+    {
+        std::vector<std::filesystem::path> blob_files;
+        std::vector<std::filesystem::path> commit_files;
+        std::vector<std::filesystem::path> log_files;
+        std::vector<std::filesystem::path> chunk_files;
 
-        if(staged.size())
+        for(auto const& dir_entry : std::filesystem::directory_iterator {common_root / MINIGIT_BLOBS_PATH})
+        {
+            blob_files.push_back(dir_entry.path());
+        }
+        if(std::filesystem::exists(common_root / MINIGIT_CHUNK_LISTS_PATH))
         {
-            std::cout << "Changes to be committed:" << std::endl;
-            for(auto file : staged)
+            // A chunked blob counts as a blob of the size of its list
+            for(auto const& dir_entry : std::filesystem::directory_iterator {common_root / MINIGIT_CHUNK_LISTS_PATH})
             {
-                std::cout << "\t" << file << std::endl;
+                blob_files.push_back(dir_entry.path());
             }
         }
-
-        if(modified.size())
+        if(std::filesystem::exists(common_root / MINIGIT_CHUNKS_PATH))
         {
-            std::cout << "Changes not staged for commit:" << std::endl;
-            for(auto file : modified)
+            for(auto const& dir_entry : std::filesystem::directory_iterator {common_root / MINIGIT_CHUNKS_PATH})
             {
-                std::cout << "\t" << file << std::endl;
+                chunk_files.push_back(dir_entry.path());
             }
         }
-
-        if(untracked.size())
+        for(auto const& dir_entry : std::filesystem::directory_iterator {common_root / MINIGIT_COMMITS_PATH})
+        {
+            commit_files.push_back(dir_entry.path());
+        }
+        for(auto const& dir_entry : std::filesystem::recursive_directory_iterator {common_root / MINIGIT_LOGS_PATH})
         {
-            std::cout << "Untracked files:" << std::endl;
-            for(auto file : untracked)
+            if(dir_entry.is_regular_file())
             {
-                std::cout << "\t" << file << std::endl;
+                log_files.push_back(dir_entry.path());
             }
         }
 
-        if ((!untracked.size()) && (!modified.size()) && !(staged.size()))
+        // Stat all files in parallel, each range writes only its own slots
+        std::vector<std::filesystem::path> all_files;
+        all_files.reserve(blob_files.size() + commit_files.size() + log_files.size() + chunk_files.size());
+        all_files.insert(all_files.end(), blob_files.begin(), blob_files.end());
+        all_files.insert(all_files.end(), commit_files.begin(), commit_files.end());
+        all_files.insert(all_files.end(), log_files.begin(), log_files.end());
+        all_files.insert(all_files.end(), chunk_files.begin(), chunk_files.end());
+        std::vector<std::uintmax_t> sizes(all_files.size());
+
+        ThreadPool pool;
+        parallel_for(pool, all_files.size(), [&all_files, &sizes](std::size_t begin, std::size_t end)
         {
-            std::cout << "Nothing to commit, working tree clean." << std::endl;
-        }
-    }
-}
-
-bool Repository::initialized() const
-// Returns true if the repository has been initialized, false otherwise.
-{
-    const std::filesystem::path files_path {MINIGIT_FILES_PATH};
+            for(std::size_t i = begin; i < end; i++)
+            {
+                sizes[i] = std::filesystem::file_size(all_files[i]);
+            }
+        });
+        span.add_counter(TRACE_FILES_STATED, all_files.size());
 
-    return std::filesystem::exists(files_path);
-}
+        std::unordered_set<ObjectId> reachable_commits;
+        std::unordered_set<ObjectId> reachable_blobs;
+        collect_reachable_objects(reachable_commits, reachable_blobs);
 
-void Repository::load_working_directory_files(std::vector<std::string>& working_directory_files) const
-// Load working directory files into working_directory_files.
-{
-    for(auto const& dir_entry : std::filesystem::directory_iterator {"."})
-    {
-        if(dir_entry.is_regular_file())
+        result.blob_count = blob_files.size();
+        for(std::size_t i = 0; i < blob_files.size(); i++)
         {
-            working_directory_files.push_back(dir_entry.path().filename().string());
-        }     
-    }
-}
-
-bool Repository::load_commit_info(std::string id, CommitInfo& commit_info) const
-// Load commit information from file.
-{
-    nlohmann::json json_data;
-    std::filesystem::path file_path = MINIGIT_COMMITS_PATH / id;
-    bool file_exists = std::filesystem::exists(file_path);
-    
-    if(file_exists)
-    {
-        std::ifstream file(file_path);
-        file >> json_data;
-        commit_info = json_data.get<CommitInfo>();
-    }
-    
-    return file_exists;
-}
-
-void Repository::write_commit_info(const CommitInfo& commit_info) const
-// Write commit info to file.
-{
-    nlohmann::json json_data;
-    json_data = commit_info;
-    std::filesystem::path file_path = MINIGIT_COMMITS_PATH / commit_info.id;
-    std::ofstream(file_path.string()) << json_data.dump(4);
-}
-
-bool Repository::load_tracked_files(std::unordered_map<std::string, std::string>& tracked_files) const
-// Load tracked files from index.
-{ 
-    bool index_exists = std::filesystem::exists(MINIGIT_INDEX_PATH);
-    if(index_exists)
-    {
-        std::ifstream file(MINIGIT_INDEX_PATH.string());
-        nlohmann::json json_data;
-        file >> json_data;
-        tracked_files = json_data["tracked_files"].get<std::unordered_map<std::string, std::string>>();
-    }
-    return index_exists;
-}
-
-void Repository::write_tracked_files(std::unordered_map<std::string, std::string>& tracked_files) const
-// Write tracked files to index (JSON file).
-{
-    nlohmann::json json_data;
-    json_data["tracked_files"] = tracked_files;
-    std::ofstream file(MINIGIT_INDEX_PATH.string());
-    file << json_data.dump(4); 
-    file.close();
-}
+            result.blobs_size += sizes[i];
+            result.largest_blob_size = std::max(result.largest_blob_size, sizes[i]);
+            if(reachable_blobs.find(object_id_from_path(blob_files[i])) == reachable_blobs.end())
+            {
+                result.unreachable_blobs++;
+            }
+        }
 
-std::string Repository::sha1(const std::string &input) const 
-// Returns the SHA-1 hashed input string. 
-{
-    unsigned char hash[MINIGIT_SHA_DIGEST_LENGTH]; 
+        result.commit_count = commit_files.size();
+        for(std::size_t i = 0; i < commit_files.size(); i++)
+        {
+            result.commits_size += sizes[blob_files.size() + i];
+            if(reachable_commits.find(object_id_from_path(commit_files[i])) == reachable_commits.end())
+            {
+                result.unreachable_commits++;
+            }
+        }
 
-    SHA1(reinterpret_cast<const unsigned char*>(input.c_str()),
-         input.size(),
-         hash);
+        result.log_file_count = log_files.size();
+        for(std::size_t i = 0; i < log_files.size(); i++)
+        {
+            result.logs_size += sizes[blob_files.size() + commit_files.size() + i];
+        }
 
-    // Convert the resulting bytes to hex
-    std::ostringstream result;
-    result << std::hex << std::setfill('0');
+        result.chunk_count = chunk_files.size();
+        for(std::size_t i = 0; i < chunk_files.size(); i++)
+        {
+            result.chunks_size += sizes[blob_files.size() + commit_files.size() + log_files.size() + i];
+        }
 
-    for (int i = 0; i < MINIGIT_SHA_DIGEST_LENGTH; i++) {
-        result << std::setw(2) << static_cast<int>(hash[i]);
+        PathMap tracked_files;
+        load_tracked_files(tracked_files);
+        result.index_entries = tracked_files.size();
     }
 
-    return result.str();
-}
-
-std::string Repository::get_current_branch() const 
-// Returns the current branch name.
-{
-    // Get current branch name from the HEAD file
-    std::ifstream head(MINIGIT_HEAD_PATH.string());  
-    std::stringstream buffer;
-    buffer << head.rdbuf();
-    std::string branch = buffer.str();
-    head.close();
-    return branch;
-}
-
-std::string Repository::get_file_hash(std::string filename) const
-// Returns the hash for a file using its name, last modified timestamp and size.
-{
-    std::filesystem::path file {filename};
-    std::filesystem::file_time_type timestamp = std::filesystem::last_write_time(file);
-    auto size = std::filesystem::file_size(file);
-
-    std::string hash = sha1(filename + std::to_string(timestamp.time_since_epoch().count()) + std::to_string(size));
-    return hash;
+    return result;
 }
 
-void Repository::get_previous_commit_info(CommitInfo& commit_info) const
-// Retrieves the last commit information from the log.
+GcResult RepositoryImpl::gc(long long prune_grace_seconds)
+// Deletes blobs and commits that are not reachable from the branch heads, MERGE_HEAD, the index or the reflogs,
+// and the chunks no remaining blob lists.
+// Only objects written more than prune_grace_seconds ago are deleted, so objects that a concurrent add or commit
+// has written but not yet referenced are kept.
 {
-    // Instead of using the HEAD info to get the current branch, read
-    // last commit id from the log, since the branch could have changed 
-    // in the meantime.
+    TraceSpan span("gc");
 
-    std::vector<LogEntry> entries;
+    GcResult result;
+    bool is_initialized = initialized();
 
-    read_log((MINIGIT_BRANCHES_LOG_PATH / get_current_branch()).string(), entries);
-    if(entries.size() > 0)
+    if(!is_initialized)
     {
-        load_commit_info(entries.back().new_commit_id, commit_info);
+        result.error = not_initialized_error();
     }
-}
-
-void Repository::get_working_directory_files_statuses(
-    std::vector<std::string>& staged, 
-    std::vector<std::string>& modified, 
-    std::vector<std::string>& untracked) const
-{
-    std::vector<std::string> working_directory_files;
-    load_working_directory_files(working_directory_files);
-    std::sort(working_directory_files.begin(), working_directory_files.end());
-
-    std::unordered_map<std::string, std::string> tracked_files;
-    load_tracked_files(tracked_files);
-
-    CommitInfo head;
-    get_previous_commit_info(head);
-
-    for(auto file : working_directory_files)
+    else
     {
-        // A file that is in the working directory but not in the index is untracked.
-        // A file that is in the index but has a different hash than current hash is modified.
-        // A file that is in the index but not in the HEAD 
-        //  (or has a different hash in the index than in the HEAD, or if HEAD has not been commited yet) is staged.
+        std::unordered_set<ObjectId> reachable_commits;
+        std::unordered_set<ObjectId> reachable_blobs;
+        collect_reachable_objects(reachable_commits, reachable_blobs);
 
-        if(auto search = tracked_files.find(file); search != tracked_files.end())
+        std::vector<std::filesystem::path> unreachable_objects;
+        for(auto const& dir_entry : std::filesystem::directory_iterator {common_root / MINIGIT_COMMITS_PATH})
         {
-            std::string current_hash = get_file_hash(file);
-            if(search->second != current_hash)
+            if(reachable_commits.find(object_id_from_path(dir_entry.path())) == reachable_commits.end())
             {
-                modified.push_back(file);
+                unreachable_objects.push_back(dir_entry.path());
             }
-
-            if(auto search_head = head.file_hashes.find(file); search_head != head.file_hashes.end())
+        }
+        for(auto const& blobs_path : {common_root / MINIGIT_BLOBS_PATH, common_root / MINIGIT_CHUNK_LISTS_PATH})
+        {
+            if(!std::filesystem::exists(blobs_path))
             {
-                if(search_head->second != search->second)
-                {
-                    staged.push_back(file);
-                }
+                continue;
             }
-            else // File not found in HEAD
+            for(auto const& dir_entry : std::filesystem::directory_iterator {blobs_path})
             {
-                staged.push_back(file);
+                if(reachable_blobs.find(object_id_from_path(dir_entry.path())) == reachable_blobs.end())
+                {
+                    unreachable_objects.push_back(dir_entry.path());
+                }
             }
         }
-        else // File not found in index
+
+        // The index may have been rewritten by a concurrent add since it was read above
+        PathMap tracked_files;
+        load_tracked_files(tracked_files);
+        for(auto const& entry : tracked_files)
         {
-            untracked.push_back(file);
+            reachable_blobs.insert(entry.id);
         }
-    }
-}
-
-bool Repository::is_revert_commit_id_valid(std::string commit_id) const
-// Checks in the branch log to see if the commit id is found
-{
-    bool is_valid = false;
-    std::vector<LogEntry> entries;
 
-    read_log((MINIGIT_BRANCHES_LOG_PATH / get_current_branch()).string(), entries);
-    for(auto const& entry : entries)
-    {
-        if(entry.new_commit_id == commit_id)
+        for(auto const& object_path : unreachable_objects)
         {
-            is_valid = true;
-            break;
-        } 
-    }
-    return is_valid;
-}
-
-void Repository::perform_merge(const std::string& base_commit_id, 
-    const std::string& branch_1_commit_id, 
-    const std::string& branch_2_commit_id,
-    bool& merge_performed,
-    bool& conflict) const
-{
-    CommitInfo base_commit_info;
-    CommitInfo branch_1_commit_info;
-    CommitInfo branch_2_commit_info;
-    load_commit_info(base_commit_id, base_commit_info);
-    load_commit_info(branch_1_commit_id, branch_1_commit_info);
-    load_commit_info(branch_2_commit_id, branch_2_commit_info);
-
-    std::unordered_map<std::string, std::string> merged_content = branch_1_commit_info.file_hashes;
-    std::vector<std::string> merge_failed_files; 
+            bool is_blob = object_path.parent_path() != common_root / MINIGIT_COMMITS_PATH;
+            if(is_blob && reachable_blobs.find(object_id_from_path(object_path)) != reachable_blobs.end())
+            {
+                continue;
+            }
 
-    for(auto const& [filename, hash] : branch_2_commit_info.file_hashes)
-    {
-        // Check if the file exists in branch 1, otherwise copy the file
-        if(auto search_1 = branch_1_commit_info.file_hashes.find(filename); 
-                search_1 == branch_1_commit_info.file_hashes.end())
-        {
-            // File not found in branch 1, so add it to the merged content
-            merged_content[filename] = hash;
-        }
-        else // File is found in both branches
-        {
-            if(auto search_base = base_commit_info.file_hashes.find(filename); 
-                search_base == base_commit_info.file_hashes.end())            
+            if(is_object_older_than(object_path, prune_grace_seconds))
             {
-                // The file is not found in base, so peform 2-way merge
-                if(perform_2_way_merge(filename, 
-                                branch_1_commit_info.file_hashes[filename], 
-                                branch_2_commit_info.file_hashes[filename]))
+                result.removed_size += std::filesystem::file_size(object_path);
+                std::filesystem::remove(object_path);
+                if(is_blob)
                 {
-                    conflict = true;
-                    merge_failed_files.push_back(filename);
-                } 
-                merge_performed = true;
+                    result.removed_blobs++;
+                }
+                else
+                {
+                    result.removed_commits++;
+                }
             }
-            else // File found in base as well
+        }
+
+        // Chunks are referenced by the chunk lists of the blobs that remain, unreachable but recent ones included
+        if(std::filesystem::exists(common_root / MINIGIT_CHUNKS_PATH))
+        {
+            std::unordered_set<ObjectId> referenced_chunks;
+            if(std::filesystem::exists(common_root / MINIGIT_CHUNK_LISTS_PATH))
             {
-                if(hash != search_1->second) 
+                for(auto const& dir_entry : std::filesystem::directory_iterator {common_root / MINIGIT_CHUNK_LISTS_PATH})
                 {
-                    // Hashes are different in the two branches, so check if any of them matches base
-                    if(search_1->second == base_commit_info.file_hashes[filename]) 
-                    {
-                        // Branch 1 hash matches base, so take the branch 2 version in merged_content
-                        merged_content[filename] = hash; 
-                    }
-                    else if (hash == base_commit_info.file_hashes[filename])
-                    {
-                        // Branch 2 hash matches base, so take the branch 1 version in merged_content
-                        merged_content[filename] = hash; 
-                    }
-                    else
+                    std::vector<ChunkRef> chunks;
+                    read_chunk_list(dir_entry.path(), hasher.id_size(), chunks);
+                    for(auto const& chunk : chunks)
                     {
-                        // File has been changed in both branches, so try line by line merge of file
-                        if(perform_3_way_merge(filename, 
-                                base_commit_info.file_hashes[filename],
-                                branch_1_commit_info.file_hashes[filename], 
-                                branch_2_commit_info.file_hashes[filename]))
-                        {
-                            conflict = true;
-                            merge_failed_files.push_back(filename);
-                        }
-                        merge_performed = true;
+                        referenced_chunks.insert(chunk.id);
                     }
                 }
-                else
+            }
+            for(auto const& dir_entry : std::filesystem::directory_iterator {common_root / MINIGIT_CHUNKS_PATH})
+            {
+                if(referenced_chunks.find(object_id_from_path(dir_entry.path())) == referenced_chunks.end() &&
+                    is_object_older_than(dir_entry.path(), prune_grace_seconds))
                 {
-                    // Do nothing, hashes are the same, so changes necessary
+                    result.removed_size += std::filesystem::file_size(dir_entry.path());
+                    std::filesystem::remove(dir_entry.path());
+                    result.removed_chunks++;
                 }
             }
         }
-    }  
 
-    // Update the index
-    write_tracked_files(merged_content);
+        // Drop the removed ids from the lookup index
+        if(result.removed_commits)
+        {
+            ObjectIndex(common_root / MINIGIT_COMMITS_PATH, common_root / MINIGIT_COMMITS_INDEX_PATH, hasher.id_size()).rebuild();
+        }
 
-    // Update the working directory
-    for(auto const& [filename, hash] : merged_content)
-    {
-        // Make sure that merge conflicts are not overwritten. Only overwrite if not found in merge_failed_files 
-        if(std::find(merge_failed_files.begin(), merge_failed_files.end(), filename) == merge_failed_files.end())
+        // Cached blame results for removed versions can never be looked up again
+        if(result.removed_blobs || result.removed_commits)
         {
-            // remove file from working directory first, if it exists
-            if(std::filesystem::exists(filename))
+            BlameCache(common_root / MINIGIT_BLAME_CACHE_PATH).remove_if([&](const ObjectId& blob_id, const ObjectId& commit_id)
             {
-                std::filesystem::remove(filename);
-            }
-
-            std::filesystem::copy_file(MINIGIT_BLOBS_PATH / hash,
-                filename,
-                std::filesystem::copy_options::none);
-
-            // Make sure to copy timestamp as well, otherwise the hash will differ 
-            auto timestamp = std::filesystem::last_write_time(MINIGIT_BLOBS_PATH / hash);
-            std::filesystem::last_write_time(filename,  timestamp);             
+                return !object_store.contains_blob(blob_id) || !object_store.contains(ObjectType::Commit, commit_id);
+            });
         }
-    }   
+    }
+
+    return result;
 }
 
-bool Repository::perform_2_way_merge(const std::string& filename, const std::string& branch_1_file_hash, const std::string& branch_2_file_hash) const
+FsckResult RepositoryImpl::fsck(const ProgressCallback& progress) const
+// Verifies the objects in the local object directories, and that the commits, the index of every working tree,
+// the branch refs, MERGE_HEAD and the reflogs only refer to objects that exist (locally or in an alternate).
+// - A commit must parse, and its id must be the hash of its author, timestamp and message.
+// - A blob must have the id computed from a path it is stored under (in a commit or an index), its last write
+//   time and its size. Blobs nothing refers to cannot be rehashed, since the path is part of the id.
+//   A chunked blob must list chunks that exist and have the listed sizes.
+// - A chunk must have the hash of its contents as id.
+// Commits are verified first (they give the blob paths), then blobs and chunks, each spread over all cores.
+// progress is called from the worker threads, one call at a time, whenever another percent of the objects is done.
+// Repository must be initialized.
 {
-    bool conflict = false;
+    TraceSpan span("fsck");
 
-    std::ifstream branch_1_file((MINIGIT_BLOBS_PATH / branch_1_file_hash).string());  
-    std::stringstream branch_1_file_buffer;
-    branch_1_file_buffer << branch_1_file.rdbuf();
-    std::vector<std::string> branch_1_file_lines;
-    std::string f1_line;
-    while (std::getline(branch_1_file_buffer, f1_line))
+    FsckResult result;
+    if(!initialized())
     {
-        branch_1_file_lines.push_back(f1_line);
-    }    
-    branch_1_file.close();
-
-    std::ifstream branch_2_file((MINIGIT_BLOBS_PATH / branch_2_file_hash).string()); 
-    std::stringstream branch_2_file_buffer;
-    branch_2_file_buffer << branch_2_file.rdbuf();
-    std::vector<std::string> branch_2_file_lines;
-    std::string f2_line;
-    while (std::getline(branch_2_file_buffer, f2_line))
-    {
-        branch_2_file_lines.push_back(f2_line);
-    }  
-    branch_2_file.close();    
-
-    size_t max_lines = std::max({branch_1_file_lines.size(), branch_2_file_lines.size()});
-    std::string out;
+        result.error = not_initialized_error();
+        return result;
+    }
 
-    for (size_t i = 0; i < max_lines; i++) 
+    try
     {
-        std::string branch_1_file_line = (i < branch_1_file_lines.size() ? branch_1_file_lines[i] : "");
-        std::string branch_2_file_line = (i < branch_2_file_lines.size() ? branch_2_file_lines[i] : "");
-        
-        if (branch_1_file_line == branch_2_file_line) {
-            out += branch_1_file_line + "\n";
-        }
-        else
+        auto list_object_ids = [this](const std::filesystem::path& directory, std::vector<ObjectId>& ids)
+        {
+            if(std::filesystem::exists(directory))
+            {
+                for(auto const& dir_entry : std::filesystem::directory_iterator {directory})
+                {
+                    // Skips temporary files of writes in progress
+                    ObjectId id = object_id_from_path(dir_entry.path());
+                    if(!id.is_null())
+                    {
+                        ids.push_back(id);
+                    }
+                }
+            }
+        };
+        std::vector<ObjectId> commit_ids;
+        std::vector<ObjectId> blob_ids;
+        std::vector<ObjectId> chunk_ids;
+        list_object_ids(common_root / MINIGIT_COMMITS_PATH, commit_ids);
+        list_object_ids(common_root / MINIGIT_BLOBS_PATH, blob_ids);
+        // Chunked blobs follow the plain ones
+        std::size_t plain_blob_count = blob_ids.size();
+        list_object_ids(common_root / MINIGIT_CHUNK_LISTS_PATH, blob_ids);
+        list_object_ids(common_root / MINIGIT_CHUNKS_PATH, chunk_ids);
+
+        std::mutex result_mutex;
+        auto report = [&](const std::string& problem)
         {
-              conflict = true;
+            std::lock_guard<std::mutex> lock(result_mutex);
+            result.problems.push_back(problem);
+        };
+
+        std::size_t total = commit_ids.size() + blob_ids.size() + chunk_ids.size();
+        std::atomic<std::size_t> done {0};
+        std::size_t reported = 0;
+        auto advance = [&]()
+        {
+            std::size_t now_done = ++done;
+            if(progress && (now_done - 1) * 100 / total != now_done * 100 / total)
+            {
+                std::lock_guard<std::mutex> lock(result_mutex);
+                if(now_done > reported)
+                {
+                    reported = now_done;
+                    progress(now_done, total);
+                }
+            }
+        };
 
-            out += "<<<<<<< HEAD\n";
-            if (!branch_1_file_line.empty()) out += branch_1_file_line + "\n";
-            out += "=======\n";
-            if (!branch_2_file_line.empty()) out += branch_2_file_line + "\n";
-            out += ">>>>>>> MERGE\n";
+        // The path each blob is stored under
+        std::unordered_map<ObjectId, PathId> blob_paths;
+        for(auto const& root : list_worktree_roots(common_root))
+        {
+            PathMap tracked_files;
+            try
+            {
+                load_tracked_files(tracked_files, root / MINIGIT_INDEX_PATH);
+            }
+            catch (const nlohmann::json::exception&)
+            {
+                report("index " + (root / MINIGIT_INDEX_PATH).string() + ": cannot be parsed");
+            }
+            for(auto const& entry : tracked_files)
+            {
+                if(!object_store.contains_blob(entry.id))
+                {
+                    report("index " + (root / MINIGIT_INDEX_PATH).string() + ": missing blob " + entry.id.to_hex() + 
+                        " (" + path_of(entry) + ")");
+                }
+                blob_paths.emplace(entry.id, entry.path);
+            }
         }
-    }
-
-    std::ofstream result_file(filename);
-    result_file << out;
-    result_file.close();
 
-    return conflict;
-}
+        check_refs(report);
 
-bool Repository::perform_3_way_merge(const std::string& filename, const std::string& base_file_hash, const std::string& branch_1_file_hash, const std::string& branch_2_file_hash) const
+        // Loading commits interns their paths, and PathTable::path() must not run concurrently with intern(),
+        // so missing blobs are only recorded here and their paths looked up once all commits are loaded
+        std::vector<std::pair<ObjectId, PathEntry>> missing_blobs;
+        ThreadPool pool;
+        parallel_for(pool, commit_ids.size(), [&](std::size_t begin, std::size_t end)
+        {
+            std::vector<PathEntry> paths;
+            std::vector<std::pair<ObjectId, PathEntry>> missing;
+            for(std::size_t i = begin; i < end; i++)
+            {
+                const ObjectId& id = commit_ids[i];
+                CommitInfo commit_info;
+                try
+                {
+                    load_commit_info(id, commit_info);
+                }
+                catch (const nlohmann::json::exception&)
+                {
+                    report("commit " + id.to_hex() + ": cannot be parsed");
+                    advance();
+                    continue;
+                }
+
+                if(commit_info.id != id || hash(commit_info.author + commit_info.timestamp + commit_info.message) != id)
+                {
+                    report("commit " + id.to_hex() + ": hash mismatch");
+                }
+                for(auto const& parent_id : {commit_info.parent_1_id, commit_info.parent_2_id})
+                {
+                    if(!parent_id.is_null() && !object_store.contains(ObjectType::Commit, parent_id))
+                    {
+                        report("commit " + id.to_hex() + ": missing parent " + parent_id.to_hex());
+                    }
+                }
+                for(auto const& entry : commit_info.file_hashes)
+                {
+                    if(!object_store.contains_blob(entry.id))
+                    {
+                        missing.push_back({id, entry});
+                    }
+                    paths.push_back(entry);
+                }
+                advance();
+            }
+
+            std::lock_guard<std::mutex> lock(result_mutex);
+            for(auto const& entry : paths)
+            {
+                blob_paths.emplace(entry.id, entry.path);
+            }
+            missing_blobs.insert(missing_blobs.end(), missing.begin(), missing.end());
+        });
+        for(auto const& [commit_id, entry] : missing_blobs)
+        {
+            report("commit " + commit_id.to_hex() + ": missing blob " + entry.id.to_hex() + " (" + path_of(entry) + ")");
+        }
+
+        std::atomic<std::uintmax_t> bytes_hashed {0};
+        parallel_for(pool, blob_ids.size() + chunk_ids.size(), [&](std::size_t begin, std::size_t end)
+        {
+            for(std::size_t i = begin; i < end; i++)
+            {
+                if(i >= blob_ids.size())
+                {
+                    const ObjectId& id = chunk_ids[i - blob_ids.size()];
+                    ObjectId content_id;
+                    std::uint64_t size = 0;
+                    if(!hasher.hash_file(object_store.local_path(ObjectType::Chunk, id), content_id, size))
+                    {
+                        report("chunk " + id.to_hex() + ": cannot be read");
+                    }
+                    else if(content_id != id)
+                    {
+                        report("chunk " + id.to_hex() + ": hash mismatch");
+                    }
+                    bytes_hashed += size;
+                    advance();
+                    continue;
+                }
+
+                const ObjectId& id = blob_ids[i];
+                bool chunked = i >= plain_blob_count;
+                std::filesystem::path blob_path = object_store.local_path(chunked ? ObjectType::ChunkList : ObjectType::Blob, id);
+                std::uintmax_t size = std::filesystem::file_size(blob_path);
+                std::vector<ChunkRef> chunks;
+                if(chunked)
+                {
+                    size = 0;
+                    if(!read_chunk_list(blob_path, hasher.id_size(), chunks))
+                    {
+                        report("blob " + id.to_hex() + ": damaged chunk list");
+                    }
+                    for(auto const& chunk : chunks)
+                    {
+                        std::filesystem::path chunk_path = object_store.find(ObjectType::Chunk, chunk.id);
+                        std::error_code error;
+                        if(!std::filesystem::exists(chunk_path))
+                        {
+                            report("blob " + id.to_hex() + ": missing chunk " + chunk.id.to_hex());
+                        }
+                        else if(std::filesystem::file_size(chunk_path, error) != chunk.size)
+                        {
+                            report("blob " + id.to_hex() + ": chunk " + chunk.id.to_hex() + " has the wrong size");
+                        }
+                        size += chunk.size;
+                    }
+                }
+
+                // Written once the commits are done, so read without locking
+                auto search = blob_paths.find(id);
+                if(search != blob_paths.end())
+                {
+                    const std::string& path = PathTable::instance().path(search->second);
+                    if(hash(file_hash_input(path, std::filesystem::last_write_time(blob_path), size)) != id)
+                    {
+                        report("blob " + id.to_hex() + ": hash mismatch (" + path + ")");
+                    }
+                }
+                advance();
+            }
+        });
+
+        result.commits_checked = commit_ids.size();
+        result.blobs_checked = blob_ids.size();
+        result.chunks_checked = chunk_ids.size();
+        result.bytes_hashed = bytes_hashed;
+    }
+    catch (const std::filesystem::filesystem_error& e)
+    {
+        result.error = {ErrorCode::FilesystemError, e.what()};
+    }
+
+    std::sort(result.problems.begin(), result.problems.end());
+    span.add_counter(TRACE_BYTES_READ, result.bytes_hashed);
+    return result;
+}
+
+SparseCheckoutResult RepositoryImpl::sparse_checkout_list() const
+// Returns the sparse checkout patterns in effect.
+// Repository must be initialized.
+{
+    TraceSpan span("sparse_checkout_list");
+
+    SparseCheckoutResult result;
+    if(!initialized())
+    {
+        result.error = not_initialized_error();
+    }
+    else
+    {
+        SparseCheckout sparse_checkout;
+        sparse_checkout.load(MINIGIT_SPARSE_CHECKOUT_PATH);
+        result.patterns = sparse_checkout.get_patterns();
+    }
+
+    return result;
+}
+
+SparseCheckoutResult RepositoryImpl::sparse_checkout_set(const std::vector<std::string>& patterns)
+// Replaces the sparse checkout patterns (none disables sparse checkout) and updates the working tree:
+// tracked files that became included are written from the index, unmodified files that became excluded
+// are removed. Excluded files with local changes are kept.
+// Repository must be initialized.
+{
+    TraceSpan span("sparse_checkout_set");
+
+    SparseCheckoutResult result;
+    if(!initialized())
+    {
+        result.error = not_initialized_error();
+        return result;
+    }
+
+    try
+    {
+        SparseCheckout sparse_checkout;
+        sparse_checkout.set_patterns(patterns);
+        sparse_checkout.save(MINIGIT_SPARSE_CHECKOUT_PATH);
+        result.patterns = sparse_checkout.get_patterns();
+
+        PathMap tracked_files;
+        load_tracked_files(tracked_files);
+
+        Materializer materializer;
+        for(auto const& entry : tracked_files)
+        {
+            const std::string& filename = path_of(entry);
+            bool exists = std::filesystem::exists(filename);
+
+            if(sparse_checkout.includes(filename))
+            {
+                if(!exists)
+                {
+                    add_blob(materializer, entry.id, filename);
+                }
+            }
+            else if(exists)
+            {
+                if(get_file_hash(filename) == entry.id)
+                {
+                    std::filesystem::remove(filename);
+                    result.removed++;
+                }
+                else
+                {
+                    result.kept_modified.push_back(filename);
+                }
+            }
+        }
+        result.written = materializer.size();
+        materializer.run();
+    }
+    catch (const std::filesystem::filesystem_error& e)
+    {
+        result.error = {ErrorCode::FilesystemError, e.what()};
+    }
+
+    return result;
+}
+
+AlternatesResult RepositoryImpl::list_alternates() const
+// Returns the shared object directories objects are also read from.
+// Repository must be initialized.
+{
+    AlternatesResult result;
+    if(!initialized())
+    {
+        result.error = not_initialized_error();
+    }
+    else
+    {
+        result.alternates = object_store.get_alternates();
+    }
+
+    return result;
+}
+
+AlternatesResult RepositoryImpl::add_alternate(const std::string& objects_path)
+// Adds a shared, read-only object directory (or a repository whose objects should be shared).
+// Objects found there are no longer copied into this repository.
+// Repository must be initialized.
+{
+    TraceSpan span("add_alternate");
+
+    AlternatesResult result;
+    if(!initialized())
+    {
+        result.error = not_initialized_error();
+        return result;
+    }
+
+    std::string error;
+    if(!object_store.add_alternate(objects_path, error))
+    {
+        result.error = {ErrorCode::InvalidObjectDirectory, error};
+    }
+    result.alternates = object_store.get_alternates();
+
+    return result;
+}
+
+TransferResult RepositoryImpl::clone(const std::string& source)
+// Initializes a repository in the current directory with all branches of the source repository,
+// then checks out the branch the source has checked out.
+{
+    TraceSpan span("clone");
+
+    TransferResult result;
+    std::filesystem::path source_root;
+    if(initialized())
+    {
+        result.error = {ErrorCode::AlreadyInitialized, "Repository already initialized."};
+        return result;
+    }
+    if(!find_repository_root(source, source_root))
+    {
+        result.error = {ErrorCode::RepositoryNotFound, source + " is not a MiniGit repository."};
+        return result;
+    }
+
+    // The clone names its objects like the source does
+    InitResult init_result = init(read_hash_algorithm(source_root));
+    if(init_result.error)
+    {
+        result.error = init_result.error;
+        return result;
+    }
+
+    try
+    {
+        transfer_branches(source_root, common_root, list_branch_names(source_root), {}, result);
+        if(result.error)
+        {
+            return result;
+        }
+
+        std::string branch = get_current_branch(source_root);
+        result.branch = MINIGIT_MASTER_BRANCH_NAME;
+        if(std::filesystem::exists(common_root / MINIGIT_BRANCHES_PATH / branch))
+        {
+            result.branch = branch;
+            std::ofstream head(MINIGIT_HEAD_PATH.string());
+            head << branch;
+            head.close();
+
+            CommitInfo commit_info;
+            get_previous_commit_info(commit_info);
+            update_working_tree({}, commit_info.file_hashes);
+
+            LogEntry log_entry;
+            log_entry.author = author_name();
+            log_entry.timestamp = timepoint_to_string(std::chrono::system_clock::now());
+            log_entry.message = "Cloned from " + source_root.string();
+            log_entry.new_commit_id = commit_info.id;
+            write_log_entry(MINIGIT_HEAD_LOG_PATH.string(), log_entry);
+        }
+    }
+    catch (const std::filesystem::filesystem_error& e)
+    {
+        result.error = {ErrorCode::FilesystemError, e.what()};
+    }
+
+    return result;
+}
+
+TransferResult RepositoryImpl::fetch(const std::string& remote)
+// Fast-forwards the branches of this repository to those of the remote repository and creates missing ones.
+// The current branch is only updated (together with the index and the working tree) if there are no staged
+// or modified files.
+// Repository must be initialized.
+{
+    TraceSpan span("fetch");
+
+    TransferResult result;
+    std::filesystem::path remote_root;
+    if(!initialized())
+    {
+        result.error = not_initialized_error();
+        return result;
+    }
+    if(!find_repository_root(remote, remote_root))
+    {
+        result.error = {ErrorCode::RepositoryNotFound, remote + " is not a MiniGit repository."};
+        return result;
+    }
+    if(read_hash_algorithm(remote_root) != hasher.algorithm())
+    {
+        result.error = {ErrorCode::ObjectFormatMismatch, remote + " uses a different object format (" +
+            hash_algorithm_name(read_hash_algorithm(remote_root)) + ")."};
+        return result;
+    }
+
+    try
+    {
+        std::vector<std::string> staged;
+        std::vector<std::string> modified;
+        std::vector<std::string> untracked;
+        get_working_directory_files_statuses(staged, modified, untracked);
+
+        // Branches checked out in other working trees are never updated, the current one only if it is clean
+        std::string current_branch = get_current_branch();
+        bool clean = staged.empty() && modified.empty() && !std::filesystem::exists(MINIGIT_MERGING_FLAG_PATH);
+        std::vector<std::string> checked_out = checked_out_branches(common_root);
+        if(clean)
+        {
+            checked_out.erase(std::remove(checked_out.begin(), checked_out.end(), current_branch), checked_out.end());
+        }
+
+        CommitInfo old_commit_info;
+        get_previous_commit_info(old_commit_info);
+
+        transfer_branches(remote_root, common_root, list_branch_names(remote_root), checked_out, result);
+
+        for(auto const& update : result.updates)
+        {
+            if(update.branch == current_branch && 
+                (update.status == RefUpdateStatus::Created || update.status == RefUpdateStatus::FastForward))
+            {
+                CommitInfo new_commit_info;
+                get_previous_commit_info(new_commit_info);
+                update_working_tree(old_commit_info.file_hashes, new_commit_info.file_hashes);
+            }
+        }
+    }
+    catch (const std::filesystem::filesystem_error& e)
+    {
+        result.error = {ErrorCode::FilesystemError, e.what()};
+    }
+
+    return result;
+}
+
+TransferResult RepositoryImpl::push(const std::string& remote, const std::string& branch)
+// Fast-forwards (or creates) the branch (by default the current branch) in the remote repository
+// to the local branch head.
+// Branches checked out in a working tree of the remote repository are never updated, as the working tree would not match.
+// Repository must be initialized.
+{
+    TraceSpan span("push");
+
+    TransferResult result;
+    result.branch = branch.empty() ? get_current_branch() : branch;
+    std::filesystem::path remote_root;
+    if(!initialized())
+    {
+        result.error = not_initialized_error();
+        return result;
+    }
+    if(!std::filesystem::exists(common_root / MINIGIT_BRANCHES_PATH / result.branch))
+    {
+        result.error = {ErrorCode::BranchNotFound, "no such branch: " + result.branch};
+        return result;
+    }
+    if(!find_repository_root(remote, remote_root))
+    {
+        result.error = {ErrorCode::RepositoryNotFound, remote + " is not a MiniGit repository."};
+        return result;
+    }
+    if(read_hash_algorithm(remote_root) != hasher.algorithm())
+    {
+        result.error = {ErrorCode::ObjectFormatMismatch, remote + " uses a different object format (" +
+            hash_algorithm_name(read_hash_algorithm(remote_root)) + ")."};
+        return result;
+    }
+
+    try
+    {
+        transfer_branches(common_root, remote_root, {result.branch}, checked_out_branches(remote_root), result);
+    }
+    catch (const std::filesystem::filesystem_error& e)
+    {
+        result.error = {ErrorCode::FilesystemError, e.what()};
+    }
+
+    return result;
+}
+
+WorktreeResult RepositoryImpl::add_worktree(const std::string& path, const std::string& branch)
+// Creates a linked working tree in path with branch checked out. It shares the objects, refs and branch logs
+// of this repository and has its own HEAD, index and merge state. A branch can only be checked out in one
+// working tree at a time.
+// Repository must be initialized.
+{
+    TraceSpan span("add_worktree");
+
+    WorktreeResult result;
+    if(!initialized())
+    {
+        result.error = not_initialized_error();
+        return result;
+    }
+    if(!std::filesystem::exists(common_root / MINIGIT_BRANCHES_PATH / branch))
+    {
+        result.error = {ErrorCode::BranchNotFound, "no such branch: " + branch};
+        return result;
+    }
+    if(is_checked_out(branch))
+    {
+        result.error = {ErrorCode::BranchCheckedOut, "Branch " + branch + " is already checked out in a working tree."};
+        return result;
+    }
+
+    std::filesystem::path worktree_path = std::filesystem::absolute(path).lexically_normal();
+    if(worktree_path.filename().empty())
+    {
+        worktree_path = worktree_path.parent_path();
+    }
+    std::error_code error;
+    if(std::filesystem::exists(worktree_path) && !std::filesystem::is_empty(worktree_path, error))
+    {
+        result.error = {ErrorCode::WorktreeExists, path + " already exists and is not empty."};
+        return result;
+    }
+
+    try
+    {
+        std::filesystem::create_directories(worktree_path / MINIGIT_LOGS_PATH);
+        std::ofstream(worktree_path / MINIGIT_COMMONDIR_PATH) << main_root().string();
+        std::ofstream(worktree_path / MINIGIT_HEAD_PATH) << branch;
+
+        CommitInfo commit_info;
+        load_commit_info(read_ref(common_root / MINIGIT_BRANCHES_PATH / branch), commit_info);
+        write_tracked_files(commit_info.file_hashes, worktree_path / MINIGIT_INDEX_PATH);
+
+        Materializer materializer;
+        for(auto const& entry : commit_info.file_hashes)
+        {
+            add_blob(materializer, entry.id, worktree_path / path_of(entry));
+        }
+        materializer.run();
+
+        LogEntry log_entry;
+        log_entry.author = author_name();
+        log_entry.timestamp = timepoint_to_string(std::chrono::system_clock::now());
+        log_entry.message = "Created working tree on branch " + branch;
+        log_entry.new_commit_id = commit_info.id;
+        write_log_entry((worktree_path / MINIGIT_HEAD_LOG_PATH).string(), log_entry);
+
+        // Register the working tree under a unique name, so gc and the other working trees can find it
+        std::filesystem::path worktrees_path = common_root / MINIGIT_WORKTREES_PATH;
+        std::filesystem::create_directories(worktrees_path);
+        std::string name = worktree_path.filename().string();
+        for(int suffix = 1; std::filesystem::exists(worktrees_path / name); suffix++)
+        {
+            name = worktree_path.filename().string() + std::to_string(suffix);
+        }
+        std::ofstream(worktrees_path / name) << worktree_path.string();
+    }
+    catch (const std::filesystem::filesystem_error& e)
+    {
+        result.error = {ErrorCode::FilesystemError, e.what()};
+        return result;
+    }
+
+    return list_worktrees();
+}
+
+WorktreeResult RepositoryImpl::list_worktrees() const
+// Returns the main working tree and the linked ones, with the branch each has checked out.
+// Repository must be initialized.
+{
+    TraceSpan span("list_worktrees");
+
+    WorktreeResult result;
+    if(!initialized())
+    {
+        result.error = not_initialized_error();
+        return result;
+    }
+
+    result.worktrees.push_back({main_root(), get_current_branch(common_root)});
+
+    std::vector<std::filesystem::path> registered = read_worktree_registry(common_root);
+    std::sort(registered.begin(), registered.end());
+    for(auto const& worktree_path : registered)
+    {
+        bool exists = std::filesystem::exists(worktree_path / MINIGIT_COMMONDIR_PATH);
+        result.worktrees.push_back({worktree_path, exists ? get_current_branch(worktree_path) : "", !exists});
+    }
+
+    return result;
+}
+
+WorktreeResult RepositoryImpl::prune_worktrees()
+// Forgets linked working trees whose directory has been deleted.
+// Repository must be initialized.
+{
+    TraceSpan span("prune_worktrees");
+
+    WorktreeResult result;
+    if(!initialized())
+    {
+        result.error = not_initialized_error();
+        return result;
+    }
+
+    std::filesystem::path worktrees_path = common_root / MINIGIT_WORKTREES_PATH;
+    if(std::filesystem::exists(worktrees_path))
+    {
+        for(auto const& dir_entry : std::filesystem::directory_iterator {worktrees_path})
+        {
+            std::string worktree_path;
+            std::ifstream registration(dir_entry.path());
+            std::getline(registration, worktree_path);
+            if(!std::filesystem::exists(std::filesystem::path(worktree_path) / MINIGIT_COMMONDIR_PATH))
+            {
+                std::filesystem::remove(dir_entry.path());
+                result.pruned++;
+            }
+        }
+    }
+
+    result.worktrees = list_worktrees().worktrees;
+    return result;
+}
+
+bool RepositoryImpl::initialized() const
+// Returns true if the repository has been initialized, false otherwise.
+{
+    const std::filesystem::path files_path {MINIGIT_FILES_PATH};
+
+    return std::filesystem::exists(files_path);
+}
+
+Error RepositoryImpl::not_initialized_error() const
+{
+    return {ErrorCode::NotInitialized, "Repository not initialized."};
+}
+
+std::string RepositoryImpl::author_name() const
+// Name recorded as the author of commits and reflog entries. There is no configuration yet, so it is fixed.
+{
+    return "Author";
+}
+
+void RepositoryImpl::load_working_directory_files(std::vector<std::string>& working_directory_files) const
+// Load working directory files into working_directory_files, sorted by name.
+// The directory is only read if its last write time differs from that of the cached listing.
+// The whole listing is held in memory: readdir order is arbitrary, so it cannot be merged before it is sorted.
+{
+    TraceSpan span("walk_working_directory");
+
+    UntrackedCache untracked_cache(MINIGIT_UNTRACKED_CACHE_PATH);
+    std::error_code error;
+    std::filesystem::file_time_type directory_time = std::filesystem::last_write_time(".", error);
+    if(!error && untracked_cache.load(directory_time, working_directory_files))
+    {
+        return;
+    }
+
+    for(auto const& dir_entry : std::filesystem::directory_iterator {"."})
+    {
+        span.add_counter(TRACE_FILES_STATED, 1);
+        if(dir_entry.is_regular_file())
+        {
+            working_directory_files.push_back(dir_entry.path().filename().string());
+        }     
+    }
+
+    // Directory order is arbitrary; the status merge-join needs names in PathMap order
+    std::sort(working_directory_files.begin(), working_directory_files.end());
+
+    if(!error)
+    {
+        untracked_cache.store(directory_time, working_directory_files);
+    }
+}
+
+bool RepositoryImpl::load_commit_info(const ObjectId& id, CommitInfo& commit_info) const
+// Load commit information from file.
+{
+    return load_commit_info(object_store, id, commit_info);
+}
+
+bool RepositoryImpl::load_commit_info(const ObjectStore& store, const ObjectId& id, CommitInfo& commit_info) const
+// Load commit information from the object directories of store (possibly another repository's).
+{
+    nlohmann::json json_data;
+    std::filesystem::path file_path = store.find(ObjectType::Commit, id);
+    bool file_exists = std::filesystem::exists(file_path);
+    
+    if(file_exists)
+    {
+        TraceSpan span("load_commit_info");
+        if(span.enabled())
+        {
+            span.add_counter(TRACE_BYTES_READ, std::filesystem::file_size(file_path));
+        }
+
+        std::ifstream file(file_path);
+        file >> json_data;
+        commit_info = json_data.get<CommitInfo>();
+    }
+    
+    return file_exists;
+}
+
+void RepositoryImpl::write_commit_info(CommitInfo& commit_info) const
+// Write commit info to file. The files changed since parent 1, with their line counts, are recorded
+// in the commit first, and the changed paths are added to the changed path filters.
+{
+    TraceSpan span("write_commit_info");
+
+    CommitInfo parent_info;
+    if(!commit_info.parent_1_id.is_null())
+    {
+        load_commit_info(commit_info.parent_1_id, parent_info);
+    }
+    compute_changes(commit_info, parent_info, commit_info.changes);
+    commit_info.changes_recorded = true;
+
+    nlohmann::json json_data;
+    json_data = commit_info;
+    std::filesystem::path file_path = object_store.local_path(ObjectType::Commit, commit_info.id);
+    std::ofstream(file_path.string()) << json_data.dump(4);
+
+    ObjectIndex(common_root / MINIGIT_COMMITS_PATH, common_root / MINIGIT_COMMITS_INDEX_PATH, hasher.id_size()).insert({commit_info.id});
+
+    std::vector<std::string_view> changed_paths;
+    for(auto const& change : commit_info.changes)
+    {
+        changed_paths.push_back(change.path);
+    }
+    ChangedPathIndex(common_root / MINIGIT_CHANGED_PATHS_PATH, hasher.id_size()).add(commit_info.id, changed_paths);
+}
+
+bool RepositoryImpl::load_tracked_files(PathMap& tracked_files, const std::filesystem::path& index_path) const
+// Load tracked files from index (by default the index of this working tree).
+{ 
+    bool index_exists = std::filesystem::exists(index_path);
+    if(index_exists)
+    {
+        TraceSpan span("load_tracked_files");
+        if(span.enabled())
+        {
+            span.add_counter(TRACE_BYTES_READ, std::filesystem::file_size(index_path));
+        }
+
+        std::ifstream file(index_path.string());
+        nlohmann::json json_data;
+        file >> json_data;
+        tracked_files = json_data["tracked_files"].get<PathMap>();
+    }
+    return index_exists;
+}
+
+void RepositoryImpl::write_tracked_files(const PathMap& tracked_files, const std::filesystem::path& index_path) const
+// Write tracked files to index (JSON file).
+{
+    TraceSpan span("write_tracked_files");
+
+    nlohmann::json json_data;
+    json_data["tracked_files"] = tracked_files;
+    std::ofstream file(index_path.string());
+    file << json_data.dump(4); 
+    file.close();
+}
+
+ObjectId RepositoryImpl::hash(const std::string& input) const
+// Returns the id of the input string under the repository's hash algorithm.
+{
+    return hasher.hash(input);
+}
+
+HashAlgorithm RepositoryImpl::read_hash_algorithm(const std::filesystem::path& root)
+// Returns the hash algorithm recorded in the config of the repository in root. Repositories without
+// a config (or without an object_format entry) use SHA-1.
+{
+    HashAlgorithm algorithm = HashAlgorithm::Sha1;
+    std::ifstream file((root / MINIGIT_CONFIG_PATH).string());
+    if(file)
+    {
+        nlohmann::json json_data = nlohmann::json::parse(file, nullptr, false);
+        if(json_data.is_object() && json_data.contains("object_format") && json_data["object_format"].is_string())
+        {
+            parse_hash_algorithm(json_data["object_format"].get<std::string>(), algorithm);
+        }
+    }
+    return algorithm;
+}
+
+std::string RepositoryImpl::get_current_branch(const std::filesystem::path& root) const 
+// Returns the current branch name of this repository, or of the repository in root.
+{
+    // Get current branch name from the HEAD file
+    std::ifstream head((root / MINIGIT_HEAD_PATH).string());  
+    std::stringstream buffer;
+    buffer << head.rdbuf();
+    std::string branch = buffer.str();
+    head.close();
+    return branch;
+}
+
+ObjectId RepositoryImpl::get_file_hash(std::string filename) const
+// Returns the hash for a file using its name, last modified timestamp and size.
+{
+    return hash(file_hash_input(filename));
+}
+
+std::string RepositoryImpl::file_hash_input(const std::string& filename) const
+// Returns the string a file's hash is computed from: its name, last modified timestamp and size.
+{
+    TraceSpan span("get_file_hash");
+    span.add_counter(TRACE_FILES_STATED, 1);
+
+    std::filesystem::path file {filename};
+    return file_hash_input(filename, std::filesystem::last_write_time(file), std::filesystem::file_size(file));
+}
+
+std::string RepositoryImpl::file_hash_input(const std::string& filename, std::filesystem::file_time_type timestamp,
+    std::uintmax_t size) const
+{
+    return filename + std::to_string(timestamp.time_since_epoch().count()) + std::to_string(size);
+}
+
+ObjectId RepositoryImpl::read_ref(const std::filesystem::path& ref_path) const
+// Returns the commit id stored in a ref file (branch head or MERGE_HEAD), or the null id if there is none.
+{
+    ObjectId id;
+    std::ifstream ref(ref_path.string());
+    if(ref)
+    {
+        char hex[ObjectId::MAX_HEX_SIZE];
+        ref.read(hex, sizeof(hex));
+        ObjectId::from_hex(std::string_view(hex, static_cast<std::size_t>(ref.gcount())), id);
+    }
+    return id;
+}
+
+void RepositoryImpl::write_ref(const std::filesystem::path& ref_path, const ObjectId& id) const
+// Writes a commit id to a ref file.
+{
+    std::ofstream ref(ref_path.string());
+    ref << id.to_hex();
+    ref.close();
+}
+
+ObjectId RepositoryImpl::object_id_from_path(const std::filesystem::path& object_path) const
+// Returns the id encoded in an object file name, or the null id if the name is not an id.
+{
+    ObjectId id;
+    ObjectId::from_hex(object_path.filename().string(), id);
+    return id;
+}
+
+void RepositoryImpl::copy_file_with_timestamp(const std::filesystem::path& source, const std::filesystem::path& destination) const
+// Copies source to destination (which must not exist) and preserves the last write time.
+{
+    TraceSpan span("copy_blob");
+
+    std::filesystem::copy_file(source, destination, std::filesystem::copy_options::none);
+
+    // Make sure to copy timestamp as well, otherwise the hash will differ
+    auto timestamp = std::filesystem::last_write_time(source);
+    std::filesystem::last_write_time(destination, timestamp);
+
+    if(span.enabled())
+    {
+        span.add_counter(TRACE_BYTES_WRITTEN, std::filesystem::file_size(destination));
+    }
+}
+
+void RepositoryImpl::store_blob(const std::filesystem::path& source, const ObjectId& id) const
+// Writes the blob of source: files of at least CHUNKING_THRESHOLD bytes as a list of deduplicated chunks,
+// smaller ones as a copy.
+{
+    std::error_code error;
+    if(std::filesystem::file_size(source, error) >= CHUNKING_THRESHOLD && !error)
+    {
+        write_chunked_blob(source, object_store.local_path(ObjectType::ChunkList, id), object_store, hasher);
+    }
+    else
+    {
+        copy_file_with_timestamp(source, object_store.local_path(ObjectType::Blob, id));
+    }
+}
+
+void RepositoryImpl::add_blob(Materializer& materializer, const ObjectId& id, const std::filesystem::path& destination) const
+// Queues writing the blob to destination. A chunked blob is reassembled from its chunks.
+{
+    bool chunked = false;
+    std::filesystem::path blob_path = object_store.find_blob(id, chunked);
+    if(!chunked)
+    {
+        materializer.add(blob_path, destination);
+        return;
+    }
+
+    std::vector<ChunkRef> chunks;
+    if(!read_chunk_list(blob_path, hasher.id_size(), chunks))
+    {
+        throw std::filesystem::filesystem_error("damaged chunk list", blob_path, destination,
+            std::make_error_code(std::errc::io_error));
+    }
+
+    std::vector<std::filesystem::path> chunk_paths;
+    chunk_paths.reserve(chunks.size());
+    for(auto const& chunk : chunks)
+    {
+        chunk_paths.push_back(object_store.find(ObjectType::Chunk, chunk.id));
+    }
+    materializer.add(blob_path, destination, std::move(chunk_paths));
+}
+
+bool RepositoryImpl::read_blob_lines(const ObjectId& id, FileLines& file) const
+// Reads the content of the blob and splits it into lines. A chunked blob is reassembled from its chunks.
+{
+    bool chunked = false;
+    std::filesystem::path blob_path = object_store.find_blob(id, chunked);
+    if(!chunked)
+    {
+        return read_lines(blob_path, file);
+    }
+
+    std::vector<ChunkRef> chunks;
+    bool complete = read_chunk_list(blob_path, hasher.id_size(), chunks) && read_chunked_blob(chunks, object_store, file.content);
+    split_lines(file);
+    return complete;
+}
+
+void RepositoryImpl::get_previous_commit_info(CommitInfo& commit_info) const
+// Retrieves the last commit information from the log.
+{
+    // Instead of using the HEAD info to get the current branch, read
+    // last commit id from the log, since the branch could have changed 
+    // in the meantime.
+
+    std::vector<LogEntry> entries;
+
+    read_log((common_root / MINIGIT_BRANCHES_LOG_PATH / get_current_branch()).string(), entries);
+    if(entries.size() > 0)
+    {
+        load_commit_info(entries.back().new_commit_id, commit_info);
+    }
+}
+
+void RepositoryImpl::walk_statuses(const StatusVisitor& visit) const
+// Calls visit for every path whose status is not clean, in path order.
+// The sorted directory listing, the index and the HEAD tree are combined in one merge-join pass, 
+// so each path is compared and reported as soon as it is reached:
+//  - a file that is in the working directory but not in the index is untracked,
+//  - a file that is in the index but has a different hash than current hash is modified,
+//  - a file that is in the index but missing from the working directory is deleted,
+//  - a file that is in the index but not in the HEAD (or has a different hash in the index than in the HEAD,
+//    or if HEAD has not been commited yet) is staged,
+//  - a file that is in the HEAD but not in the index is a staged deletion.
+// Tracked files outside the sparse checkout only report staged changes.
+//
+// Only the output is streamed: entries are not collected, but memory is not bounded. The inputs of the join
+// are loaded whole first: the sorted directory listing, the index and the HEAD tree (both are single JSON
+// documents, which cannot be read incrementally), so memory grows with the number of files in each.
+{
+    TraceSpan span("working_directory_statuses");
+
+    std::vector<std::string> working_directory_files;
+    load_working_directory_files(working_directory_files);
+
+    PathMap tracked_files;
+    load_tracked_files(tracked_files);
+
+    CommitInfo head;
+    get_previous_commit_info(head);
+
+    SparseCheckout sparse_checkout;
+    sparse_checkout.load(MINIGIT_SPARSE_CHECKOUT_PATH);
+
+    auto file = working_directory_files.cbegin();
+
+    merge_join(tracked_files, head.file_hashes, 
+        [&](PathId path_id, const ObjectId* index_hash, const ObjectId* head_hash)
+    {
+        const std::string& path = PathTable::instance().path(path_id);
+
+        // Working directory files sorting before this path are in neither the index nor HEAD
+        for(; file != working_directory_files.cend() && *file < path; ++file)
+        {
+            visit({*file, FileState::Untracked, FileState::Untracked});
+        }
+
+        bool in_working_directory = file != working_directory_files.cend() && *file == path;
+        if(in_working_directory)
+        {
+            ++file;
+        }
+
+        StatusEntry entry {path};
+        if(index_hash == nullptr) // Only in HEAD
+        {
+            entry.staged = FileState::Deleted;
+            visit(entry);
+            if(in_working_directory)
+            {
+                visit({path, FileState::Untracked, FileState::Untracked});
+            }
+            return;
+        }
+
+        if(head_hash == nullptr || *head_hash != *index_hash)
+        {
+            entry.staged = FileState::Modified;
+        }
+
+        if(!sparse_checkout.includes(path))
+        {
+            // Outside the sparse checkout: not expected in the working tree, and never stat'ed
+        }
+        else if(!in_working_directory)
+        {
+            entry.unstaged = FileState::Deleted;
+        }
+        else if(get_file_hash(path) != *index_hash)
+        {
+            entry.unstaged = FileState::Modified;
+        }
+
+        if(entry.staged != FileState::Unchanged || entry.unstaged != FileState::Unchanged)
+        {
+            visit(entry);
+        }
+    });
+
+    for(; file != working_directory_files.cend(); ++file)
+    {
+        visit({*file, FileState::Untracked, FileState::Untracked});
+    }
+}
+
+void RepositoryImpl::get_working_directory_files_statuses(
+    std::vector<std::string>& staged, 
+    std::vector<std::string>& modified, 
+    std::vector<std::string>& untracked) const
+// Collects the staged, modified and untracked files, as used by the commands that must not lose uncommitted work.
+// Files deleted from the working directory are not reported: their content is still in the index.
+{
+    walk_statuses([&](const StatusEntry& entry)
+    {
+        if(entry.unstaged == FileState::Untracked)
+        {
+            untracked.emplace_back(entry.path);
+            return;
+        }
+        if(entry.staged != FileState::Unchanged)
+        {
+            staged.emplace_back(entry.path);
+        }
+        if(entry.unstaged == FileState::Modified)
+        {
+            modified.emplace_back(entry.path);
+        }
+    });
+}
+
+std::vector<ObjectIndex> RepositoryImpl::commit_indexes() const
+// The commit index of this repository followed by those of its alternates.
+{
+    std::vector<ObjectIndex> indexes;
+    indexes.emplace_back(common_root / MINIGIT_COMMITS_PATH, common_root / MINIGIT_COMMITS_INDEX_PATH, hasher.id_size());
+    for(auto const& alternate : object_store.get_alternates())
+    {
+        indexes.emplace_back(alternate / "commits", alternate / "commits.idx", hasher.id_size());
+    }
+    return indexes;
+}
+
+Error RepositoryImpl::resolve_commit_id(const std::string& hex_prefix, ObjectId& commit_id) const
+// Resolves a full or abbreviated (at least 4 hex digits) commit id through the commit indexes.
+{
+    bool found = false;
+    bool ambiguous = false;
+    for(auto& commit_index : commit_indexes())
+    {
+        ObjectId match;
+        PrefixMatch result = commit_index.resolve(hex_prefix, match);
+        if(result == PrefixMatch::Ambiguous || (result == PrefixMatch::Unique && found && match != commit_id))
+        {
+            ambiguous = true;
+        }
+        else if(result == PrefixMatch::Unique)
+        {
+            found = true;
+            commit_id = match;
+        }
+    }
+
+    // A full id does not need an index, e.g. for an alternate that has none
+    if(!found && ObjectId::from_hex(hex_prefix, commit_id) && object_store.contains(ObjectType::Commit, commit_id))
+    {
+        found = true;
+    }
+
+    if(ambiguous)
+    {
+        return {ErrorCode::AmbiguousCommitId, "commit id " + hex_prefix + " is ambiguous."};
+    }
+    if(!found)
+    {
+        return {ErrorCode::InvalidCommitId, "commit id is not valid for this branch."};
+    }
+    return {};
+}
+
+bool RepositoryImpl::is_revert_commit_id_valid(const ObjectId& commit_id) const
+// Checks the sorted index of the branch log to see if the commit id is found
+{
+    return branch_commit_index(common_root, get_current_branch()).contains(commit_id);
+}
+
+ObjectIndex RepositoryImpl::branch_commit_index(const std::filesystem::path& root, const std::string& branch) const
+// Sorted index of the commits the branch log of root has recorded as new heads of branch.
+// Rebuilt from the log when missing, so it must be updated whenever the log is written.
+{
+    std::filesystem::path log_path = root / MINIGIT_BRANCHES_LOG_PATH / branch;
+    return ObjectIndex([log_path](std::vector<ObjectId>& ids)
+    {
+        std::vector<LogEntry> entries;
+        read_log(log_path.string(), entries);
+        for(auto const& entry : entries)
+        {
+            ids.push_back(entry.new_commit_id);
+        }
+    }, root / MINIGIT_BRANCH_COMMITS_PATH / branch, hasher.id_size());
+}
+
+void RepositoryImpl::write_branch_log_entry(const std::string& branch, const LogEntry& log_entry) const
+// Appends an entry to the branch log and records its commit in the branch's commit index.
+{
+    write_log_entry((common_root / MINIGIT_BRANCHES_LOG_PATH / branch).string(), log_entry);
+    branch_commit_index(common_root, branch).insert({log_entry.new_commit_id});
+}
+
+void RepositoryImpl::perform_merge(const ObjectId& base_commit_id, 
+    const ObjectId& branch_1_commit_id, 
+    const ObjectId& branch_2_commit_id,
+    bool& merge_performed,
+    bool& conflict,
+    std::vector<std::string>& merge_failed_files) const
+{
+    CommitInfo base_commit_info;
+    CommitInfo branch_1_commit_info;
+    CommitInfo branch_2_commit_info;
+    load_commit_info(base_commit_id, base_commit_info);
+    load_commit_info(branch_1_commit_id, branch_1_commit_info);
+    load_commit_info(branch_2_commit_id, branch_2_commit_info);
+
+    // One slot per path of the merged tree, in path order. Files changed on both sides keep the 
+    // branch 2 (and base) hash so they can be merged line by line.
+    typedef struct MergedFile
+    {
+        PathEntry entry;                          // path and resulting blob hash
+        const ObjectId* base_hash = nullptr;      // set for 3-way merges
+        const ObjectId* branch_2_hash = nullptr;  // set when the file needs a line merge
+        bool conflict = false;
+    } MergedFile;
+
+    std::vector<MergedFile> merged_files;
+
+    // Walk the three trees in path order and decide what each path becomes
+    merge_join(base_commit_info.file_hashes, branch_1_commit_info.file_hashes, branch_2_commit_info.file_hashes,
+        [&merged_files](PathId path, const ObjectId* base_hash, const ObjectId* branch_1_hash, const ObjectId* branch_2_hash)
+    {
+        if(branch_2_hash == nullptr)
+        {
+            // File not found in branch 2, so keep the branch 1 version (if any)
+            if(branch_1_hash != nullptr)
+            {
+                merged_files.push_back({{path, *branch_1_hash}});
+            }
+        }
+        else if(branch_1_hash == nullptr)
+        {
+            // File not found in branch 1, so add it to the merged content
+            merged_files.push_back({{path, *branch_2_hash}});
+        }
+        else if(base_hash == nullptr)
+        {
+            // File is found in both branches but not in base, so peform 2-way merge
+            merged_files.push_back({{path, *branch_1_hash}, nullptr, branch_2_hash});
+        }
+        else if(*branch_1_hash == *branch_2_hash || *branch_2_hash == *base_hash)
+        {
+            // Same version in both branches, or only branch 1 changed it: keep branch 1
+            merged_files.push_back({{path, *branch_1_hash}});
+        }
+        else if(*branch_1_hash == *base_hash)
+        {
+            // Only branch 2 changed the file, so take the branch 2 version
+            merged_files.push_back({{path, *branch_2_hash}});
+        }
+        else
+        {
+            // File has been changed in both branches, so try line by line merge of file
+            merged_files.push_back({{path, *branch_1_hash}, base_hash, branch_2_hash});
+        }
+    });
+
+    // Update the working directory. Unmerged files are restored from their blobs in one batch; 
+    // line merges run in parallel and are written in place. A clean merge result is stored as a new blob 
+    // so that the index and merge commit record the merged content.
+    // Conflicted files keep their branch 1 hash in the index, so they show as modified until resolved.
+    // Paths outside the sparse checkout are not written, except to resolve a line merge: a clean result is 
+    // removed again once stored as a blob, a conflict is left for the user to resolve.
+    SparseCheckout sparse_checkout;
+    sparse_checkout.load(MINIGIT_SPARSE_CHECKOUT_PATH);
+    Materializer materializer;
+    std::vector<MergedFile*> line_merges;
+    for(auto& file : merged_files)
+    {
+        if(file.branch_2_hash == nullptr)
+        {
+            if(sparse_checkout.includes(path_of(file.entry)))
+            {
+                add_blob(materializer, file.entry.id, path_of(file.entry));
+            }
+        }
+        else
+        {
+            line_merges.push_back(&file);
+        }
+    }
+    materializer.run();
+
+    ThreadPool pool;
+    parallel_for(pool, line_merges.size(), [this, &line_merges, &sparse_checkout](std::size_t begin, std::size_t end)
+    {
+        for(std::size_t i = begin; i < end; i++)
+        {
+            MergedFile& file = *line_merges[i];
+            const std::string& filename = path_of(file.entry);
+
+            file.conflict = perform_file_merge(filename, file.base_hash, file.entry.id, *file.branch_2_hash);
+            if(!file.conflict)
+            {
+                file.entry.id = get_file_hash(filename);
+                if(!object_store.contains_blob(file.entry.id))
+                {
+                    store_blob(filename, file.entry.id);
+                }
+                if(!sparse_checkout.includes(filename))
+                {
+                    std::filesystem::remove(filename);
+                }
+            }
+        }
+    });
+
+    // Collect the results in path order, so the outcome does not depend on scheduling
+    PathMap merged_content;
+    merged_content.reserve(merged_files.size());
+    for(auto const& file : merged_files)
+    {
+        if(file.branch_2_hash != nullptr)
+        {
+            merge_performed = true;
+        }
+        if(file.conflict)
+        {
+            conflict = true;
+            merge_failed_files.push_back(path_of(file.entry));
+        }
+        merged_content.push_back(file.entry.path, file.entry.id);
+    }
+
+    // Update the index
+    write_tracked_files(merged_content);
+}
+
+bool RepositoryImpl::perform_file_merge(const std::string& filename, const ObjectId* base_file_hash, 
+    const ObjectId& branch_1_file_hash, const ObjectId& branch_2_file_hash) const
+// Writes the line by line merge of the two versions to filename and returns true if any line conflicts.
+// With a base the merge is 3-way and only lines changed differently on both sides conflict;
+// without one (2-way) every differing line conflicts.
+// Safe to call from several threads for different files.
+{
+    FileLines base_file;
+    FileLines branch_1_file;
+    FileLines branch_2_file;
+    if(base_file_hash != nullptr)
+    {
+        read_blob_lines(*base_file_hash, base_file);
+    }
+    read_blob_lines(branch_1_file_hash, branch_1_file);
+    read_blob_lines(branch_2_file_hash, branch_2_file);
+
+    std::string out;
+    bool conflict = merge_lines(base_file_hash != nullptr ? &base_file : nullptr, branch_1_file, branch_2_file, out);
+
+    write_file(filename, out);
+
+    return conflict;
+}
+
+void RepositoryImpl::collect_reachable_objects(std::unordered_set<ObjectId>& reachable_commits,
+    std::unordered_set<ObjectId>& reachable_blobs) const
+// Collects every commit reachable from the branch heads, MERGE_HEAD and the reflogs, following commit parents,
+// together with the blobs referenced by those commits and by the index. MERGE_HEAD, the HEAD log and the index
+// of every working tree count.
 {
-    bool conflict = false;
+    TraceSpan span("collect_reachable_objects");
+
+    std::stack<ObjectId> pending;
 
-    std::ifstream base_file((MINIGIT_BLOBS_PATH / base_file_hash).string());  
-    std::stringstream base_file_buffer;
-    base_file_buffer << base_file.rdbuf();
-     std::vector<std::string> base_file_lines;
-    std::string b_line;
-    while (std::getline(base_file_buffer, b_line))
+    for(auto const& dir_entry : std::filesystem::directory_iterator {common_root / MINIGIT_BRANCHES_PATH})
     {
-        base_file_lines.push_back(b_line);
-    }    
-    base_file.close();
+        if(dir_entry.is_regular_file())
+        {
+            pending.push(read_ref(dir_entry.path()));
+        }
+    }
 
-    std::ifstream branch_1_file((MINIGIT_BLOBS_PATH / branch_1_file_hash).string());  
-    std::stringstream branch_1_file_buffer;
-    branch_1_file_buffer << branch_1_file.rdbuf();
-    std::vector<std::string> branch_1_file_lines;
-    std::string f1_line;
-    while (std::getline(branch_1_file_buffer, f1_line))
+    std::vector<std::filesystem::path> worktree_roots = list_worktree_roots(common_root);
+    std::vector<std::filesystem::path> log_paths;
+    for(auto const& root : worktree_roots)
     {
-        branch_1_file_lines.push_back(f1_line);
-    }    
-    branch_1_file.close();
+        pending.push(read_ref(root / MINIGIT_MERGE_HEAD_PATH));
+        log_paths.push_back(root / MINIGIT_HEAD_LOG_PATH);
+    }
+    for(auto const& dir_entry : std::filesystem::directory_iterator {common_root / MINIGIT_BRANCHES_LOG_PATH})
+    {
+        if(dir_entry.is_regular_file())
+        {
+            log_paths.push_back(dir_entry.path());
+        }
+    }
+    for(auto const& log_path : log_paths)
+    {
+        std::vector<LogEntry> entries;
+        read_log(log_path.string(), entries);
+        for(auto const& entry : entries)
+        {
+            pending.push(entry.old_commit_id);
+            pending.push(entry.new_commit_id);
+            pending.push(entry.other_commit_id);
+        }
+    }
 
-    std::ifstream branch_2_file((MINIGIT_BLOBS_PATH / branch_2_file_hash).string());  
-    std::stringstream branch_2_file_buffer;
-    branch_2_file_buffer << branch_2_file.rdbuf();
-    std::vector<std::string> branch_2_file_lines;
-    std::string f2_line;
-    while (std::getline(branch_2_file_buffer, f2_line))
+    while(!pending.empty())
     {
-        branch_2_file_lines.push_back(f2_line);
-    }  
-    branch_2_file.close();    
+        ObjectId commit_id = pending.top();
+        pending.pop();
 
-    size_t max_lines = std::max({base_file_lines.size(), branch_1_file_lines.size(), branch_2_file_lines.size()});
-    std::string out;
+        if(commit_id.is_null() || !reachable_commits.insert(commit_id).second)
+        {
+            continue;
+        }
+
+        CommitInfo commit_info;
+        if(load_commit_info(commit_id, commit_info))
+        {
+            for(auto const& entry : commit_info.file_hashes)
+            {
+                reachable_blobs.insert(entry.id);
+            }
+            pending.push(commit_info.parent_1_id);
+            pending.push(commit_info.parent_2_id);
+        }
+    }
+
+    // Staged blobs are reachable from the index even before they are committed
+    for(auto const& root : worktree_roots)
+    {
+        PathMap tracked_files;
+        load_tracked_files(tracked_files, root / MINIGIT_INDEX_PATH);
+        for(auto const& entry : tracked_files)
+        {
+            reachable_blobs.insert(entry.id);
+        }
+    }
+}
+
+void RepositoryImpl::check_refs(const std::function<void(const std::string& problem)>& report) const
+// Reports branch refs and MERGE_HEADs that do not name an existing commit, and reflogs that cannot be read or whose
+// newest entry does not name an existing commit (or, for a branch log, the branch head). Older entries may name
+// commits this repository never had, since fetch and clone copy the branch logs but only the commits of the heads.
+{
+    std::vector<std::filesystem::path> ref_paths;
+    for(auto const& dir_entry : std::filesystem::directory_iterator {common_root / MINIGIT_BRANCHES_PATH})
+    {
+        if(dir_entry.is_regular_file())
+        {
+            ref_paths.push_back(dir_entry.path());
+        }
+    }
+    std::vector<std::filesystem::path> log_paths;
+    for(auto const& root : list_worktree_roots(common_root))
+    {
+        if(std::filesystem::exists(root / MINIGIT_MERGE_HEAD_PATH))
+        {
+            ref_paths.push_back(root / MINIGIT_MERGE_HEAD_PATH);
+        }
+        if(std::filesystem::exists(root / MINIGIT_HEAD_LOG_PATH))
+        {
+            log_paths.push_back(root / MINIGIT_HEAD_LOG_PATH);
+        }
+    }
+    for(auto const& dir_entry : std::filesystem::directory_iterator {common_root / MINIGIT_BRANCHES_LOG_PATH})
+    {
+        if(dir_entry.is_regular_file())
+        {
+            log_paths.push_back(dir_entry.path());
+        }
+    }
+
+    for(auto const& ref_path : ref_paths)
+    {
+        ObjectId id = read_ref(ref_path);
+        if(id.is_null())
+        {
+            report("ref " + ref_path.string() + ": not a commit id");
+        }
+        else if(!object_store.contains(ObjectType::Commit, id))
+        {
+            report("ref " + ref_path.string() + ": missing commit " + id.to_hex());
+        }
+    }
+
+    for(auto const& log_path : log_paths)
+    {
+        std::vector<LogEntry> entries;
+        try
+        {
+            read_log(log_path.string(), entries);
+        }
+        catch (const nlohmann::json::exception&)
+        {
+            report("log " + log_path.string() + ": cannot be parsed");
+        }
+        if(entries.empty())
+        {
+            continue;
+        }
+
+        const ObjectId& newest = entries.back().new_commit_id;
+        std::filesystem::path ref_path = common_root / MINIGIT_BRANCHES_PATH / log_path.filename();
+        bool is_branch_log = log_path.parent_path() == common_root / MINIGIT_BRANCHES_LOG_PATH;
+        if(is_branch_log && std::filesystem::exists(ref_path) && read_ref(ref_path) != newest)
+        {
+            report("log " + log_path.string() + ": newest entry is not the branch head");
+        }
+        else if(!newest.is_null() && !object_store.contains(ObjectType::Commit, newest))
+        {
+            report("log " + log_path.string() + ": missing commit " + newest.to_hex());
+        }
+    }
+}
+
+bool RepositoryImpl::is_object_older_than(const std::filesystem::path& object_path, long long seconds) const
+// Returns true if the object file was written more than the given number of seconds ago.
+// The last write time of blobs is copied from the working directory file, so the status change time
+// (set when the object file is created) is used instead.
+{
+    if(seconds <= 0)
+    {
+        return true;
+    }
+
+    struct stat object_stat;
+    if(stat(object_path.string().c_str(), &object_stat) != 0)
+    {
+        return false;
+    }
+
+    return std::time(nullptr) - object_stat.st_ctime > seconds;
+}
+
+bool RepositoryImpl::find_repository_root(const std::string& path, std::filesystem::path& root) const
+// Resolves the directory of another repository (the main working tree if path is a linked one).
+// Fails if it is not a repository or is this repository.
+{
+    std::error_code error;
+    root = std::filesystem::canonical(path, error);
+    if(!error && std::filesystem::exists(root / MINIGIT_COMMONDIR_PATH))
+    {
+        std::ifstream commondir(root / MINIGIT_COMMONDIR_PATH);
+        std::string common_root_path;
+        std::getline(commondir, common_root_path);
+        root = common_root_path;
+    }
+    return !error && std::filesystem::exists(root / MINIGIT_HEAD_PATH) &&
+        !std::filesystem::equivalent(root, main_root(), error);
+}
+
+std::vector<std::string> RepositoryImpl::list_branch_names(const std::filesystem::path& root) const
+// Returns the branches of the repository in root, sorted by name.
+{
+    std::vector<std::string> branches;
+    for(auto const& dir_entry : std::filesystem::directory_iterator {root / MINIGIT_BRANCHES_PATH})
+    {
+        if(dir_entry.is_regular_file())
+        {
+            branches.push_back(dir_entry.path().filename().string());
+        }
+    }
+    std::sort(branches.begin(), branches.end());
+    return branches;
+}
+
+bool RepositoryImpl::is_ancestor(const ObjectStore& store, const ObjectId& ancestor, const ObjectId& descendant) const
+// Returns true if ancestor is descendant or one of its ancestors, following both parents of merge commits.
+{
+    std::unordered_set<ObjectId> visited;
+    std::stack<ObjectId> pending;
+    pending.push(descendant);
+
+    while(!pending.empty())
+    {
+        ObjectId commit_id = pending.top();
+        pending.pop();
+
+        if(commit_id == ancestor)
+        {
+            return true;
+        }
+        if(commit_id.is_null() || !visited.insert(commit_id).second)
+        {
+            continue;
+        }
+
+        CommitInfo commit_info;
+        if(load_commit_info(store, commit_id, commit_info))
+        {
+            pending.push(commit_info.parent_1_id);
+            pending.push(commit_info.parent_2_id);
+        }
+    }
+    return false;
+}
+
+void RepositoryImpl::transfer_branches(const std::filesystem::path& from_root, const std::filesystem::path& to_root,
+    const std::vector<std::string>& branches, const std::vector<std::string>& checked_out, TransferResult& result) const
+// Copies branches from the repository in from_root to the one in to_root (an empty root is the current directory).
+// Only fast-forwards and new branches are accepted, and never for the checked_out branches.
+//
+// Negotiation walks the sender's commit graph back from the accepted heads and stops at the first commit the
+// receiver already has: objects are only ever transferred with their whole history, so the receiver then has
+// everything behind it too. The missing blobs and commits go into one pack, ordered so that each commit arrives
+// after its blobs and parents, and the refs and branch logs are updated last. An interrupted transfer therefore
+// never leaves the receiver with a commit whose history is incomplete.
+{
+    TraceSpan span("transfer_branches");
+
+    ObjectStore from_store(from_root / MINIGIT_OBJECTS_PATH);
+    ObjectStore to_store(to_root / MINIGIT_OBJECTS_PATH);
+
+    std::vector<ObjectId> heads;
+    for(auto const& branch : branches)
+    {
+        RefUpdate update;
+        update.branch = branch;
+        update.old_commit_id = read_ref(to_root / MINIGIT_BRANCHES_PATH / branch);
+        update.new_commit_id = read_ref(from_root / MINIGIT_BRANCHES_PATH / branch);
+
+        if(update.new_commit_id == update.old_commit_id)
+        {
+            update.status = RefUpdateStatus::UpToDate;
+        }
+        else if(!update.old_commit_id.is_null() && !is_ancestor(from_store, update.old_commit_id, update.new_commit_id))
+        {
+            update.status = RefUpdateStatus::NotFastForward;
+        }
+        else if(std::find(checked_out.begin(), checked_out.end(), branch) != checked_out.end())
+        {
+            update.status = RefUpdateStatus::CheckedOut;
+        }
+        else
+        {
+            update.status = update.old_commit_id.is_null() ? RefUpdateStatus::Created : RefUpdateStatus::FastForward;
+            heads.push_back(update.new_commit_id);
+        }
+        result.updates.push_back(update);
+    }
+
+    // Negotiate: collect the commits and blobs the receiver is missing
+    std::vector<PackObject> blobs;
+    std::vector<PackObject> commits; // descendants before ancestors
+    std::unordered_set<ObjectId> seen_commits;
+    std::unordered_set<ObjectId> seen_blobs;
+    std::unordered_set<ObjectId> seen_chunks;
+    std::stack<ObjectId> pending;
+    for(auto const& head : heads)
+    {
+        pending.push(head);
+    }
 
-    for (size_t i = 0; i < max_lines; i++) 
+    while(!pending.empty())
     {
-        std::string base_file_line = (i < base_file_lines.size() ? base_file_lines[i] : "");
-        std::string branch_1_file_line = (i < branch_1_file_lines.size() ? branch_1_file_lines[i] : "");
-        std::string branch_2_file_line = (i < branch_2_file_lines.size() ? branch_2_file_lines[i] : "");
+        ObjectId commit_id = pending.top();
+        pending.pop();
+
+        if(commit_id.is_null() || !seen_commits.insert(commit_id).second || to_store.contains(ObjectType::Commit, commit_id))
+        {
+            continue;
+        }
 
-        if (branch_1_file_line == branch_2_file_line) {
-            out += branch_1_file_line + "\n";
+        CommitInfo commit_info;
+        if(!load_commit_info(from_store, commit_id, commit_info))
+        {
             continue;
         }
+        commits.push_back({ObjectType::Commit, commit_id, from_store.find(ObjectType::Commit, commit_id)});
+        for(auto const& entry : commit_info.file_hashes)
+        {
+            if(seen_blobs.insert(entry.id).second && !to_store.contains_blob(entry.id))
+            {
+                // The chunks of a chunked blob go first, and only those the receiver does not share already
+                bool chunked = false;
+                std::filesystem::path blob_path = from_store.find_blob(entry.id, chunked);
+                std::vector<ChunkRef> chunks;
+                if(chunked)
+                {
+                    read_chunk_list(blob_path, hasher.id_size(), chunks);
+                }
+                for(auto const& chunk : chunks)
+                {
+                    if(seen_chunks.insert(chunk.id).second && !to_store.contains(ObjectType::Chunk, chunk.id))
+                    {
+                        blobs.push_back({ObjectType::Chunk, chunk.id, from_store.find(ObjectType::Chunk, chunk.id)});
+                    }
+                }
+                blobs.push_back({chunked ? ObjectType::ChunkList : ObjectType::Blob, entry.id, blob_path});
+            }
+        }
+        pending.push(commit_info.parent_1_id);
+        pending.push(commit_info.parent_2_id);
+    }
+
+    result.commits = commits.size();
+    result.blobs = std::count_if(blobs.begin(), blobs.end(), [](const PackObject& object)
+    {
+        return object.type != ObjectType::Chunk;
+    });
+
+    if(!commits.empty() || !blobs.empty())
+    {
+        std::vector<PackObject> objects = std::move(blobs);
+        objects.insert(objects.end(), commits.rbegin(), commits.rend());
+
+        std::filesystem::path pack_path = to_root / MINIGIT_OBJECTS_PATH / "incoming.pack";
+        result.pack_size = write_pack(pack_path, objects, hasher.id_size());
+
+        std::vector<ObjectId> new_commits;
+        bool unpacked = read_pack(pack_path, to_store, new_commits);
+        std::filesystem::remove(pack_path);
+        if(!unpacked)
+        {
+            result.error = {ErrorCode::FilesystemError, "the transferred pack is damaged."};
+            return;
+        }
+
+        ObjectIndex(to_root / MINIGIT_COMMITS_PATH, to_root / MINIGIT_COMMITS_INDEX_PATH, hasher.id_size()).insert(new_commits);
+    }
+
+    // The branch log is the history log, merge and revert work from, so it travels with the ref
+    for(auto const& update : result.updates)
+    {
+        if(update.status == RefUpdateStatus::Created || update.status == RefUpdateStatus::FastForward)
+        {
+            write_ref(to_root / MINIGIT_BRANCHES_PATH / update.branch, update.new_commit_id);
+            std::filesystem::copy_file(from_root / MINIGIT_BRANCHES_LOG_PATH / update.branch,
+                to_root / MINIGIT_BRANCHES_LOG_PATH / update.branch, std::filesystem::copy_options::overwrite_existing);
+            branch_commit_index(to_root, update.branch).rebuild();
+        }
+    }
+}
+
+void RepositoryImpl::update_working_tree(const PathMap& old_files, const PathMap& new_files) const
+// Moves the index and the working tree from one commit's files to another's, touching only the files that differ.
+// The working tree must not have staged or modified files.
+{
+    TraceSpan span("update_working_tree");
+
+    write_tracked_files(new_files);
+
+    SparseCheckout sparse_checkout;
+    sparse_checkout.load(MINIGIT_SPARSE_CHECKOUT_PATH);
+    Materializer materializer;
+    merge_join(old_files, new_files, [&](PathId path, const ObjectId* old_id, const ObjectId* new_id)
+    {
+        const std::string& filename = PathTable::instance().path(path);
+        if(new_id == nullptr)
+        {
+            std::filesystem::remove(filename);
+        }
+        else if((old_id == nullptr || *old_id != *new_id) && sparse_checkout.includes(filename))
+        {
+            add_blob(materializer, *new_id, filename);
+        }
+    });
+    materializer.run();
+}
+
+std::filesystem::path RepositoryImpl::find_common_root()
+// Returns the main working tree of the repository if the current directory is a linked working tree
+// (its .minigit/commondir names it), otherwise an empty path: shared files are then relative to the current directory.
+{
+    std::ifstream commondir(MINIGIT_COMMONDIR_PATH);
+    std::string common_root_path;
+    std::getline(commondir, common_root_path);
+    return common_root_path;
+}
+
+std::filesystem::path RepositoryImpl::main_root() const
+// Absolute path of the main working tree.
+{
+    return common_root.empty() ? std::filesystem::current_path() : common_root;
+}
+
+std::vector<std::filesystem::path> RepositoryImpl::read_worktree_registry(const std::filesystem::path& root) const
+// Returns the paths of the linked working trees registered in the repository whose main working tree is root,
+// including those whose directory no longer exists.
+{
+    std::vector<std::filesystem::path> worktree_paths;
+    std::filesystem::path worktrees_path = root / MINIGIT_WORKTREES_PATH;
+    if(std::filesystem::exists(worktrees_path))
+    {
+        for(auto const& dir_entry : std::filesystem::directory_iterator {worktrees_path})
+        {
+            std::string worktree_path;
+            std::ifstream registration(dir_entry.path());
+            std::getline(registration, worktree_path);
+            worktree_paths.push_back(worktree_path);
+        }
+    }
+    return worktree_paths;
+}
+
+std::vector<std::filesystem::path> RepositoryImpl::list_worktree_roots(const std::filesystem::path& root) const
+// Returns the working trees of the repository whose main working tree is root: root first,
+// then the linked working trees that still exist.
+{
+    std::vector<std::filesystem::path> roots {root};
+    for(auto const& worktree_path : read_worktree_registry(root))
+    {
+        if(std::filesystem::exists(worktree_path / MINIGIT_COMMONDIR_PATH))
+        {
+            roots.push_back(worktree_path);
+        }
+    }
+    return roots;
+}
+
+std::vector<std::string> RepositoryImpl::checked_out_branches(const std::filesystem::path& root) const
+// Returns the branches checked out in the working trees of the repository whose main working tree is root.
+{
+    std::vector<std::string> branches;
+    for(auto const& worktree_root : list_worktree_roots(root))
+    {
+        branches.push_back(get_current_branch(worktree_root));
+    }
+    return branches;
+}
 
-        // Only branch 1 file has changed
-        if(branch_1_file_line != base_file_line && branch_2_file_line == base_file_line)
+bool RepositoryImpl::is_checked_out(const std::string& branch) const
+// Returns true if the branch is checked out in any working tree of this repository.
+{
+    std::vector<std::string> branches = checked_out_branches(common_root);
+    return std::find(branches.begin(), branches.end(), branch) != branches.end();
+}
+
+void RepositoryImpl::list_changed_paths(const PathMap& files, const PathMap& parent_files, 
+    std::vector<std::string_view>& paths) const
+// Appends the paths that were added, modified or removed compared with the parent.
+{
+    merge_join(files, parent_files, [&paths](PathId path, const ObjectId* id, const ObjectId* parent_id)
+    {
+        if(id == nullptr || parent_id == nullptr || *id != *parent_id)
         {
-            // Take branch 1 version into final result
-            out += branch_1_file_line + "\n";
-            continue;            
+            paths.push_back(PathTable::instance().path(path));
         }
+    });
+}
+
+bool RepositoryImpl::commit_changed_path(ChangedPathIndex& changed_path_index, const ObjectId& commit_id, 
+    const std::string& path) const
+// Returns true if the commit changed path compared with its first parent. The commit's Bloom filter rules out
+// most commits without loading them; the rest are checked exactly, and commits without a filter get one.
+{
+    PathFilterMatch match = changed_path_index.lookup(commit_id, path);
+    if(match == PathFilterMatch::No)
+    {
+        return false;
+    }
+
+    CommitInfo commit_info;
+    CommitInfo parent_info;
+    if(!load_commit_info(commit_id, commit_info))
+    {
+        return false;
+    }
+    if(!commit_info.parent_1_id.is_null())
+    {
+        load_commit_info(commit_info.parent_1_id, parent_info);
+    }
+
+    if(match == PathFilterMatch::Unknown)
+    {
+        std::vector<std::string_view> changed_paths;
+        list_changed_paths(commit_info.file_hashes, parent_info.file_hashes, changed_paths);
+        changed_path_index.add(commit_id, changed_paths);
+    }
+
+    const ObjectId* id = commit_info.file_hashes.find(path);
+    const ObjectId* parent_id = parent_info.file_hashes.find(path);
+    return (id == nullptr) != (parent_id == nullptr) || (id != nullptr && *id != *parent_id);
+}
 
-        //Only branch 2 file has changed
-        if(branch_1_file_line == base_file_line && branch_2_file_line != base_file_line)
+void RepositoryImpl::compute_changes(const CommitInfo& commit_info, const CommitInfo& parent_info, 
+    std::vector<FileChange>& changes) const
+// Diffs the files that differ between the commit and its parent, counting added and removed lines.
+{
+    TraceSpan span("compute_changes");
+
+    std::vector<std::string_view> changed_paths;
+    list_changed_paths(commit_info.file_hashes, parent_info.file_hashes, changed_paths);
+
+    changes.clear();
+    changes.reserve(changed_paths.size());
+    for(auto const& path : changed_paths)
+    {
+        FileLines old_file;
+        FileLines new_file;
+        if(const ObjectId* parent_id = parent_info.file_hashes.find(path))
         {
-            // Take branch 2 version into final result
-            out += branch_2_file_line + "\n";
-            continue;            
+            read_blob_lines(*parent_id, old_file);
         }
+        if(const ObjectId* id = commit_info.file_hashes.find(path))
+        {
+            read_blob_lines(*id, new_file);
+        }
+
+        FileChange change;
+        change.path = path;
+        count_line_changes(old_file, new_file, change.added, change.removed);
+        changes.push_back(change);
+    }
+}
+
+void RepositoryImpl::get_commit_changes(const CommitInfo& commit_info, std::vector<FileChange>& changes) const
+// Returns the change list recorded in the commit, or computes it for commits that have none.
+{
+    if(commit_info.changes_recorded)
+    {
+        changes = commit_info.changes;
+        return;
+    }
+
+    CommitInfo parent_info;
+    if(!commit_info.parent_1_id.is_null())
+    {
+        load_commit_info(commit_info.parent_1_id, parent_info);
+    }
+    compute_changes(commit_info, parent_info, changes);
+}
+
+void RepositoryImpl::blame_lines(CommitInfo commit_info, const std::string& filename, std::vector<ObjectId>& origins) const
+// Sets origins to the commit each line of the file, as of commit_info, originates from.
+// History is followed through first parents. Every version of the file is diffed against the one before it,
+// and the line origins of each version are cached, so only versions newer than the last cached one are diffed.
+// Lines that came in with a merge are attributed to the merge commit.
+{
+    TraceSpan span("blame_lines");
 
-        conflict = true;
+    BlameCache blame_cache(common_root / MINIGIT_BLAME_CACHE_PATH);
 
-        out += "<<<<<<< HEAD\n";
-        if (!branch_1_file_line.empty()) out += branch_1_file_line + "\n";
-        out += "=======\n";
-        if (!branch_2_file_line.empty()) out += branch_2_file_line + "\n";
-        out += ">>>>>>> MERGE\n";
+    // Versions of the file, newest first, each with the commit that introduced it, back to the first cached one
+    std::vector<std::pair<ObjectId, ObjectId>> versions;
+    bool cached = false;
+    ObjectId blob_id = *commit_info.file_hashes.find(filename);
+    while(!cached)
+    {
+        CommitInfo parent_info;
+        bool has_parent = !commit_info.parent_1_id.is_null() && load_commit_info(commit_info.parent_1_id, parent_info);
+        const ObjectId* parent_blob_id = has_parent ? parent_info.file_hashes.find(filename) : nullptr;
+        if(parent_blob_id == nullptr || *parent_blob_id != blob_id)
+        {
+            versions.push_back({blob_id, commit_info.id});
+            cached = blame_cache.load(blob_id, commit_info.id, origins);
+            if(parent_blob_id == nullptr)
+            {
+                break;
+            }
+            blob_id = *parent_blob_id;
+        }
+        commit_info = std::move(parent_info);
     }
 
-    std::ofstream result_file(filename);
-    result_file << out;
-    result_file.close();
+    // Replay the versions oldest first. Lines kept from the previous version keep their origin,
+    // the others originate from the commit that introduced the version.
+    // The two files alternate between the slots, since moving a FileLines could invalidate its line views.
+    FileLines files[2];
+    std::size_t current = 0;
+    std::size_t remaining = versions.size();
+    if(cached)
+    {
+        remaining--;
+        read_blob_lines(versions[remaining].first, files[current]);
+    }
+    while(remaining > 0)
+    {
+        remaining--;
+        const auto& [version_blob_id, version_commit_id] = versions[remaining];
+        const FileLines& previous_file = files[current];
+        current = 1 - current;
+        FileLines& file = files[current];
+        file = FileLines();
+        read_blob_lines(version_blob_id, file);
+
+        std::vector<ObjectId> version_origins(file.lines.size(), version_commit_id);
+        if(remaining + 1 < versions.size())
+        {
+            std::vector<long> old_line_of;
+            match_lines(previous_file, file, old_line_of);
+            for(std::size_t i = 0; i < old_line_of.size(); i++)
+            {
+                if(old_line_of[i] >= 0 && static_cast<std::size_t>(old_line_of[i]) < origins.size())
+                {
+                    version_origins[i] = origins[old_line_of[i]];
+                }
+            }
+        }
+        blame_cache.store(version_blob_id, version_commit_id, version_origins);
+        origins = std::move(version_origins);
+    }
 
-    return conflict;    
-}
\ No newline at end of file
+    span.add_counter("versions_diffed", versions.size() - (cached ? 1 : 0));
+}
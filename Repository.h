@@ -1,45 +1,59 @@
 #ifndef _REPOSITORY_H_
 #define _REPOSITORY_H_
 
+#include <cstddef>
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
-#include <unordered_map>
-#include "Commit.h"
+
+#include "ObjectId.h"
+#include "Results.h"
+
+class RepositoryImpl;
 
 class Repository
+// The MiniGit library interface: one Repository per working tree, found from the current directory.
+// The implementation lives in RepositoryImpl (RepositoryImpl.h), which only the library includes.
 {
     public:
-        void init();
-        void status();
-        void add(const std::vector<std::string>& filenames);
-        void commit(const std::string& message);
-        void revert(const std::string& commit_id);
-        void print_log() const;
-        void checkout(const std::string& branch);
-        void create_branch(const std::string& branch);
-        void print_branches();
-        void merge(const std::string& branch);
+        Repository();
+        ~Repository();
 
-    private:
+        Repository(const Repository&) = delete;
+        Repository& operator=(const Repository&) = delete;
 
-        bool initialized() const;
-        void load_working_directory_files(std::vector<std::string>& working_directory_files) const;
-        bool load_commit_info(std::string id, CommitInfo& head) const;
-        void write_commit_info(const CommitInfo& head) const;
-        bool load_tracked_files(std::unordered_map<std::string, std::string>& tracked_files) const;
-        void write_tracked_files(std::unordered_map<std::string, std::string>& tracked_files) const;
-        std::string sha1(const std::string &input) const;
-        std::string get_current_branch() const;
-        std::string get_file_hash(std::string filename) const;
-        void get_previous_commit_info(CommitInfo& commit_info) const;
-        void get_working_directory_files_statuses(std::vector<std::string>& staged, 
-            std::vector<std::string>& modified, 
-            std::vector<std::string>& untracked) const;
-        bool is_revert_commit_id_valid(std::string commit_id) const;
-        void perform_merge(const std::string& base_commit_id, const std::string& branch_1_commit_id, const std::string& branch_2_commit_id, bool& merge_commited, bool& conflict) const;
-        bool perform_2_way_merge(const std::string& filename, const std::string& branch_1_file_hash, const std::string& branch_2_file_hash) const; 
-        bool perform_3_way_merge(const std::string& filename, const std::string& base_file_hash, const std::string& branch_1_file_hash, const std::string& branch_2_file_hash) const; 
+        InitResult init(HashAlgorithm algorithm = HashAlgorithm::Sha1);
+        StatusResult status() const;
+        StatusResult status(const StatusVisitor& visit, 
+            const std::function<void(const StatusResult&)>& begin = nullptr) const;
+        AddResult add(const std::vector<std::string>& filenames);
+        CommitResult commit(const std::string& message);
+        RevertResult revert(const std::string& commit_id);
+        LogResult log(std::size_t abbrev_min_length = 0, const std::string& path = {}, bool stat = false) const;
+        ShowResult show(const std::string& commit_id) const;
+        BlameResult blame(const std::string& filename) const;
+        GrepResult grep(const std::string& pattern, const std::string& commit_id = {}) const;
+        CheckoutResult checkout(const std::string& branch);
+        BranchResult create_branch(const std::string& branch);
+        BranchListResult list_branches() const;
+        MergeResult merge(const std::string& branch);
+        CountObjectsResult count_objects() const;
+        GcResult gc(long long prune_grace_seconds);
+        FsckResult fsck(const ProgressCallback& progress = nullptr) const;
+        SparseCheckoutResult sparse_checkout_list() const;
+        SparseCheckoutResult sparse_checkout_set(const std::vector<std::string>& patterns);
+        AlternatesResult list_alternates() const;
+        AlternatesResult add_alternate(const std::string& objects_path);
+        TransferResult clone(const std::string& source);
+        TransferResult fetch(const std::string& remote);
+        TransferResult push(const std::string& remote, const std::string& branch);
+        WorktreeResult add_worktree(const std::string& path, const std::string& branch);
+        WorktreeResult list_worktrees() const;
+        WorktreeResult prune_worktrees();
 
+    private:
+        std::unique_ptr<RepositoryImpl> impl;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,131 @@
+#ifndef _REPOSITORY_IMPL_H_
+#define _REPOSITORY_IMPL_H_
+
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include "ChangedPaths.h"
+#include "Commit.h"
+#include "Hash.h"
+#include "Materializer.h"
+#include "Merge.h"
+#include "MiniGit.h"
+#include "ObjectId.h"
+#include "ObjectIndex.h"
+#include "ObjectStore.h"
+#include "PathMap.h"
+#include "Results.h"
+#include "SparseCheckout.h"
+
+class RepositoryImpl
+// The implementation behind Repository, kept out of the public header so its users do not depend on the
+// internal modules. Repository forwards every call to it.
+{
+    public:
+        RepositoryImpl();
+
+        InitResult init(HashAlgorithm algorithm = HashAlgorithm::Sha1);
+        StatusResult status() const;
+        StatusResult status(const StatusVisitor& visit, 
+            const std::function<void(const StatusResult&)>& begin = nullptr) const;
+        AddResult add(const std::vector<std::string>& filenames);
+        CommitResult commit(const std::string& message);
+        RevertResult revert(const std::string& commit_id);
+        LogResult log(std::size_t abbrev_min_length = 0, const std::string& path = {}, bool stat = false) const;
+        ShowResult show(const std::string& commit_id) const;
+        BlameResult blame(const std::string& filename) const;
+        GrepResult grep(const std::string& pattern, const std::string& commit_id = {}) const;
+        CheckoutResult checkout(const std::string& branch);
+        BranchResult create_branch(const std::string& branch);
+        BranchListResult list_branches() const;
+        MergeResult merge(const std::string& branch);
+        CountObjectsResult count_objects() const;
+        GcResult gc(long long prune_grace_seconds);
+        FsckResult fsck(const ProgressCallback& progress = nullptr) const;
+        SparseCheckoutResult sparse_checkout_list() const;
+        SparseCheckoutResult sparse_checkout_set(const std::vector<std::string>& patterns);
+        AlternatesResult list_alternates() const;
+        AlternatesResult add_alternate(const std::string& objects_path);
+        TransferResult clone(const std::string& source);
+        TransferResult fetch(const std::string& remote);
+        TransferResult push(const std::string& remote, const std::string& branch);
+        WorktreeResult add_worktree(const std::string& path, const std::string& branch);
+        WorktreeResult list_worktrees() const;
+        WorktreeResult prune_worktrees();
+
+    private:
+
+        bool initialized() const;
+        Error not_initialized_error() const;
+        std::string author_name() const;
+        void load_working_directory_files(std::vector<std::string>& working_directory_files) const;
+        bool load_commit_info(const ObjectId& id, CommitInfo& head) const;
+        bool load_commit_info(const ObjectStore& store, const ObjectId& id, CommitInfo& head) const;
+        void write_commit_info(CommitInfo& head) const;
+        bool load_tracked_files(PathMap& tracked_files, const std::filesystem::path& index_path = MINIGIT_INDEX_PATH) const;
+        void write_tracked_files(const PathMap& tracked_files, const std::filesystem::path& index_path = MINIGIT_INDEX_PATH) const;
+        ObjectId hash(const std::string& input) const;
+        static HashAlgorithm read_hash_algorithm(const std::filesystem::path& root);
+        std::string get_current_branch(const std::filesystem::path& root = {}) const;
+        ObjectId get_file_hash(std::string filename) const;
+        std::string file_hash_input(const std::string& filename) const;
+        std::string file_hash_input(const std::string& filename, std::filesystem::file_time_type timestamp,
+            std::uintmax_t size) const;
+        ObjectId read_ref(const std::filesystem::path& ref_path) const;
+        void write_ref(const std::filesystem::path& ref_path, const ObjectId& id) const;
+        ObjectId object_id_from_path(const std::filesystem::path& object_path) const;
+        void copy_file_with_timestamp(const std::filesystem::path& source, const std::filesystem::path& destination) const;
+        void store_blob(const std::filesystem::path& source, const ObjectId& id) const;
+        void add_blob(Materializer& materializer, const ObjectId& id, const std::filesystem::path& destination) const;
+        bool read_blob_lines(const ObjectId& id, FileLines& file) const;
+        void get_previous_commit_info(CommitInfo& commit_info) const;
+        void walk_statuses(const StatusVisitor& visit) const;
+        void get_working_directory_files_statuses(std::vector<std::string>& staged, 
+            std::vector<std::string>& modified, 
+            std::vector<std::string>& untracked) const;
+        bool is_revert_commit_id_valid(const ObjectId& commit_id) const;
+        Error resolve_commit_id(const std::string& hex_prefix, ObjectId& commit_id) const;
+        void perform_merge(const ObjectId& base_commit_id, const ObjectId& branch_1_commit_id, const ObjectId& branch_2_commit_id, 
+            bool& merge_commited, bool& conflict, std::vector<std::string>& merge_failed_files) const;
+        bool perform_file_merge(const std::string& filename, const ObjectId* base_file_hash, 
+            const ObjectId& branch_1_file_hash, const ObjectId& branch_2_file_hash) const; 
+        void collect_reachable_objects(std::unordered_set<ObjectId>& reachable_commits,
+            std::unordered_set<ObjectId>& reachable_blobs) const;
+        void check_refs(const std::function<void(const std::string& problem)>& report) const;
+        bool is_object_older_than(const std::filesystem::path& object_path, long long seconds) const;
+        std::vector<ObjectIndex> commit_indexes() const;
+        ObjectIndex branch_commit_index(const std::filesystem::path& root, const std::string& branch) const;
+        void write_branch_log_entry(const std::string& branch, const LogEntry& log_entry) const;
+        void list_changed_paths(const PathMap& files, const PathMap& parent_files, 
+            std::vector<std::string_view>& paths) const;
+        bool commit_changed_path(ChangedPathIndex& changed_path_index, const ObjectId& commit_id, 
+            const std::string& path) const;
+        void compute_changes(const CommitInfo& commit_info, const CommitInfo& parent_info, 
+            std::vector<FileChange>& changes) const;
+        void get_commit_changes(const CommitInfo& commit_info, std::vector<FileChange>& changes) const;
+        void blame_lines(CommitInfo commit_info, const std::string& filename, std::vector<ObjectId>& origins) const;
+        bool find_repository_root(const std::string& path, std::filesystem::path& root) const;
+        std::vector<std::string> list_branch_names(const std::filesystem::path& root) const;
+        bool is_ancestor(const ObjectStore& store, const ObjectId& ancestor, const ObjectId& descendant) const;
+        void transfer_branches(const std::filesystem::path& from_root, const std::filesystem::path& to_root,
+            const std::vector<std::string>& branches, const std::vector<std::string>& checked_out, TransferResult& result) const;
+        void update_working_tree(const PathMap& old_files, const PathMap& new_files) const;
+        static std::filesystem::path find_common_root();
+        std::filesystem::path main_root() const;
+        std::vector<std::filesystem::path> read_worktree_registry(const std::filesystem::path& root) const;
+        std::vector<std::filesystem::path> list_worktree_roots(const std::filesystem::path& root) const;
+        std::vector<std::string> checked_out_branches(const std::filesystem::path& root) const;
+        bool is_checked_out(const std::string& branch) const;
+
+        // Directory holding the shared objects, refs and branch logs: empty in the main working tree,
+        // the main working tree's directory in a linked one (HEAD, index and merge state are always local)
+        std::filesystem::path common_root;
+        ObjectStore object_store;
+        ObjectHasher hasher;
+
+};
+
+#endif
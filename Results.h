@@ -0,0 +1,287 @@
+#ifndef _RESULTS_H_
+#define _RESULTS_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Commit.h"
+#include "Log.h"
+#include "ObjectId.h"
+
+// Structured results returned by the Repository API. Nothing in the library prints;
+// the command-line front end (main.cpp) turns these into text.
+
+enum class ErrorCode
+{
+    None,
+    NotInitialized,
+    AlreadyInitialized,
+    FilesystemError,
+    NothingToCommit,
+    UncommittedChanges,
+    InvalidCommitId,
+    AmbiguousCommitId,
+    InvalidObjectDirectory,
+    RepositoryNotFound,
+    BranchCheckedOut,
+    WorktreeExists,
+    BranchNotFound,
+    NoCommitsOnBranch,
+    AncestorNotFound,
+    PathNotFound,
+    InvalidPattern,
+    ObjectFormatMismatch
+};
+
+typedef struct Error
+{
+    ErrorCode code = ErrorCode::None;
+    std::string message;
+
+    explicit operator bool() const { return code != ErrorCode::None; }
+} Error;
+
+typedef struct WorkingTreeChanges
+{
+    std::vector<std::string> staged;
+    std::vector<std::string> modified;
+} WorkingTreeChanges;
+
+enum class FileState : char
+{
+    Unchanged = ' ',
+    Modified = 'M',
+    Deleted = 'D',
+    Untracked = '?'
+};
+
+typedef struct StatusEntry
+{
+    std::string_view path;
+    FileState staged = FileState::Unchanged;   // index compared with HEAD
+    FileState unstaged = FileState::Unchanged; // working directory compared with the index
+} StatusEntry;
+
+typedef std::function<void(const StatusEntry& entry)> StatusVisitor;
+
+typedef std::function<void(std::size_t done, std::size_t total)> ProgressCallback;
+
+typedef struct InitResult
+{
+    Error error;
+    std::vector<std::filesystem::path> created_directories;
+} InitResult;
+
+typedef struct StatusResult
+{
+    Error error;
+    std::string branch;
+    bool merging = false;
+    std::vector<std::string> staged;
+    std::vector<std::string> modified;
+    std::vector<std::string> deleted; // tracked files missing from the working directory
+    std::vector<std::string> untracked;
+} StatusResult;
+
+typedef struct AddResult
+{
+    Error error;
+    std::vector<std::string> added;
+    std::vector<std::string> not_found;
+} AddResult;
+
+typedef struct CommitResult
+{
+    Error error;
+    ObjectId commit_id;
+    std::vector<std::string> changed_files; // files that differ from the parent commit
+} CommitResult;
+
+typedef struct RevertResult
+{
+    Error error;
+    WorkingTreeChanges blocking_changes; // set when error.code is UncommittedChanges
+    ObjectId commit_id;
+} RevertResult;
+
+typedef struct LogResult
+{
+    Error error;
+    std::vector<LogEntry> entries; // newest entry first
+    std::size_t abbrev_length = ObjectId::MAX_HEX_SIZE; // shortest length that keeps every listed commit id unique
+    std::vector<std::vector<FileChange>> changes; // with stat: the files each entry changed, parallel to entries
+} LogResult;
+
+typedef struct ShowResult
+{
+    Error error;
+    CommitInfo commit;
+    std::vector<FileChange> changes; // files that differ from parent 1
+} ShowResult;
+
+typedef struct BlameLine
+{
+    ObjectId commit_id; // commit that last changed the line
+    std::string author;
+    std::string timestamp;
+    std::string text;
+} BlameLine;
+
+typedef struct BlameResult
+{
+    Error error;
+    std::vector<BlameLine> lines;
+} BlameResult;
+
+typedef struct GrepMatch
+{
+    std::string path;
+    std::size_t line_number = 0; // 1-based
+    std::string line;
+} GrepMatch;
+
+typedef struct GrepResult
+{
+    Error error;
+    std::vector<GrepMatch> matches; // in path order, then line order
+} GrepResult;
+
+typedef struct BranchResult
+{
+    Error error;
+    std::string branch;
+    ObjectId commit_id;
+} BranchResult;
+
+typedef struct BranchListResult
+{
+    Error error;
+    std::vector<std::string> branches; // sorted by name
+} BranchListResult;
+
+typedef struct CheckoutResult
+{
+    Error error;
+    WorkingTreeChanges blocking_changes; // set when error.code is UncommittedChanges
+    ObjectId commit_id;
+} CheckoutResult;
+
+enum class MergeOutcome
+{
+    None,
+    UpToDate,
+    FastForward,
+    Merged,
+    Conflict
+};
+
+typedef struct MergeResult
+{
+    Error error;
+    WorkingTreeChanges blocking_changes; // set when error.code is UncommittedChanges
+    MergeOutcome outcome = MergeOutcome::None;
+    std::string branch;
+    std::string current_branch;
+    ObjectId old_commit_id;
+    ObjectId new_commit_id; // branch head after the merge, null on conflict
+    ObjectId other_commit_id;
+    std::vector<std::string> conflicted_files;
+} MergeResult;
+
+typedef struct SparseCheckoutResult
+{
+    Error error;
+    std::vector<std::string> patterns;         // patterns in effect, empty when sparse checkout is disabled
+    std::size_t written = 0;                   // files written to the working tree because they are now included
+    std::size_t removed = 0;                   // unmodified files removed because they are now excluded
+    std::vector<std::string> kept_modified;    // excluded files left in place because they have local changes
+} SparseCheckoutResult;
+
+typedef struct AlternatesResult
+{
+    Error error;
+    std::vector<std::filesystem::path> alternates; // shared object directories, in lookup order
+} AlternatesResult;
+
+enum class RefUpdateStatus
+{
+    UpToDate,
+    Created,
+    FastForward,
+    NotFastForward, // rejected: the receiving branch has commits the sender does not
+    CheckedOut      // rejected: the branch is checked out in the receiving repository
+};
+
+typedef struct RefUpdate
+{
+    std::string branch;
+    RefUpdateStatus status = RefUpdateStatus::UpToDate;
+    ObjectId old_commit_id;
+    ObjectId new_commit_id;
+} RefUpdate;
+
+typedef struct TransferResult
+{
+    Error error;
+    std::string branch;               // clone: the branch checked out
+    std::vector<RefUpdate> updates;   // sorted by branch name
+    std::size_t commits = 0;          // objects the receiver was missing
+    std::size_t blobs = 0;
+    std::uintmax_t pack_size = 0;
+} TransferResult;
+
+typedef struct WorktreeEntry
+{
+    std::filesystem::path path;
+    std::string branch;
+    bool prunable = false; // the working tree directory no longer exists
+} WorktreeEntry;
+
+typedef struct WorktreeResult
+{
+    Error error;
+    std::vector<WorktreeEntry> worktrees; // the main working tree first
+    std::size_t pruned = 0;
+} WorktreeResult;
+
+typedef struct CountObjectsResult
+{
+    Error error;
+    std::size_t blob_count = 0;
+    std::uintmax_t blobs_size = 0;
+    std::uintmax_t largest_blob_size = 0;
+    std::size_t unreachable_blobs = 0;
+    std::size_t chunk_count = 0;
+    std::uintmax_t chunks_size = 0;
+    std::size_t commit_count = 0;
+    std::uintmax_t commits_size = 0;
+    std::size_t unreachable_commits = 0;
+    std::size_t log_file_count = 0;
+    std::uintmax_t logs_size = 0;
+    std::size_t index_entries = 0;
+} CountObjectsResult;
+
+typedef struct GcResult
+{
+    Error error;
+    std::size_t removed_blobs = 0;
+    std::size_t removed_commits = 0;
+    std::size_t removed_chunks = 0;
+    std::uintmax_t removed_size = 0;
+} GcResult;
+
+typedef struct FsckResult
+{
+    Error error;
+    std::size_t commits_checked = 0;
+    std::size_t blobs_checked = 0;
+    std::size_t chunks_checked = 0;
+    std::uintmax_t bytes_hashed = 0;
+    std::vector<std::string> problems; // "<object kind> <id or path>: <description>", sorted
+} FsckResult;
+
+#endif
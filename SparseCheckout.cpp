@@ -0,0 +1,74 @@
+#include <fnmatch.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "SparseCheckout.h"
+
+void SparseCheckout::load(const std::filesystem::path& patterns_path)
+// Reads the patterns file. A missing file means sparse checkout is disabled.
+{
+    std::vector<std::string> lines;
+    std::ifstream patterns_file(patterns_path);
+    std::string line;
+    while(std::getline(patterns_file, line))
+    {
+        lines.push_back(line);
+    }
+    set_patterns(lines);
+}
+
+void SparseCheckout::save(const std::filesystem::path& patterns_path) const
+// Writes the patterns, or removes the file when there are none.
+{
+    if(patterns.empty())
+    {
+        std::error_code error;
+        std::filesystem::remove(patterns_path, error);
+        return;
+    }
+
+    std::filesystem::create_directories(patterns_path.parent_path());
+    std::ofstream patterns_file(patterns_path);
+    for(auto const& pattern : patterns)
+    {
+        patterns_file << pattern << '\n';
+    }
+}
+
+void SparseCheckout::set_patterns(const std::vector<std::string>& new_patterns)
+// Keeps the non-empty, non-comment patterns.
+{
+    patterns.clear();
+    for(auto pattern : new_patterns)
+    {
+        while(!pattern.empty() && (pattern.back() == '\r' || pattern.back() == ' '))
+        {
+            pattern.pop_back();
+        }
+        if(!pattern.empty() && pattern[0] != '#')
+        {
+            patterns.push_back(pattern);
+        }
+    }
+}
+
+bool SparseCheckout::includes(const std::string& path) const
+{
+    if(patterns.empty())
+    {
+        return true;
+    }
+
+    bool included = false;
+    for(auto const& pattern : patterns)
+    {
+        bool negated = pattern[0] == '!';
+        const char* glob = pattern.c_str() + (negated ? 1 : 0);
+        if(fnmatch(glob, path.c_str(), FNM_PERIOD) == 0)
+        {
+            included = !negated;
+        }
+    }
+    return included;
+}
@@ -0,0 +1,28 @@
+#ifndef _SPARSE_CHECKOUT_H_
+#define _SPARSE_CHECKOUT_H_
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+class SparseCheckout
+// Sparse checkout patterns, stored one per line in .minigit/info/sparse-checkout.
+// Patterns are shell globs (fnmatch syntax), '#' starts a comment and a leading '!' excludes what an earlier
+// pattern included; the last matching pattern decides. Without patterns every path is included.
+// Excluded paths stay in the index and in commits, they are just not written to (or stat'ed in) the working tree.
+{
+    public:
+        void load(const std::filesystem::path& patterns_path);
+        void save(const std::filesystem::path& patterns_path) const;
+
+        bool enabled() const { return !patterns.empty(); }
+        bool includes(const std::string& path) const;
+
+        const std::vector<std::string>& get_patterns() const { return patterns; }
+        void set_patterns(const std::vector<std::string>& new_patterns);
+
+    private:
+        std::vector<std::string> patterns;
+};
+
+#endif
@@ -0,0 +1,129 @@
+#include <algorithm>
+
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned thread_count)
+{
+    if(thread_count == 0)
+    {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for(unsigned i = 0; i < thread_count; i++)
+    {
+        workers.emplace_back(&ThreadPool::worker_loop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(tasks_mutex);
+        stopping = true;
+    }
+    task_available.notify_all();
+
+    for(auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task)
+// Queues a task for execution by one of the workers.
+{
+    {
+        std::lock_guard<std::mutex> lock(tasks_mutex);
+        tasks.push(std::move(task));
+        pending++;
+    }
+    task_available.notify_one();
+}
+
+void ThreadPool::wait()
+// Blocks until all submitted tasks have completed. Rethrows the first exception raised by a task.
+{
+    std::unique_lock<std::mutex> lock(tasks_mutex);
+    all_done.wait(lock, [this] { return pending == 0; });
+
+    if(first_error)
+    {
+        std::exception_ptr error = first_error;
+        first_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::wait_below(std::size_t max_pending)
+// Blocks until fewer than max_pending submitted tasks are queued or running.
+{
+    std::unique_lock<std::mutex> lock(tasks_mutex);
+    task_finished.wait(lock, [this, max_pending] { return pending < max_pending; });
+}
+
+unsigned ThreadPool::size() const
+{
+    return static_cast<unsigned>(workers.size());
+}
+
+void ThreadPool::worker_loop()
+{
+    while(true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(tasks_mutex);
+            task_available.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if(tasks.empty())
+            {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+
+        std::exception_ptr error;
+        try
+        {
+            task();
+        }
+        catch(...)
+        {
+            error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(tasks_mutex);
+            if(error && !first_error)
+            {
+                first_error = error;
+            }
+            pending--;
+            if(pending == 0)
+            {
+                all_done.notify_all();
+            }
+        }
+        task_finished.notify_one();
+    }
+}
+
+void parallel_for(ThreadPool& pool, std::size_t count, const std::function<void(std::size_t begin, std::size_t end)>& body)
+// Splits [0, count) into contiguous ranges, runs body on each range in the pool and waits for completion.
+{
+    if(count == 0)
+    {
+        return;
+    }
+
+    // A few ranges per worker keeps threads busy when ranges take uneven time
+    std::size_t range_count = std::min<std::size_t>(count, static_cast<std::size_t>(pool.size()) * 4);
+    std::size_t range_size = (count + range_count - 1) / range_count;
+
+    for(std::size_t begin = 0; begin < count; begin += range_size)
+    {
+        std::size_t end = std::min(count, begin + range_size);
+        pool.submit([&body, begin, end] { body(begin, end); });
+    }
+    pool.wait();
+}
@@ -0,0 +1,46 @@
+#ifndef _THREAD_POOL_H_
+#define _THREAD_POOL_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+// Fixed-size pool of worker threads. Tasks are run in submission order by the first free worker.
+// wait() blocks until every submitted task has finished and rethrows the first exception thrown by a task.
+// A producer that must not run ahead of the workers calls wait_below() before each submit.
+{
+    public:
+        explicit ThreadPool(unsigned thread_count = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        void submit(std::function<void()> task);
+        void wait();
+        void wait_below(std::size_t max_pending);
+        unsigned size() const;
+
+    private:
+        void worker_loop();
+
+        std::vector<std::thread> workers;
+        std::queue<std::function<void()>> tasks;
+        std::mutex tasks_mutex;
+        std::condition_variable task_available;
+        std::condition_variable all_done;
+        std::condition_variable task_finished;
+        std::size_t pending = 0;
+        bool stopping = false;
+        std::exception_ptr first_error;
+};
+
+void parallel_for(ThreadPool& pool, std::size_t count, const std::function<void(std::size_t begin, std::size_t end)>& body);
+
+#endif
@@ -0,0 +1,163 @@
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "Trace.h"
+
+namespace
+{
+    typedef struct TraceEvent
+    {
+        const char* name;
+        std::int64_t start_ns;
+        std::int64_t duration_ns;
+        std::size_t thread_id;
+        std::vector<std::pair<const char*, std::uint64_t>> counters;
+    } TraceEvent;
+
+    class Tracer
+    // Collects finished spans and writes them to the trace file on destruction (process exit).
+    {
+        public:
+            Tracer()
+            {
+                const char* path = std::getenv("MINIGIT_TRACE");
+                if(path != nullptr && *path != '\0')
+                {
+                    output_path = path;
+                }
+                origin = std::chrono::steady_clock::now();
+            }
+
+            ~Tracer()
+            {
+                if(output_path.empty())
+                {
+                    return;
+                }
+
+                nlohmann::json events = nlohmann::json::array();
+                for(auto const& event : events_buffer)
+                {
+                    nlohmann::json args = nlohmann::json::object();
+                    for(auto const& [counter_name, value] : event.counters)
+                    {
+                        args[counter_name] = value;
+                    }
+
+                    // Chrome trace-event timestamps are in microseconds, fractions keep nanosecond resolution
+                    events.push_back({
+                        {"name",    event.name},
+                        {"cat",     "minigit"},
+                        {"ph",      "X"},
+                        {"ts",      event.start_ns / 1000.0},
+                        {"dur",     event.duration_ns / 1000.0},
+                        {"pid",     1},
+                        {"tid",     event.thread_id},
+                        {"args",    args}
+                    });
+                }
+
+                nlohmann::json json_data;
+                json_data["traceEvents"] = events;
+                json_data["displayTimeUnit"] = "ns";
+                std::ofstream file(output_path);
+                file << json_data.dump();
+                file.close();
+            }
+
+            bool enabled() const
+            {
+                return !output_path.empty();
+            }
+
+            std::int64_t since_origin(std::chrono::steady_clock::time_point tp) const
+            {
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(tp - origin).count();
+            }
+
+            void record(TraceEvent&& event)
+            {
+                std::lock_guard<std::mutex> lock(events_mutex);
+                events_buffer.push_back(std::move(event));
+            }
+
+        private:
+            std::string output_path;
+            std::chrono::steady_clock::time_point origin;
+            std::mutex events_mutex;
+            std::vector<TraceEvent> events_buffer;
+    };
+
+    Tracer& tracer()
+    {
+        static Tracer instance;
+        return instance;
+    }
+
+    // Evaluated once, so disabled spans only test a plain bool
+    const bool tracing = tracer().enabled();
+}
+
+bool trace_enabled()
+{
+    return tracing;
+}
+
+TraceSpan::TraceSpan(const char* name) : name(name), active(tracing)
+{
+    if(active)
+    {
+        start = std::chrono::steady_clock::now();
+    }
+}
+
+TraceSpan::~TraceSpan()
+{
+    if(active)
+    {
+        auto end = std::chrono::steady_clock::now();
+
+        TraceEvent event;
+        event.name = name;
+        event.start_ns = tracer().since_origin(start);
+        event.duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        event.thread_id = std::hash<std::thread::id>{}(std::this_thread::get_id()) % 100000;
+        for(int i = 0; i < counter_count; i++)
+        {
+            event.counters.emplace_back(counter_names[i], counter_values[i]);
+        }
+        tracer().record(std::move(event));
+    }
+}
+
+void TraceSpan::add_counter(const char* counter_name, std::uint64_t value)
+// Adds value to the named counter of this span. At most MAX_COUNTERS distinct counters are kept.
+{
+    if(!active)
+    {
+        return;
+    }
+
+    for(int i = 0; i < counter_count; i++)
+    {
+        if(counter_names[i] == counter_name)
+        {
+            counter_values[i] += value;
+            return;
+        }
+    }
+
+    if(counter_count < MAX_COUNTERS)
+    {
+        counter_names[counter_count] = counter_name;
+        counter_values[counter_count] = value;
+        counter_count++;
+    }
+}
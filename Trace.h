@@ -0,0 +1,41 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <chrono>
+#include <cstdint>
+
+// Scoped tracing spans written as Chrome/Perfetto trace-event JSON.
+// Tracing is enabled by setting MINIGIT_TRACE=<file>; the trace is written to that file when the process exits.
+// When the variable is not set a span costs a single branch on construction and destruction.
+
+bool trace_enabled();
+
+class TraceSpan
+{
+    public:
+        explicit TraceSpan(const char* name);
+        ~TraceSpan();
+
+        TraceSpan(const TraceSpan&) = delete;
+        TraceSpan& operator=(const TraceSpan&) = delete;
+
+        bool enabled() const { return active; }
+        void add_counter(const char* counter_name, std::uint64_t value);
+
+        static const int MAX_COUNTERS = 4;
+
+    private:
+        const char* name;
+        bool active;
+        std::chrono::steady_clock::time_point start;
+        const char* counter_names[MAX_COUNTERS];
+        std::uint64_t counter_values[MAX_COUNTERS];
+        int counter_count = 0;
+};
+
+// Counter names shared by all spans
+const char* const TRACE_BYTES_READ = "bytes_read";
+const char* const TRACE_BYTES_WRITTEN = "bytes_written";
+const char* const TRACE_FILES_STATED = "files_stated";
+
+#endif
@@ -0,0 +1,116 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "Trace.h"
+#include "UntrackedCache.h"
+
+static const char CACHE_MAGIC[4] = {'M', 'G', 'U', 'C'};
+static const std::uint32_t CACHE_VERSION = 1;
+
+static void write_be(std::ofstream& stream, std::uint64_t value, int size)
+{
+    char bytes[8];
+    for(int i = size - 1; i >= 0; i--)
+    {
+        bytes[i] = static_cast<char>(value);
+        value >>= 8;
+    }
+    stream.write(bytes, size);
+}
+
+static bool read_be(std::ifstream& stream, std::uint64_t& value, int size)
+{
+    unsigned char bytes[8];
+    if(!stream.read(reinterpret_cast<char*>(bytes), size))
+    {
+        return false;
+    }
+    value = 0;
+    for(int i = 0; i < size; i++)
+    {
+        value = (value << 8) | bytes[i];
+    }
+    return true;
+}
+
+UntrackedCache::UntrackedCache(const std::filesystem::path& cache_path) : cache_path(cache_path)
+{
+}
+
+bool UntrackedCache::load(std::filesystem::file_time_type directory_time, std::vector<std::string>& files) const
+// Reads the cached listing into files if it was taken at directory_time. Returns false if there is
+// no complete listing for that time.
+{
+    TraceSpan span("load_untracked_cache");
+
+    std::ifstream cache(cache_path, std::ios::binary);
+    char magic[sizeof(CACHE_MAGIC)];
+    std::uint64_t version = 0;
+    std::uint64_t cached_time = 0;
+    std::uint64_t count = 0;
+    if(!cache.read(magic, sizeof(magic)) || std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0 ||
+        !read_be(cache, version, 4) || version != CACHE_VERSION || !read_be(cache, cached_time, 8) ||
+        cached_time != static_cast<std::uint64_t>(directory_time.time_since_epoch().count()) || !read_be(cache, count, 4))
+    {
+        return false;
+    }
+
+    std::vector<std::string> names;
+    names.reserve(count);
+    std::uint64_t length = 0;
+    while(names.size() < count && read_be(cache, length, 4))
+    {
+        std::string name(length, '\0');
+        if(!cache.read(name.data(), length))
+        {
+            return false;
+        }
+        names.push_back(std::move(name));
+    }
+    if(names.size() != count)
+    {
+        return false;
+    }
+
+    files.insert(files.end(), std::make_move_iterator(names.begin()), std::make_move_iterator(names.end()));
+    span.add_counter("files", count);
+    return true;
+}
+
+void UntrackedCache::store(std::filesystem::file_time_type directory_time, const std::vector<std::string>& files) const
+// Replaces the cached listing, unless directory_time is too recent to be trusted. The file is written under
+// a temporary name and renamed, so readers never see a partial listing.
+{
+    if(std::filesystem::file_time_type::clock::now() - directory_time < RACY_INTERVAL)
+    {
+        std::error_code error;
+        std::filesystem::remove(cache_path, error);
+        return;
+    }
+
+    TraceSpan span("store_untracked_cache");
+
+    std::filesystem::path temporary_path = cache_path.string() + ".tmp";
+    {
+        std::ofstream cache(temporary_path, std::ios::binary | std::ios::trunc);
+        cache.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        write_be(cache, CACHE_VERSION, 4);
+        write_be(cache, static_cast<std::uint64_t>(directory_time.time_since_epoch().count()), 8);
+        write_be(cache, files.size(), 4);
+        for(auto const& name : files)
+        {
+            write_be(cache, name.size(), 4);
+            cache.write(name.data(), name.size());
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary_path, cache_path, error);
+    if(error)
+    {
+        std::filesystem::remove(temporary_path, error);
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef _UNTRACKED_CACHE_H_
+#define _UNTRACKED_CACHE_H_
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+class UntrackedCache
+// Listing of the working directory from the last scan, keyed by the directory's last write time. Creating,
+// deleting or renaming an entry updates that time, so while it is unchanged the listing is still exact and
+// status skips reading the directory. Only the names are cached: tracked files are still stat'ed for changes.
+// All regular files are kept, not just the untracked ones, as a file can be staged or unstaged without
+// touching the directory.
+//
+// A listing is not stored while the directory time is within RACY_INTERVAL of the current time: a later change
+// in the same timestamp tick would leave the time unchanged and the cached listing stale.
+//
+// File layout (integers big-endian): "MGUC", version, directory time (64-bit), count, names {length, bytes}.
+{
+    public:
+        explicit UntrackedCache(const std::filesystem::path& cache_path);
+
+        bool load(std::filesystem::file_time_type directory_time, std::vector<std::string>& files) const;
+        void store(std::filesystem::file_time_type directory_time, const std::vector<std::string>& files) const;
+
+        static constexpr std::chrono::seconds RACY_INTERVAL {2};
+
+    private:
+        std::filesystem::path cache_path;
+};
+
+#endif
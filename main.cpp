@@ -1,32 +1,422 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <string>
 #include <vector>
 
+#include <unistd.h>
+
+#include "MiniGit.h"
+#include "OutputWriter.h"
 #include "Repository.h"
 
+// Command-line front end: parses arguments, calls the Repository API and prints its results.
+// All standard output goes through one buffered writer that is flushed when the program exits.
+
+static OutputWriter out(stdout);
+static bool porcelain = false;
+
+static void print_error(const Error& error)
+{
+    switch (error.code)
+    {
+        case ErrorCode::NotInitialized:
+            out << "Error: " << error.message << '\n';
+            break;
+        case ErrorCode::AlreadyInitialized:
+        case ErrorCode::NothingToCommit:
+            out << error.message << '\n';
+            break;
+        case ErrorCode::FilesystemError:
+            std::cerr << "Error: " << error.message << '\n';
+            break;
+        default:
+            out << "ERROR: " << error.message << '\n';
+            break;
+    }
+}
+
+static void print_file_list(const std::string& header, const std::vector<std::string>& files)
+{
+    if (files.size())
+    {
+        out << header << '\n';
+        for (auto const& file : files)
+        {
+            out << "\t" << file << '\n';
+        }
+    }
+}
+
+static void print_blocking_changes(const Error& error, const WorkingTreeChanges& changes)
+{
+    print_error(error);
+    if (error.code == ErrorCode::UncommittedChanges)
+    {
+        print_file_list("Changes to be committed:", changes.staged);
+        print_file_list("Changes not staged for commit:", changes.modified);
+    }
+}
+
+static void print_status(const StatusResult& result)
+{
+    out << "On branch " << result.branch << '\n';
+
+    if (result.merging)
+    {
+        out << "You have unmerged paths. Fix conflicts, stage to mark resolutions then commit.\n";
+    }
+
+    print_file_list("Changes to be committed:", result.staged);
+    print_file_list("Changes not staged for commit:", result.modified);
+    print_file_list("Deleted files:", result.deleted);
+    print_file_list("Untracked files:", result.untracked);
+
+    if ((!result.untracked.size()) && (!result.modified.size()) && !(result.staged.size()) && !(result.deleted.size()))
+    {
+        out << "Nothing to commit, working tree clean.\n";
+    }
+}
+
+static std::string abbreviated(const ObjectId& id, const LogResult& result)
+// The id cut to the log's abbreviation length (the full id unless --abbrev was given).
+{
+    return id.to_hex().substr(0, result.abbrev_length);
+}
+
+static void print_stat(const std::vector<FileChange>& changes)
+// One line per changed file with its added and removed line counts, then the totals.
+{
+    std::size_t added = 0;
+    std::size_t removed = 0;
+    for (auto const& change : changes)
+    {
+        out << ' ' << change.path << " | +" << change.added << " -" << change.removed << '\n';
+        added += change.added;
+        removed += change.removed;
+    }
+    out << ' ' << changes.size() << (changes.size() == 1 ? " file changed, " : " files changed, ")
+        << added << " insertions(+), " << removed << " deletions(-)\n";
+}
+
+static void print_stat_porcelain(const std::vector<FileChange>& changes)
+// One record per changed file: added lines, removed lines, path, tab separated.
+{
+    for (auto const& change : changes)
+    {
+        out << change.added << '\t' << change.removed << '\t' << change.path;
+        out.end_record();
+    }
+}
+
+static void print_log(const LogResult& result)
+{
+    for (std::size_t i = 0; i < result.entries.size(); i++)
+    {
+        const LogEntry& entry = result.entries[i];
+        out << "commit " << abbreviated(entry.new_commit_id, result) << '\n';
+
+        if (entry.merge)
+        {
+            out << "Merge " << abbreviated(entry.old_commit_id, result) << " " 
+                << abbreviated(entry.other_commit_id, result) << '\n';
+        }
+
+        out << "Author: " << entry.author << '\n';
+        out << "Date: " << entry.timestamp << '\n';
+        out << '\n';
+        out << entry.message;
+        out << "\n\n";
+
+        if (i < result.changes.size())
+        {
+            print_stat(result.changes[i]);
+            out << '\n';
+        }
+    }
+}
+
+static void print_show(const ShowResult& result)
+{
+    const CommitInfo& commit = result.commit;
+    out << "commit " << commit.id << '\n';
+
+    if (!commit.parent_2_id.is_null())
+    {
+        out << "Merge " << commit.parent_1_id << " " << commit.parent_2_id << '\n';
+    }
+
+    out << "Author: " << commit.author << '\n';
+    out << "Date: " << commit.timestamp << '\n';
+    out << '\n';
+    out << commit.message;
+    out << "\n\n";
+    print_stat(result.changes);
+}
+
+static std::vector<std::string> parse_output_options(int argc, char* argv[])
+// Returns the arguments after the command with the output options removed.
+// --porcelain selects the stable machine-readable format, -z additionally terminates records with NUL
+// and implies --porcelain. The value following -m is never taken as an option.
+{
+    std::vector<std::string> arguments;
+
+    for (int i = 2; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        if (argument == "--porcelain")
+        {
+            porcelain = true;
+        }
+        else if (argument == "-z")
+        {
+            porcelain = true;
+            out.set_nul_terminated(true);
+        }
+        else
+        {
+            arguments.push_back(argument);
+            if (argument == "-m" && i + 1 < argc)
+            {
+                arguments.push_back(argv[++i]);
+            }
+        }
+    }
+
+    return arguments;
+}
+
+static void print_status_header_porcelain(const StatusResult& result)
+// Header records start with '#'.
+{
+    out << "# branch " << result.branch;
+    out.end_record();
+
+    if (result.merging)
+    {
+        out << "# merging";
+        out.end_record();
+    }
+}
+
+static void print_status_entry_porcelain(const StatusEntry& entry)
+// One record per path, in path order, "XY <path>": X is the index state and Y the working directory state,
+// 'M' for modified, 'D' for deleted and ' ' for unchanged. "??" marks untracked files.
+{
+    out << static_cast<char>(entry.staged) << static_cast<char>(entry.unstaged) << ' ' << entry.path;
+    out.end_record();
+}
 
-int main(int argc, char* argv[]) 
+static void print_log_porcelain(const LogResult& result)
+// One record per commit, newest first, with tab separated fields:
+// commit id, parent id, merged commit id (empty unless a merge), author, date, message.
+// With --stat each commit record is followed by its print_stat_porcelain records.
 {
-    if (argc < 2) 
+    for (std::size_t i = 0; i < result.entries.size(); i++)
     {
-        std::cout << "Usage: minigit <command> [options]\n";
+        const LogEntry& entry = result.entries[i];
+        out << abbreviated(entry.new_commit_id, result) << '\t' 
+            << abbreviated(entry.old_commit_id, result) << '\t' 
+            << (entry.merge ? abbreviated(entry.other_commit_id, result) : "") << '\t'
+            << entry.author << '\t' 
+            << entry.timestamp << '\t' 
+            << entry.message;
+        out.end_record();
+
+        if (i < result.changes.size())
+        {
+            print_stat_porcelain(result.changes[i]);
+        }
+    }
+}
+
+static void print_show_porcelain(const ShowResult& result)
+// The commit record in the log format followed by the print_stat_porcelain records.
+{
+    const CommitInfo& commit = result.commit;
+    out << commit.id << '\t' 
+        << commit.parent_1_id << '\t' 
+        << (commit.parent_2_id.is_null() ? "" : commit.parent_2_id.to_hex()) << '\t'
+        << commit.author << '\t' 
+        << commit.timestamp << '\t' 
+        << commit.message;
+    out.end_record();
+    print_stat_porcelain(result.changes);
+}
+
+static void print_blame(const BlameResult& result)
+// One line per file line: abbreviated commit id, author, date and line number, then the line.
+{
+    for (std::size_t i = 0; i < result.lines.size(); i++)
+    {
+        const BlameLine& line = result.lines[i];
+        out << line.commit_id.to_hex().substr(0, 8) << " (" << line.author << ' ' << line.timestamp << ' ' 
+            << (i + 1) << ") " << line.text << '\n';
+    }
+}
+
+static void print_blame_porcelain(const BlameResult& result)
+// One record per file line with tab separated fields: commit id, line number, author, date, line.
+{
+    for (std::size_t i = 0; i < result.lines.size(); i++)
+    {
+        const BlameLine& line = result.lines[i];
+        out << line.commit_id << '\t' << (i + 1) << '\t' << line.author << '\t' << line.timestamp << '\t' << line.text;
+        out.end_record();
+    }
+}
+
+static void print_grep(const GrepResult& result, const std::string& commit_id)
+// One line per match, "<path>:<line number>:<line>", prefixed with "<commit id>:" when searching a commit.
+{
+    for (auto const& match : result.matches)
+    {
+        if (!commit_id.empty())
+        {
+            out << commit_id << ':';
+        }
+        out << match.path << ':' << match.line_number << ':' << match.line << '\n';
+    }
+}
+
+static void print_grep_porcelain(const GrepResult& result)
+// One record per match with tab separated fields: path, line number, line.
+{
+    for (auto const& match : result.matches)
+    {
+        out << match.path << '\t' << match.line_number << '\t' << match.line;
+        out.end_record();
+    }
+}
+
+static void print_merge(const MergeResult& result)
+{
+    switch (result.outcome)
+    {
+        case MergeOutcome::UpToDate:
+            out << "Already up to date.\n";
+            break;
+        case MergeOutcome::FastForward:
+            out << "Fast-forward " << result.old_commit_id << " to " << result.new_commit_id << '\n';
+            break;
+        case MergeOutcome::Merged:
+            out << "Auto-merge succeeded. Merged " << result.branch << " into " << result.current_branch << '\n';
+            break;
+        case MergeOutcome::Conflict:
+            out << "Automerge failed. Fix conflicts and then commit the result.\n";
+            break;
+        case MergeOutcome::None:
+            break;
+    }
+}
+
+static void print_transfer(const TransferResult& result)
+{
+    for (auto const& update : result.updates)
+    {
+        switch (update.status)
+        {
+            case RefUpdateStatus::UpToDate:
+                break;
+            case RefUpdateStatus::Created:
+                out << "New branch " << update.branch << " at " << update.new_commit_id << '\n';
+                break;
+            case RefUpdateStatus::FastForward:
+                out << "Fast-forward " << update.branch << " " << update.old_commit_id << " to " << update.new_commit_id << '\n';
+                break;
+            case RefUpdateStatus::NotFastForward:
+                out << "Rejected " << update.branch << ": not a fast-forward.\n";
+                break;
+            case RefUpdateStatus::CheckedOut:
+                out << "Rejected " << update.branch << ": branch is checked out and cannot be updated.\n";
+                break;
+        }
+    }
+    if (result.commits || result.blobs)
+    {
+        out << "Transferred " << result.commits << " commits and " << result.blobs << " blobs ("
+            << result.pack_size << " bytes).\n";
+    }
+}
+
+static void print_count_objects(const CountObjectsResult& result)
+{
+    out << "blobs: " << result.blob_count << '\n';
+    out << "blobs size: " << result.blobs_size << " bytes\n";
+    out << "average blob size: " << (result.blob_count ? result.blobs_size / result.blob_count : 0) << " bytes\n";
+    out << "largest blob size: " << result.largest_blob_size << " bytes\n";
+    out << "unreachable blobs: " << result.unreachable_blobs << '\n';
+    out << "chunks: " << result.chunk_count << '\n';
+    out << "chunks size: " << result.chunks_size << " bytes\n";
+    out << "commits: " << result.commit_count << '\n';
+    out << "commits size: " << result.commits_size << " bytes\n";
+    out << "unreachable commits: " << result.unreachable_commits << '\n';
+    out << "log files: " << result.log_file_count << '\n';
+    out << "log files size: " << result.logs_size << " bytes\n";
+    out << "index entries: " << result.index_entries << '\n';
+    out << "total size: " << result.blobs_size + result.chunks_size + result.commits_size + result.logs_size << " bytes\n";
+}
+
+static void print_fsck(const FsckResult& result)
+{
+    for (auto const& problem : result.problems)
+    {
+        out << problem << '\n';
+    }
+    out << "Checked " << result.commits_checked << " commits, " << result.blobs_checked << " blobs and "
+        << result.chunks_checked << " chunks (" << result.bytes_hashed << " bytes hashed).\n";
+    if (result.problems.empty())
+    {
+        out << "No problems found.\n";
+    }
+    else
+    {
+        out << result.problems.size() << " problems found.\n";
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        out << "Usage: minigit <command> [options]\n";
         return 1;
     }
 
     std::string command = argv[1];
     Repository repository;
 
-    if (command == "init") 
+    if (command == "init")
     {
-        std::cout << "Initializing MiniGit repository...\n";
-        repository.init();
+        HashAlgorithm algorithm = HashAlgorithm::Sha1;
+        const std::string object_format_option = "--object-format=";
+
+        if (argc > 3 || (argc == 3 && (std::string(argv[2]).rfind(object_format_option, 0) != 0 ||
+            !parse_hash_algorithm(std::string(argv[2]).substr(object_format_option.size()), algorithm))))
+        {
+            out << "Usage: minigit init [--object-format=sha1|sha256]";
+            return 1;
+        }
+
+        out << "Initializing MiniGit repository...\n";
+        InitResult result = repository.init(algorithm);
+        for (auto const& dir_name : result.created_directories)
+        {
+            out << "Initialized MiniGit repository in: " << dir_name << '\n';
+        }
+        if (result.error)
+        {
+            print_error(result.error);
+        }
     }
 
-    else if (command == "add") 
+    else if (command == "add")
     {
-        if (argc < 3) 
+        if (argc < 3)
         {
-            std::cout << "Usage: minigit add <file1> <file2> <file3> ... \n";
+            out << "Usage: minigit add <file1> <file2> <file3> ... \n";
             return 1;
         }
 
@@ -36,104 +426,596 @@ int main(int argc, char* argv[])
         {
              filenames.push_back(argv[i]);
         }
-        repository.add(filenames);
+
+        AddResult result = repository.add(filenames);
+        if (result.error)
+        {
+            print_error(result.error);
+        }
+        for (auto const& filename : result.added)
+        {
+            out << "Added " << filename << '\n';
+        }
+        for (auto const& filename : result.not_found)
+        {
+            out << "ERROR: file " << filename << " did not match any files.\n";
+        }
     }
 
-    else if (command == "commit") 
+    else if (command == "commit")
     {
+        std::vector<std::string> arguments = parse_output_options(argc, argv);
         std::string message;
-        for (int i = 2; i < argc; i++) 
+        for (std::size_t i = 0; i < arguments.size(); i++)
         {
-            if ((std::string(argv[i]) == "-m") && (i + 1 < argc)) 
+            if ((arguments[i] == "-m") && (i + 1 < arguments.size()))
             {
-                message = argv[i + 1];
+                message = arguments[i + 1];
                 i++;
             }
         }
 
-        if (message.empty()) 
+        if (message.empty())
         {
-            std::cout << "Usage: minigit commit -m \"message\"\n";
+            out << "Usage: minigit commit -m \"message\" [--porcelain] [-z]\n";
             return 1;
         }
 
-        repository.commit(message);
+        CommitResult result = repository.commit(message);
+        if (result.error)
+        {
+            print_error(result.error);
+        }
+        else if (porcelain)
+        {
+            // The new commit id, then one record per changed file
+            out << result.commit_id;
+            out.end_record();
+            for (auto const& filename : result.changed_files)
+            {
+                out << filename;
+                out.end_record();
+            }
+        }
+        else
+        {
+            out << "Committed: \n";
+            for (auto const& filename : result.changed_files)
+            {
+                out << "\t" << filename << '\n';
+            }
+        }
     }
 
-    else if (command == "status") 
+    else if (command == "status")
     {
-        repository.status();
+        parse_output_options(argc, argv);
+        if (porcelain)
+        {
+            // Records are written as the repository walk produces them
+            StatusResult result = repository.status(print_status_entry_porcelain, print_status_header_porcelain);
+            if (result.error)
+            {
+                print_error(result.error);
+            }
+        }
+        else
+        {
+            StatusResult result = repository.status();
+            if (result.error)
+            {
+                print_error(result.error);
+            }
+            else
+            {
+                print_status(result);
+            }
+        }
     }
 
     else if (command == "log")
     {
-        repository.print_log();
+        // --abbrev shortens commit ids to the shortest unique prefix of at least 7 (or <n>) digits,
+        // -- <path> lists only the commits that changed the path, --stat adds the files each commit changed
+        std::size_t abbrev = 0;
+        std::string path;
+        bool stat = false;
+        std::vector<std::string> arguments = parse_output_options(argc, argv);
+        for (std::size_t i = 0; i < arguments.size(); i++)
+        {
+            const std::string& argument = arguments[i];
+            if (argument == "--")
+            {
+                if (i + 2 != arguments.size())
+                {
+                    out << "Usage: minigit log [--abbrev[=<n>]] [--stat] [--porcelain] [-z] [-- <path>]";
+                    return 1;
+                }
+                path = arguments[++i];
+            }
+            else if (argument == "--abbrev")
+            {
+                abbrev = 7;
+            }
+            else if (argument == "--stat")
+            {
+                stat = true;
+            }
+            else if (argument.rfind("--abbrev=", 0) == 0)
+            {
+                std::size_t minimum = MINIGIT_MIN_ABBREV_LENGTH;
+                abbrev = std::max(minimum, static_cast<std::size_t>(std::strtoul(argument.c_str() + 9, nullptr, 10)));
+            }
+        }
+
+        LogResult result = repository.log(abbrev, path, stat);
+        if (result.error)
+        {
+            print_error(result.error);
+        }
+        else if (porcelain)
+        {
+            print_log_porcelain(result);
+        }
+        else
+        {
+            print_log(result);
+        }
     }
 
     else if (command == "revert")
     {
-        if (argc != 3) 
+        if (argc != 3)
         {
-            std::cout << "Usage: minigit revert <commit_id>";
+            out << "Usage: minigit revert <commit_id>";
             return 1;
         }
         else
         {
             std::string commit_id = argv[2];
-            repository.revert(commit_id);
-        } 
+            RevertResult result = repository.revert(commit_id);
+            if (result.error)
+            {
+                print_blocking_changes(result.error, result.blocking_changes);
+            }
+        }
+    }
+
+    else if (command == "show")
+    {
+        std::vector<std::string> arguments = parse_output_options(argc, argv);
+        if (arguments.size() != 1)
+        {
+            out << "Usage: minigit show [--porcelain] [-z] <commit_id>";
+            return 1;
+        }
+        else
+        {
+            ShowResult result = repository.show(arguments[0]);
+            if (result.error)
+            {
+                print_error(result.error);
+            }
+            else if (porcelain)
+            {
+                print_show_porcelain(result);
+            }
+            else
+            {
+                print_show(result);
+            }
+        }
+    }
+
+    else if (command == "blame")
+    {
+        std::vector<std::string> arguments = parse_output_options(argc, argv);
+        if (arguments.size() != 1)
+        {
+            out << "Usage: minigit blame [--porcelain] [-z] <file>";
+            return 1;
+        }
+        else
+        {
+            BlameResult result = repository.blame(arguments[0]);
+            if (result.error)
+            {
+                print_error(result.error);
+            }
+            else if (porcelain)
+            {
+                print_blame_porcelain(result);
+            }
+            else
+            {
+                print_blame(result);
+            }
+        }
+    }
+
+    else if (command == "grep")
+    {
+        std::vector<std::string> arguments = parse_output_options(argc, argv);
+        if (arguments.size() != 1 && arguments.size() != 2)
+        {
+            out << "Usage: minigit grep [--porcelain] [-z] <pattern> [<commit_id>]";
+            return 1;
+        }
+        else
+        {
+            std::string commit_id = arguments.size() == 2 ? arguments[1] : "";
+            GrepResult result = repository.grep(arguments[0], commit_id);
+            if (result.error)
+            {
+                print_error(result.error);
+            }
+            else if (porcelain)
+            {
+                print_grep_porcelain(result);
+            }
+            else
+            {
+                print_grep(result, commit_id);
+            }
+        }
     }
 
     else if (command == "checkout")
     {
-        if (argc != 3) 
+        if (argc != 3)
         {
-            std::cout << "Usage: minigit checkout <branch name>";
+            out << "Usage: minigit checkout <branch name>";
             return 1;
         }
         else
         {
             std::string branch = argv[2];
-            repository.checkout(branch);
-        }         
+            CheckoutResult result = repository.checkout(branch);
+            if (result.error)
+            {
+                print_blocking_changes(result.error, result.blocking_changes);
+            }
+        }
     }
 
     else if (command == "branch")
     {
-        if (argc > 3) 
+        std::vector<std::string> arguments = parse_output_options(argc, argv);
+        if (arguments.size() > 1)
         {
-            std::cout << "Usage: minigit branch <branch name> OR minigit branch";
+            out << "Usage: minigit branch <branch name> OR minigit branch [--porcelain] [-z]";
             return 1;
-        }     
-        else if(argc == 3)
+        }
+        else if(arguments.size() == 1)
         {
-            std::string branch = argv[2];
-            repository.create_branch(branch);
-        }   
+            std::string branch = arguments[0];
+            BranchResult result = repository.create_branch(branch);
+            if (result.error)
+            {
+                print_error(result.error);
+            }
+        }
         else
         {
-            repository.print_branches();
+            BranchListResult result = repository.list_branches();
+            if (result.error)
+            {
+                print_error(result.error);
+            }
+            for (auto const& branch : result.branches)
+            {
+                out << branch;
+                if (porcelain)
+                {
+                    out.end_record();
+                }
+                else
+                {
+                    out << '\n';
+                }
+            }
         }
     }
     else if (command == "merge")
     {
-        if (argc == 2 || argc > 3) 
+        if (argc == 2 || argc > 3)
         {
-            std::cout << "Usage: minigit merge <branch name>";
+            out << "Usage: minigit merge <branch name>";
             return 1;
-        }     
+        }
         else
         {
             std::string branch = argv[2];
-            repository.merge(branch);
-        }   
+            MergeResult result = repository.merge(branch);
+            if (result.error)
+            {
+                print_blocking_changes(result.error, result.blocking_changes);
+            }
+            else
+            {
+                print_merge(result);
+            }
+        }
+    }
+    else if (command == "count-objects")
+    {
+        CountObjectsResult result = repository.count_objects();
+        if (result.error)
+        {
+            print_error(result.error);
+        }
+        else
+        {
+            print_count_objects(result);
+        }
+    }
+    else if (command == "fsck")
+    {
+        if (argc > 3 || (argc == 3 && std::string(argv[2]) != "--progress"))
+        {
+            out << "Usage: minigit fsck [--progress]";
+            return 1;
+        }
+
+        // Progress goes to stderr, by default only when it is a terminal
+        bool show_progress = argc == 3 || isatty(fileno(stderr));
+        bool progress_shown = false;
+        ProgressCallback progress = [&progress_shown](std::size_t done, std::size_t total)
+        {
+            std::cerr << "\rChecking objects: " << done * 100 / total << "% (" << done << '/' << total << ')' << std::flush;
+            progress_shown = true;
+        };
+
+        FsckResult result = repository.fsck(show_progress ? progress : nullptr);
+        if (progress_shown)
+        {
+            std::cerr << '\n';
+        }
+        if (result.error)
+        {
+            print_error(result.error);
+        }
+        else
+        {
+            print_fsck(result);
+            if (!result.problems.empty())
+            {
+                return 1;
+            }
+        }
+    }
+    else if (command == "gc")
+    {
+        long long prune_grace_seconds = MINIGIT_GC_DEFAULT_PRUNE_SECONDS;
+        const std::string prune_option = "--prune=";
+
+        if (argc > 3 || (argc == 3 && std::string(argv[2]).rfind(prune_option, 0) != 0))
+        {
+            out << "Usage: minigit gc [--prune=<seconds>|--prune=now]";
+            return 1;
+        }
+        else if (argc == 3)
+        {
+            std::string prune_value = std::string(argv[2]).substr(prune_option.size());
+            if (prune_value == "now")
+            {
+                prune_grace_seconds = 0;
+            }
+            else
+            {
+                try
+                {
+                    prune_grace_seconds = std::stoll(prune_value);
+                }
+                catch (const std::exception&)
+                {
+                    out << "Usage: minigit gc [--prune=<seconds>|--prune=now]";
+                    return 1;
+                }
+            }
+        }
+
+        GcResult result = repository.gc(prune_grace_seconds);
+        if (result.error)
+        {
+            print_error(result.error);
+        }
+        else
+        {
+            out << "Removed " << result.removed_blobs << " unreachable blobs and "
+                << result.removed_commits << " unreachable commits ("
+                << result.removed_size << " bytes).\n";
+            if (result.removed_chunks)
+            {
+                out << "Removed " << result.removed_chunks << " unreferenced chunks.\n";
+            }
+        }
+    }
+
+    else if (command == "sparse-checkout")
+    {
+        std::string subcommand = argc > 2 ? argv[2] : "";
+        if (!(subcommand == "list" && argc == 3) && !(subcommand == "disable" && argc == 3) && 
+                !(subcommand == "set" && argc > 3))
+        {
+            out << "Usage: minigit sparse-checkout (set <pattern>... | list | disable)";
+            return 1;
+        }
+
+        SparseCheckoutResult result;
+        if (subcommand == "list")
+        {
+            result = repository.sparse_checkout_list();
+        }
+        else
+        {
+            std::vector<std::string> patterns(argv + 3, argv + argc);
+            result = repository.sparse_checkout_set(patterns);
+        }
+
+        if (result.error)
+        {
+            print_error(result.error);
+        }
+        else if (subcommand == "list")
+        {
+            for (auto const& pattern : result.patterns)
+            {
+                out << pattern << '\n';
+            }
+        }
+        else
+        {
+            for (auto const& file : result.kept_modified)
+            {
+                out << "Not removing " << file << ": it has local changes.\n";
+            }
+        }
+    }
+
+    else if (command == "clone")
+    {
+        if (argc != 3 && argc != 4)
+        {
+            out << "Usage: minigit clone <repository> [<directory>]";
+            return 1;
+        }
+
+        // The clone is created in its own directory, which then becomes the working directory of the repository
+        std::filesystem::path source = std::filesystem::absolute(argv[2]).lexically_normal();
+        if (source.filename().empty())
+        {
+            source = source.parent_path(); // trailing separator
+        }
+        std::filesystem::path directory = argc == 4 ? std::filesystem::path(argv[3]) : source.filename();
+
+        std::error_code error;
+        if (std::filesystem::exists(directory) && !std::filesystem::is_empty(directory, error))
+        {
+            out << "ERROR: destination " << directory.string() << " already exists and is not empty.\n";
+            return 1;
+        }
+        std::filesystem::create_directories(directory);
+        std::filesystem::current_path(directory);
+
+        Repository clone_repository;
+        TransferResult result = clone_repository.clone(source.string());
+        if (result.error)
+        {
+            print_error(result.error);
+        }
+        else
+        {
+            out << "Cloned into " << directory.string() << ", on branch " << result.branch << ".\n";
+            print_transfer(result);
+        }
+    }
+
+    else if (command == "fetch")
+    {
+        if (argc != 3)
+        {
+            out << "Usage: minigit fetch <repository>";
+            return 1;
+        }
+
+        TransferResult result = repository.fetch(argv[2]);
+        if (result.error)
+        {
+            print_error(result.error);
+        }
+        print_transfer(result);
+    }
+
+    else if (command == "push")
+    {
+        if (argc != 3 && argc != 4)
+        {
+            out << "Usage: minigit push <repository> [<branch>]";
+            return 1;
+        }
+
+        TransferResult result = repository.push(argv[2], argc == 4 ? argv[3] : "");
+        if (result.error)
+        {
+            print_error(result.error);
+        }
+        print_transfer(result);
+    }
+
+    else if (command == "worktree")
+    {
+        std::string subcommand = argc > 2 ? argv[2] : "";
+        if (!(subcommand == "add" && argc == 5) && !(subcommand == "list" && argc == 3) && 
+                !(subcommand == "prune" && argc == 3))
+        {
+            out << "Usage: minigit worktree (add <path> <branch> | list | prune)";
+            return 1;
+        }
+
+        WorktreeResult result;
+        if (subcommand == "add")
+        {
+            result = repository.add_worktree(argv[3], argv[4]);
+        }
+        else if (subcommand == "prune")
+        {
+            result = repository.prune_worktrees();
+        }
+        else
+        {
+            result = repository.list_worktrees();
+        }
+
+        if (result.error)
+        {
+            print_error(result.error);
+        }
+        else if (subcommand == "add")
+        {
+            out << "Created working tree " << argv[3] << " on branch " << argv[4] << ".\n";
+        }
+        else if (subcommand == "prune")
+        {
+            out << "Pruned " << result.pruned << " working trees.\n";
+        }
+        else
+        {
+            for (auto const& worktree : result.worktrees)
+            {
+                out << worktree.path.string() << ' ' << (worktree.prunable ? "prunable" : "[" + worktree.branch + "]") << '\n';
+            }
+        }
+    }
+
+    else if (command == "alternates")
+    {
+        std::string subcommand = argc > 2 ? argv[2] : "";
+        if (!(subcommand == "list" && argc == 3) && !(subcommand == "add" && argc == 4))
+        {
+            out << "Usage: minigit alternates (add <path> | list)";
+            return 1;
+        }
+
+        AlternatesResult result = subcommand == "add" ? repository.add_alternate(argv[3]) : repository.list_alternates();
+        if (result.error)
+        {
+            print_error(result.error);
+        }
+        else if (subcommand == "list")
+        {
+            for (auto const& alternate : result.alternates)
+            {
+                out << alternate.string() << '\n';
+            }
+        }
     }
-    else 
+    else
     {
-        std::cout << "Unknown command: " << command << "\n";
-        std::cout << "Available commands: init, add, commit, status, log, revert, branch, checkout, merge\n";
+        out << "Unknown command: " << command << "\n";
+        out << "Available commands: init, add, commit, status, log, show, blame, grep, revert, branch, checkout, merge, count-objects, gc, fsck, sparse-checkout, alternates, clone, fetch, push, worktree\n";
         return 1;
     }
 
     return 0;
-}
\ No newline at end of file
+}
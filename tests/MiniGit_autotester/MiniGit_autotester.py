@@ -3,6 +3,7 @@ import subprocess
 import shutil
 import os
 import json
+import random
 import time
 
 def remove_repository():
@@ -26,6 +27,16 @@ def minigit_run(*args):
     return result
 
 
+def minigit_run_in(directory, *args):
+    result = subprocess.run(
+        [os.path.abspath("../../../build/MiniGit"), *args],
+        capture_output=True,
+        text=True,
+        cwd=directory
+    )
+    return result
+
+
 class Initialization(unittest.TestCase):
 
     def setUp(self):
@@ -56,6 +67,36 @@ class Initialization(unittest.TestCase):
         result = minigit_run("log")
         self.assertEqual(result.stdout, "")
 
+    def test_init_object_format(self):
+        minigit_run("init", "--object-format=sha256")
+        with open(".minigit/config.json", "r") as file:
+            self.assertEqual(json.load(file)["object_format"], "sha256")
+        with open("file1.txt", "w") as file:
+            file.write("Some text")
+        minigit_run("add", "file1.txt")
+        minigit_run("commit", "-m", "First commit")
+        result = minigit_run("status")
+        self.assertRegex(result.stdout, "Nothing to commit, working tree clean.")
+        result = minigit_run("log")
+        self.assertRegex(result.stdout, "commit [0-9a-f]{64}\nAuthor: Author\n")
+        with open(".minigit/refs/heads/master", "r") as file:
+            commit_id_1 = file.read()
+        self.assertEqual(len(commit_id_1), 64)
+        with open("file1.txt", "w") as file:
+            file.write("Changed the text")
+        minigit_run("add", "file1.txt")
+        minigit_run("commit", "-m", "Second commit")
+        result = minigit_run("revert", commit_id_1[:7])
+        self.assertEqual(result.stdout, "")
+        with open("file1.txt", "r") as file:
+            self.assertEqual(file.read(), "Some text")
+        os.remove("file1.txt")
+
+    def test_init_invalid_object_format(self):
+        result = minigit_run("init", "--object-format=md5")
+        self.assertRegex(result.stdout, "Usage: minigit init")
+        self.assertFalse(os.path.exists(".minigit"))
+
 
 class Status(unittest.TestCase):
 
@@ -113,6 +154,44 @@ class Status(unittest.TestCase):
         result = minigit_run("status")
         self.assertNotRegex(result.stdout, "Changes to be committed")
 
+    def test_deleted_files(self):
+        for filename in ["file1.txt", "file2.txt"]:
+            with open(filename, "w") as file:
+                file.write("Some text")
+        minigit_run("add", "file1.txt", "file2.txt")
+        minigit_run("commit", "-m", "Added file1.txt and file2.txt")
+        os.remove("file1.txt")
+        result = minigit_run("status")
+        self.assertRegex(result.stdout, "Deleted files:\n\tfile1.txt")
+        self.assertNotRegex(result.stdout, "Nothing to commit")
+        result = minigit_run("status", "--porcelain")
+        self.assertEqual(result.stdout, "# branch master\n"
+                                        " D file1.txt\n")
+
+    def test_untracked_cache(self):
+        for filename in ["file1.txt", "file2.txt"]:
+            with open(filename, "w") as file:
+                file.write("Some text")
+        minigit_run("add", "file1.txt")
+        # The listing is only cached once the directory has not changed for a while
+        an_hour_ago = time.time() - 3600
+        os.utime(".", (an_hour_ago, an_hour_ago))
+        result = minigit_run("status")
+        self.assertRegex(result.stdout, "Untracked files:\n\tfile2.txt\n$")
+        self.assertTrue(os.path.exists(".minigit/untracked-cache"))
+        result = minigit_run("status")
+        self.assertRegex(result.stdout, "Changes to be committed:\n\tfile1.txt\nUntracked files:\n\tfile2.txt\n$")
+        # Creating or deleting a file changes the directory, so the cached listing is not used
+        with open("file3.txt", "w") as file:
+            file.write("Some text")
+        result = minigit_run("status")
+        self.assertRegex(result.stdout, "Untracked files:\n\tfile2.txt\n\tfile3.txt\n$")
+        os.remove("file2.txt")
+        os.utime(".", (an_hour_ago, an_hour_ago))
+        minigit_run("status")
+        result = minigit_run("status")
+        self.assertRegex(result.stdout, "Untracked files:\n\tfile3.txt\n$")
+
 
 class Staging(unittest.TestCase):
 
@@ -153,6 +232,22 @@ class Staging(unittest.TestCase):
         self.assertEqual(content, "Some text")
         f1_copy.close()
 
+    def test_add_many_files(self):
+        filenames = ["many" + str(i) + ".txt" for i in range(40)]
+        for filename in filenames:
+            with open(filename, "w") as file:
+                file.write("Text of " + filename)
+        try:
+            minigit_run("add", *filenames, filenames[0])
+            with open(".minigit/index.json", "r") as file:
+                data = json.load(file)
+            for filename in filenames:
+                with open(".minigit/objects/blobs/" + data["tracked_files"][filename], "r") as blob:
+                    self.assertEqual(blob.read(), "Text of " + filename)
+        finally:
+            for filename in filenames:
+                os.remove(filename)
+
 
 class Commit(unittest.TestCase):
 
@@ -309,6 +404,188 @@ class Log(unittest.TestCase):
         self.assertRegex(result.stdout,
                          "\"Added a line in file1.txt\"\n\ncommit.*\nAuthor:.*\nDate:.*\n\n\"Created file1.txt\"")
 
+    def test_log_abbrev(self):
+        with open("file1.txt", "w") as file:
+            file.write("Some text")
+        minigit_run("add", "file1.txt")
+        minigit_run("commit", "-m", "Created file1.txt")
+        with open(".minigit/refs/heads/master", "r") as file:
+            commit_id = file.read()
+        result = minigit_run("log", "--abbrev")
+        self.assertRegex(result.stdout, "^commit " + commit_id[:7] + "\n")
+        result = minigit_run("log", "--abbrev=10")
+        self.assertRegex(result.stdout, "^commit " + commit_id[:10] + "\n")
+
+    def test_log_path(self):
+        for filename, message in [("file1.txt", "Created file1.txt"), ("file2.txt", "Created file2.txt"),
+                                  ("file1.txt", "Changed file1.txt")]:
+            time.sleep(0.01)
+            with open(filename, "a") as file:
+                file.write("Some text")
+            minigit_run("add", filename)
+            minigit_run("commit", "-m", message)
+        result = minigit_run("log", "--", "file1.txt")
+        self.assertRegex(result.stdout, "Changed file1.txt\n\ncommit.*\nAuthor:.*\nDate:.*\n\nCreated file1.txt")
+        self.assertNotIn("file2.txt", result.stdout)
+        result = minigit_run("log", "--", "file3.txt")
+        self.assertEqual(result.stdout, "")
+        # Commits without a recorded filter are still found
+        os.remove(".minigit/objects/changed-paths")
+        result = minigit_run("log", "--", "file2.txt")
+        self.assertRegex(result.stdout, "Created file2.txt")
+        self.assertNotIn("file1.txt", result.stdout)
+
+    def test_log_stat(self):
+        with open("file1.txt", "w") as file:
+            file.write("line 1\nline 2\nline 3\n")
+        minigit_run("add", "file1.txt")
+        minigit_run("commit", "-m", "Created file1.txt")
+        time.sleep(0.01)
+        with open("file1.txt", "w") as file:
+            file.write("line 1\nchanged\nline 3\nline 4\n")
+        with open("file2.txt", "w") as file:
+            file.write("text\n")
+        minigit_run("add", "file1.txt", "file2.txt")
+        minigit_run("commit", "-m", "Changed file1.txt")
+        result = minigit_run("log", "--stat")
+        self.assertRegex(result.stdout, "Changed file1.txt\n\n file1.txt \\| \\+2 -1\n file2.txt \\| \\+1 -0\n"
+                                        " 2 files changed, 3 insertions\\(\\+\\), 1 deletions\\(-\\)\n")
+        self.assertRegex(result.stdout, "Created file1.txt\n\n file1.txt \\| \\+3 -0\n 1 file changed")
+        result = minigit_run("log", "--stat", "--porcelain")
+        self.assertRegex(result.stdout, "\tChanged file1.txt\n2\t1\tfile1.txt\n1\t0\tfile2.txt\n")
+
+
+class Show(unittest.TestCase):
+
+    def setUp(self):
+        remove_repository()
+        minigit_run("init")
+
+    def tearDown(self):
+        remove_files()
+        remove_repository()
+
+    def test_incorrect_usage(self):
+        result = minigit_run("show")
+        self.assertRegex(result.stdout, "Usage: minigit show")
+
+    def test_invalid_commit_id(self):
+        result = minigit_run("show", "0123456789")
+        self.assertRegex(result.stdout, "ERROR: commit id is not valid")
+
+    def test_show(self):
+        with open("file1.txt", "w") as file:
+            file.write("line 1\nline 2\n")
+        minigit_run("add", "file1.txt")
+        minigit_run("commit", "-m", "Created file1.txt")
+        time.sleep(0.01)
+        with open("file1.txt", "w") as file:
+            file.write("line 1\n")
+        minigit_run("add", "file1.txt")
+        minigit_run("commit", "-m", "Shortened file1.txt")
+        commit_id = minigit_run("log", "--porcelain").stdout.split("\t")[0]
+        result = minigit_run("show", commit_id[:8])
+        self.assertRegex(result.stdout, "^commit " + commit_id + "\nAuthor:.*\nDate:.*\n\nShortened file1.txt\n\n"
+                                        " file1.txt \\| \\+0 -1\n 1 file changed, 0 insertions\\(\\+\\), 1 deletions\\(-\\)\n")
+
+
+class Blame(unittest.TestCase):
+
+    def setUp(self):
+        remove_repository()
+        minigit_run("init")
+
+    def tearDown(self):
+        remove_files()
+        remove_repository()
+
+    def commit_file(self, content, message):
+        time.sleep(0.01)
+        with open("file1.txt", "w") as file:
+            file.write(content)
+        minigit_run("add", "file1.txt")
+        minigit_run("commit", "-m", message)
+        return minigit_run("log", "--porcelain").stdout.split("\t")[0]
+
+    def test_incorrect_usage(self):
+        result = minigit_run("blame")
+        self.assertRegex(result.stdout, "Usage: minigit blame")
+
+    def test_path_not_found(self):
+        self.commit_file("line 1\n", "Created file1.txt")
+        result = minigit_run("blame", "file2.txt")
+        self.assertRegex(result.stdout, "ERROR: no such path file2.txt in HEAD.")
+
+    def test_blame(self):
+        commit_1 = self.commit_file("line 1\nline 2\nline 3\n", "Created file1.txt")
+        commit_2 = self.commit_file("line 1\nchanged\nline 3\nline 4\n", "Changed file1.txt")
+        result = minigit_run("blame", "file1.txt")
+        origins = [line.split("\t")[0] for line in minigit_run("blame", "--porcelain", "file1.txt").stdout.splitlines()]
+        self.assertEqual(origins, [commit_1, commit_2, commit_1, commit_2])
+        self.assertRegex(result.stdout, "^" + commit_1[:8] + " \\(Author .* 1\\) line 1\n" + commit_2[:8] + " \\(Author .* 2\\) changed\n")
+
+    def test_blame_uses_cache(self):
+        commit_1 = self.commit_file("line 1\nline 2\n", "Created file1.txt")
+        commit_2 = self.commit_file("line 1\nline 2\nline 3\n", "Changed file1.txt")
+        minigit_run("blame", "file1.txt")
+        self.assertTrue(os.listdir(".minigit/blame-cache"))
+        commit_3 = self.commit_file("line 0\nline 1\nline 2\nline 3\n", "Changed file1.txt again")
+        origins = [line.split("\t")[0] for line in minigit_run("blame", "--porcelain", "file1.txt").stdout.splitlines()]
+        self.assertEqual(origins, [commit_3, commit_1, commit_1, commit_2])
+
+
+class Grep(unittest.TestCase):
+
+    def setUp(self):
+        remove_repository()
+        minigit_run("init")
+        with open("file1.txt", "w") as file:
+            file.write("hello world\nfoo bar\nhello there\n")
+        with open("file2.txt", "w") as file:
+            file.write("nothing\nfoo\n")
+        minigit_run("add", "file1.txt", "file2.txt")
+        minigit_run("commit", "-m", "Created files")
+
+    def tearDown(self):
+        remove_files()
+        remove_repository()
+
+    def test_incorrect_usage(self):
+        result = minigit_run("grep")
+        self.assertRegex(result.stdout, "Usage: minigit grep")
+
+    def test_invalid_pattern(self):
+        result = minigit_run("grep", "(foo")
+        self.assertRegex(result.stdout, "ERROR: invalid pattern: \\(foo")
+
+    def test_grep_working_tree(self):
+        with open("file1.txt", "w") as file:
+            file.write("changed foo\n")
+        result = minigit_run("grep", "foo")
+        self.assertEqual(result.stdout, "file1.txt:1:changed foo\nfile2.txt:2:foo\n")
+        result = minigit_run("grep", "^fo+$", "--porcelain")
+        self.assertEqual(result.stdout, "file2.txt\t2\tfoo\n")
+
+    def test_grep_commit(self):
+        commit_id = minigit_run("log", "--porcelain").stdout.split("\t")[0]
+        os.remove("file1.txt")
+        result = minigit_run("grep", "hel+o (world|there)", commit_id[:8])
+        self.assertEqual(result.stdout, commit_id[:8] + ":file1.txt:1:hello world\n" +
+                                        commit_id[:8] + ":file1.txt:3:hello there\n")
+        result = minigit_run("grep", "foo", "0123456789")
+        self.assertRegex(result.stdout, "ERROR: commit id is not valid")
+
+    def test_grep_escapes(self):
+        with open("file1.txt", "w") as file:
+            file.write("hello A world\n")
+        # Escapes spelled with letters and digits do not match those letters and digits literally
+        result = minigit_run("grep", "\\x41 w")
+        self.assertEqual(result.stdout, "file1.txt:1:hello A world\n")
+        result = minigit_run("grep", "o \\u0041")
+        self.assertEqual(result.stdout, "file1.txt:1:hello A world\n")
+        result = minigit_run("grep", "\\x30")
+        self.assertEqual(result.stdout, "")
+
 
 class Branch(unittest.TestCase):
 
@@ -553,6 +830,44 @@ class Revert(unittest.TestCase):
         result = minigit_run("revert", commit_id_1)
         self.assertRegex(result.stdout, "ERROR: commit id is not valid for this branch.")
 
+    def test_revert_to_abbreviated_id(self):
+        with open("file1.txt", "w") as file:
+            file.write("Some text")
+        minigit_run("add", "file1.txt")
+        minigit_run("commit", "-m", "Created file1.txt")
+        with open(".minigit/refs/heads/master", "r") as file:
+            commit_id_1 = file.read()
+        with open("file1.txt", "w") as file:
+            file.write("Changed the text")
+        minigit_run("add", "file1.txt")
+        minigit_run("commit", "-m", "Changed file1.txt")
+        result = minigit_run("revert", commit_id_1[:3])
+        self.assertRegex(result.stdout, "ERROR: commit id is not valid for this branch.")
+        result = minigit_run("revert", commit_id_1[:7])
+        self.assertEqual(result.stdout, "")
+        with open("file1.txt", "r") as file:
+            self.assertEqual(file.read(), "Some text")
+        with open(".minigit/logs/HEAD", "r") as file:
+            head_log_data = json.load(file)
+        self.assertEqual(head_log_data["log"][-1]["message"], "Reverting to " + commit_id_1)
+
+    def test_revert_rebuilds_branch_commit_index(self):
+        with open("file1.txt", "w") as file:
+            file.write("Some text")
+        minigit_run("add", "file1.txt")
+        minigit_run("commit", "-m", "Created file1.txt")
+        with open(".minigit/refs/heads/master", "r") as file:
+            commit_id_1 = file.read()
+        with open("file1.txt", "w") as file:
+            file.write("Changed the text")
+        minigit_run("add", "file1.txt")
+        minigit_run("commit", "-m", "Changed file1.txt")
+        shutil.rmtree(".minigit/branch-commits")
+        result = minigit_run("revert", commit_id_1)
+        self.assertEqual(result.stdout, "")
+        with open("file1.txt", "r") as file:
+            self.assertEqual(file.read(), "Some text")
+
     def test_successful_revert(self):
         f1 = open("file1.txt", "w")
         f1.write("Some text")
@@ -848,6 +1163,32 @@ class Merge(unittest.TestCase):
         self.assertEqual(branch_log_data["log"][-1]["old_commit_id"], head_commit_id_master)
         self.assertEqual(branch_log_data["log"][-1]["message"], "Merged dev_branch_1 into master")
 
+    def test_three_way_auto_merge_keeps_both_changes(self):
+        with open("file1.txt", "w") as file:
+            file.write("line 1\nline 2\nline 3\n")
+        minigit_run("add", "file1.txt")
+        minigit_run("commit", "-m", "Created file1.txt")
+        minigit_run("branch", "dev_branch_1")
+        minigit_run("checkout", "dev_branch_1")
+        time.sleep(0.01)
+        with open("file1.txt", "w") as file:
+            file.write("line 1 changed in dev_branch_1\nline 2\nline 3\n")
+        minigit_run("add", "file1.txt")
+        minigit_run("commit", "-m", "Changed line 1")
+        minigit_run("checkout", "master")
+        time.sleep(0.01)
+        with open("file1.txt", "w") as file:
+            file.write("line 1\nline 2\nline 3 changed in master\n")
+        minigit_run("add", "file1.txt")
+        minigit_run("commit", "-m", "Changed line 3")
+        result = minigit_run("merge", "dev_branch_1")
+        self.assertRegex(result.stdout, "Auto-merge succeeded. Merged dev_branch_1 into master")
+        with open("file1.txt", "r") as file:
+            self.assertEqual(file.read(), "line 1 changed in dev_branch_1\nline 2\nline 3 changed in master\n")
+        # The merged content is what was committed, so the working tree is clean
+        result = minigit_run("status")
+        self.assertRegex(result.stdout, "Nothing to commit, working tree clean.")
+
     def test_three_way_auto_merge_fails(self):
         f1 = open("file1.txt", "w")
         f1.close()
@@ -897,5 +1238,571 @@ class Merge(unittest.TestCase):
         self.assertEqual(branch_log_data["log"][-1]["message"], "Fixed merge conflict in file1.txt")
 
 
+class CountObjects(unittest.TestCase):
+
+    def setUp(self):
+        remove_repository()
+        minigit_run("init")
+
+    def tearDown(self):
+        remove_files()
+        remove_repository()
+
+    def test_repo_not_initialized(self):
+        remove_repository()
+        result = minigit_run("count-objects")
+        self.assertRegex(result.stdout, "Error: Repository not initialized.")
+
+    def test_empty_repository(self):
+        result = minigit_run("count-objects")
+        self.assertRegex(result.stdout, "blobs: 0\n")
+        self.assertRegex(result.stdout, "commits: 0\n")
+        self.assertRegex(result.stdout, "index entries: 0\n")
+
+    def test_count_objects(self):
+        with open("file1.txt", "w") as file:
+            file.write("Some text")
+        minigit_run("add", "file1.txt")
+        minigit_run("commit", "-m", "Created file1.txt")
+        time.sleep(0.01)
+        # Staging a second version and then a third leaves the second blob unreachable
+        with open("file1.txt", "w") as file:
+            file.write("Changed the text")
+        minigit_run("add", "file1.txt")
+        time.sleep(0.01)
+        with open("file1.txt", "w") as file:
+            file.write("Changed the text again")
+        minigit_run("add", "file1.txt")
+        result = minigit_run("count-objects")
+        self.assertRegex(result.stdout, "blobs: 3\n")
+        self.assertRegex(result.stdout, "blobs size: 47 bytes\n")
+        self.assertRegex(result.stdout, "largest blob size: 22 bytes\n")
+        self.assertRegex(result.stdout, "unreachable blobs: 1\n")
+        self.assertRegex(result.stdout, "commits: 1\n")
+        self.assertRegex(result.stdout, "unreachable commits: 0\n")
+        self.assertRegex(result.stdout, "log files: 2\n")
+        self.assertRegex(result.stdout, "index entries: 1\n")
+
+
+class LargeFiles(unittest.TestCase):
+
+    def setUp(self):
+        remove_repository()
+        minigit_run("init")
+
+    def tearDown(self):
+        remove_files()
+        remove_repository()
+
+    def count_chunks(self):
+        result = minigit_run("count-objects")
+        return int(result.stdout.split("chunks: ")[1].split("\n")[0])
+
+    def test_large_file_is_chunked(self):
+        content = random.Random(1).randbytes(2 * 1024 * 1024)
+        with open("file1.txt", "wb") as file:
+            file.write(content)
+        minigit_run("add", "file1.txt")
+        minigit_run("commit", "-m", "Created file1.txt")
+        commit_id = minigit_run("log", "--porcelain").stdout.split("\t")[0]
+        chunks = self.count_chunks()
+        self.assertGreater(chunks, 1)
+        # An edit in the middle only adds the chunks around it
+        time.sleep(0.01)
+        changed = content[:1000000] + b"changed" + content[1000007:]
+        with open("file1.txt", "wb") as file:
+            file.write(changed)
+        minigit_run("add", "file1.txt")
+        minigit_run("commit", "-m", "Changed file1.txt")
+        self.assertLessEqual(self.count_chunks(), chunks + 2)
+        minigit_run("revert", commit_id)
+        with open("file1.txt", "rb") as file:
+            self.assertEqual(file.read(), content)
+        result = minigit_run("status")
+        self.assertRegex(result.stdout, "Nothing to commit, working tree clean.")
+
+    def test_small_file_with_chunk_list_header(self):
+        # Laid out like a chunk list with one chunk, but it is only the content of a small file
+        content = b"MGCL" + (1).to_bytes(4, "big") + (7).to_bytes(8, "big") + (1).to_bytes(4, "big") + \
+            b"\x01" * 20 + (7).to_bytes(4, "big")
+        with open("file1.txt", "wb") as file:
+            file.write(content)
+        minigit_run("add", "file1.txt")
+        minigit_run("commit", "-m", "Created file1.txt")
+        minigit_run("branch", "dev_branch_1")
+        time.sleep(0.01)
+        with open("file1.txt", "wb") as file:
+            file.write(b"Other content")
+        minigit_run("add", "file1.txt")
+        minigit_run("commit", "-m", "Changed file1.txt")
+        result = minigit_run("checkout", "dev_branch_1")
+        self.assertEqual(result.returncode, 0)
+        with open("file1.txt", "rb") as file:
+            self.assertEqual(file.read(), content)
+        minigit_run("checkout", "master")
+        with open("file1.txt", "rb") as file:
+            self.assertEqual(file.read(), b"Other content")
+        result = minigit_run("fsck")
+        self.assertRegex(result.stdout, "No problems found.\n$")
+
+
+class GarbageCollection(unittest.TestCase):
+
+    def setUp(self):
+        remove_repository()
+        minigit_run("init")
+
+    def tearDown(self):
+        remove_files()
+        remove_repository()
+
+    def test_incorrect_usage(self):
+        result = minigit_run("gc", "--prune=soon")
+        self.assertRegex(result.stdout, "Usage: minigit gc \\[--prune=<seconds>\\|--prune=now\\]")
+
+    def test_repo_not_initialized(self):
+        remove_repository()
+        result = minigit_run("gc")
+        self.assertRegex(result.stdout, "Error: Repository not initialized.")
+
+    def test_gc_removes_unreachable_blobs(self):
+        with open("file1.txt", "w") as file:
+            file.write("Some text")
+        minigit_run("add", "file1.txt")
+        minigit_run("commit", "-m", "Created file1.txt")
+        time.sleep(0.01)
+        with open("file1.txt", "w") as file:
+            file.write("Changed the text")
+        minigit_run("add", "file1.txt")
+        time.sleep(0.01)
+        with open("file1.txt", "w") as file:
+            file.write("Changed the text again")
+        minigit_run("add", "file1.txt")
+        with open(".minigit/index.json", "r") as file:
+            index_data = json.load(file)
+        # Unreachable objects within the grace period are kept
+        result = minigit_run("gc")
+        self.assertRegex(result.stdout, "Removed 0 unreachable blobs and 0 unreachable commits")
+        self.assertEqual(len(os.listdir(".minigit/objects/blobs")), 3)
+        result = minigit_run("gc", "--prune=now")
+        self.assertRegex(result.stdout, "Removed 1 unreachable blobs and 0 unreachable commits \\(16 bytes\\).")
+        blobs = set(os.listdir(".minigit/objects/blobs"))
+        self.assertEqual(len(blobs), 2)
+        self.assertTrue(index_data["tracked_files"]["file1.txt"] in blobs)
+        result = minigit_run("status")
+        self.assertRegex(result.stdout, "Changes to be committed:\n\tfile1.txt")
+
+
+class Fsck(unittest.TestCase):
+
+    def setUp(self):
+        remove_repository()
+        minigit_run("init")
+        with open("file1.txt", "w") as file:
+            file.write("Some text")
+        with open("file2.txt", "wb") as file:
+            file.write(random.Random(1).randbytes(2 * 1024 * 1024))
+        minigit_run("add", "file1.txt", "file2.txt")
+        minigit_run("commit", "-m", "Created two files")
+        minigit_run("branch", "dev_branch_1")
+
+    def tearDown(self):
+        remove_files()
+        remove_repository()
+
+    def test_incorrect_usage(self):
+        result = minigit_run("fsck", "--full")
+        self.assertRegex(result.stdout, "Usage: minigit fsck \\[--progress\\]")
+
+    def test_repo_not_initialized(self):
+        remove_repository()
+        result = minigit_run("fsck")
+        self.assertRegex(result.stdout, "Error: Repository not initialized.")
+
+    def test_fsck_intact_repository(self):
+        result = minigit_run("fsck", "--progress")
+        self.assertEqual(result.returncode, 0)
+        self.assertRegex(result.stdout, "Checked 1 commits, 2 blobs and [0-9]+ chunks \\(2097152 bytes hashed\\).\n"
+                                        "No problems found.\n$")
+        self.assertRegex(result.stderr, "Checking objects: 100%")
+
+    def test_fsck_reports_damaged_objects(self):
+        commit_id = os.listdir(".minigit/objects/commits")[0]
+        with open(".minigit/objects/commits/" + commit_id, "r") as file:
+            commit_data = json.load(file)
+        commit_data["message"] = "Changed message"
+        with open(".minigit/objects/commits/" + commit_id, "w") as file:
+            json.dump(commit_data, file)
+        blob_id = commit_data["file_hashes"]["file1.txt"]
+        with open(".minigit/objects/blobs/" + blob_id, "a") as file:
+            file.write(" and more")
+        chunk_id = sorted(os.listdir(".minigit/objects/chunks"))[0]
+        os.remove(".minigit/objects/chunks/" + chunk_id)
+        with open(".minigit/refs/heads/dev_branch_1", "w") as file:
+            file.write("0" * 39 + "1")
+
+        result = minigit_run("fsck")
+        self.assertEqual(result.returncode, 1)
+        self.assertRegex(result.stdout, "blob " + blob_id + ": hash mismatch \\(file1.txt\\)\n")
+        self.assertRegex(result.stdout, "blob [0-9a-f]{40}: missing chunk " + chunk_id + "\n")
+        self.assertRegex(result.stdout, "commit " + commit_id + ": hash mismatch\n")
+        self.assertRegex(result.stdout, "ref .minigit/refs/heads/dev_branch_1: missing commit 0+1\n")
+        self.assertRegex(result.stdout, "5 problems found.\n$")
+
+    def test_fsck_reports_missing_blobs(self):
+        with open(".minigit/index.json", "r") as file:
+            blob_id = json.load(file)["tracked_files"]["file1.txt"]
+        os.remove(".minigit/objects/blobs/" + blob_id)
+        result = minigit_run("fsck")
+        self.assertEqual(result.returncode, 1)
+        self.assertRegex(result.stdout, "commit [0-9a-f]{40}: missing blob " + blob_id + " \\(file1.txt\\)\n")
+        self.assertRegex(result.stdout, "index .minigit/index.json: missing blob " + blob_id + " \\(file1.txt\\)\n")
+
+
+class Porcelain(unittest.TestCase):
+
+    def setUp(self):
+        remove_repository()
+        minigit_run("init")
+
+    def tearDown(self):
+        remove_files()
+        remove_repository()
+
+    def test_status_porcelain(self):
+        for filename in ["file1.txt", "file2.txt", "file3.txt"]:
+            with open(filename, "w") as file:
+                file.write("Some text")
+        minigit_run("add", "file1.txt", "file2.txt")
+        minigit_run("commit", "-m", "Created file1.txt and file2.txt")
+        time.sleep(0.01)
+        with open("file1.txt", "w") as file:
+            file.write("Changed the text")
+        minigit_run("add", "file1.txt")
+        time.sleep(0.01)
+        with open("file1.txt", "w") as file:
+            file.write("Changed the text again")
+        with open("file2.txt", "w") as file:
+            file.write("Changed the text")
+        result = minigit_run("status", "--porcelain")
+        self.assertEqual(result.stdout, "# branch master\n"
+                                        "MM file1.txt\n"
+                                        " M file2.txt\n"
+                                        "?? file3.txt\n")
+        result = minigit_run("status", "-z")
+        self.assertEqual(result.stdout, "# branch master\0"
+                                        "MM file1.txt\0"
+                                        " M file2.txt\0"
+                                        "?? file3.txt\0")
+
+    def test_commit_and_log_porcelain(self):
+        with open("file1.txt", "w") as file:
+            file.write("Some text")
+        minigit_run("add", "file1.txt")
+        result = minigit_run("commit", "--porcelain", "-m", "Created file1.txt")
+        with open(".minigit/refs/heads/master", "r") as file:
+            commit_id = file.read()
+        self.assertEqual(result.stdout, commit_id + "\nfile1.txt\n")
+        result = minigit_run("log", "-z")
+        fields = result.stdout.split("\0")[0].split("\t")
+        self.assertEqual(fields[0], commit_id)
+        self.assertEqual(fields[2], "")
+        self.assertEqual(fields[3], "Author")
+        self.assertEqual(fields[5], "Created file1.txt")
+
+    def test_branch_porcelain(self):
+        with open("file1.txt", "w") as file:
+            file.write("Some text")
+        minigit_run("add", "file1.txt")
+        minigit_run("commit", "-m", "Created file1.txt")
+        minigit_run("branch", "dev_branch_1")
+        result = minigit_run("branch", "-z")
+        self.assertEqual(result.stdout, "dev_branch_1\0master\0")
+
+
+
+class SparseCheckout(unittest.TestCase):
+
+    def setUp(self):
+        remove_repository()
+        minigit_run("init")
+        for filename in ["file1.txt", "file2.txt", "file3.txt"]:
+            with open(filename, "w") as file:
+                file.write("Some text in " + filename)
+        minigit_run("add", "file1.txt", "file2.txt", "file3.txt")
+        minigit_run("commit", "-m", "Created three files")
+
+    def tearDown(self):
+        remove_files()
+        remove_repository()
+
+    def test_incorrect_usage(self):
+        result = minigit_run("sparse-checkout", "set")
+        self.assertRegex(result.stdout, "Usage: minigit sparse-checkout")
+
+    def test_set_list_and_disable(self):
+        result = minigit_run("sparse-checkout", "set", "file1.*", "file3.txt")
+        self.assertEqual(result.stdout, "")
+        self.assertTrue(os.path.exists("file1.txt"))
+        self.assertFalse(os.path.exists("file2.txt"))
+        self.assertTrue(os.path.exists("file3.txt"))
+        result = minigit_run("sparse-checkout", "list")
+        self.assertEqual(result.stdout, "file1.*\nfile3.txt\n")
+        # Excluded files are still tracked but not reported as deleted
+        result = minigit_run("status")
+        self.assertRegex(result.stdout, "Nothing to commit, working tree clean.")
+        minigit_run("sparse-checkout", "disable")
+        with open("file2.txt", "r") as file:
+            self.assertEqual(file.read(), "Some text in file2.txt")
+        result = minigit_run("sparse-checkout", "list")
+        self.assertEqual(result.stdout, "")
+
+    def test_checkout_writes_only_included_files(self):
+        minigit_run("branch", "dev_branch_1")
+        minigit_run("checkout", "dev_branch_1")
+        time.sleep(0.01)
+        with open("file1.txt", "w") as file:
+            file.write("Changed in dev_branch_1")
+        with open("file2.txt", "w") as file:
+            file.write("Changed in dev_branch_1")
+        minigit_run("add", "file1.txt", "file2.txt")
+        minigit_run("commit", "-m", "Changed file1.txt and file2.txt")
+        minigit_run("checkout", "master")
+        minigit_run("sparse-checkout", "set", "*", "!file2.txt")
+        self.assertFalse(os.path.exists("file2.txt"))
+        minigit_run("checkout", "dev_branch_1")
+        self.assertFalse(os.path.exists("file2.txt"))
+        with open("file1.txt", "r") as file:
+            self.assertEqual(file.read(), "Changed in dev_branch_1")
+        # The index still tracks the full tree
+        with open(".minigit/index.json", "r") as file:
+            self.assertIn("file2.txt", json.load(file)["tracked_files"])
+
+
+class Alternates(unittest.TestCase):
+
+    def setUp(self):
+        remove_repository()
+        minigit_run("init")
+        with open("file1.txt", "w") as file:
+            file.write("Some text in file1.txt")
+        minigit_run("add", "file1.txt")
+        minigit_run("commit", "-m", "Created file1.txt")
+        # Keep the objects as a shared directory and start over with an empty repository
+        shutil.copytree(".minigit/objects", "shared_objects")
+        remove_repository()
+        minigit_run("init")
+
+    def tearDown(self):
+        remove_files()
+        remove_repository()
+        shutil.rmtree("shared_objects", ignore_errors=True)
+
+    def test_incorrect_usage(self):
+        result = minigit_run("alternates", "add")
+        self.assertRegex(result.stdout, "Usage: minigit alternates")
+        result = minigit_run("alternates", "add", "missing_directory")
+        self.assertRegex(result.stdout, "is not an object directory")
+
+    def test_add_and_list(self):
+        result = minigit_run("alternates", "add", "shared_objects")
+        self.assertEqual(result.stdout, "")
+        result = minigit_run("alternates", "list")
+        self.assertEqual(result.stdout, os.path.realpath("shared_objects") + "\n")
+
+    def test_objects_are_read_from_alternate(self):
+        minigit_run("alternates", "add", "shared_objects")
+        minigit_run("add", "file1.txt")
+        minigit_run("commit", "-m", "Created file1.txt")
+        # The blob already exists in the shared directory
+        self.assertEqual(os.listdir(".minigit/objects/blobs"), [])
+        minigit_run("branch", "dev_branch_1")
+        minigit_run("checkout", "dev_branch_1")
+        time.sleep(0.01)
+        with open("file1.txt", "w") as file:
+            file.write("Changed in dev_branch_1")
+        minigit_run("add", "file1.txt")
+        minigit_run("commit", "-m", "Changed file1.txt")
+        self.assertEqual(len(os.listdir(".minigit/objects/blobs")), 1)
+        minigit_run("checkout", "master")
+        with open("file1.txt", "r") as file:
+            self.assertEqual(file.read(), "Some text in file1.txt")
+        result = minigit_run("status")
+        self.assertRegex(result.stdout, "Nothing to commit, working tree clean.")
+
+
+class CloneFetchPush(unittest.TestCase):
+
+    def setUp(self):
+        remove_repository()
+        shutil.rmtree("origin", ignore_errors=True)
+        shutil.rmtree("mirror", ignore_errors=True)
+        shutil.rmtree("mirror_sha1", ignore_errors=True)
+        os.mkdir("origin")
+        minigit_run_in("origin", "init")
+        for filename in ["file1.txt", "file2.txt"]:
+            with open(os.path.join("origin", filename), "w") as file:
+                file.write("Some text in " + filename)
+        minigit_run_in("origin", "add", "file1.txt", "file2.txt")
+        minigit_run_in("origin", "commit", "-m", "Created two files")
+        minigit_run_in("origin", "branch", "dev_branch_1")
+
+    def tearDown(self):
+        shutil.rmtree("origin", ignore_errors=True)
+        shutil.rmtree("mirror", ignore_errors=True)
+        shutil.rmtree("mirror_sha1", ignore_errors=True)
+
+    def commit_change(self, directory, filename, text, message):
+        time.sleep(0.01)
+        with open(os.path.join(directory, filename), "a") as file:
+            file.write(text)
+        minigit_run_in(directory, "add", filename)
+        minigit_run_in(directory, "commit", "-m", message)
+
+    def test_incorrect_usage(self):
+        result = minigit_run("clone")
+        self.assertRegex(result.stdout, "Usage: minigit clone")
+        result = minigit_run("fetch")
+        self.assertRegex(result.stdout, "Usage: minigit fetch")
+        result = minigit_run("clone", "missing_repository", "mirror")
+        self.assertRegex(result.stdout, "is not a MiniGit repository")
+
+    def test_clone(self):
+        result = minigit_run("clone", "origin", "mirror")
+        self.assertRegex(result.stdout, "Cloned into mirror, on branch master.")
+        self.assertRegex(result.stdout, "Transferred 1 commits and 2 blobs")
+        with open("mirror/file1.txt", "r") as file:
+            self.assertEqual(file.read(), "Some text in file1.txt")
+        result = minigit_run_in("mirror", "status")
+        self.assertRegex(result.stdout, "Nothing to commit, working tree clean.")
+        result = minigit_run_in("mirror", "branch")
+        self.assertEqual(result.stdout, "dev_branch_1\nmaster\n")
+        self.assertEqual(minigit_run_in("mirror", "log").stdout, minigit_run_in("origin", "log").stdout)
+
+    def test_fetch_transfers_only_new_objects(self):
+        minigit_run("clone", "origin", "mirror")
+        self.commit_change("origin", "file2.txt", " and more", "Changed file2.txt")
+        result = minigit_run_in("mirror", "fetch", "../origin")
+        self.assertRegex(result.stdout, "Fast-forward master")
+        self.assertRegex(result.stdout, "Transferred 1 commits and 1 blobs")
+        with open("mirror/file2.txt", "r") as file:
+            self.assertEqual(file.read(), "Some text in file2.txt and more")
+        result = minigit_run_in("mirror", "status")
+        self.assertRegex(result.stdout, "Nothing to commit, working tree clean.")
+        result = minigit_run_in("mirror", "fetch", "../origin")
+        self.assertEqual(result.stdout, "")
+
+    def test_fetch_rejects_diverged_branch(self):
+        minigit_run("clone", "origin", "mirror")
+        self.commit_change("origin", "file1.txt", " in origin", "Changed file1.txt in origin")
+        self.commit_change("mirror", "file1.txt", " in mirror", "Changed file1.txt in mirror")
+        result = minigit_run_in("mirror", "fetch", "../origin")
+        self.assertRegex(result.stdout, "Rejected master: not a fast-forward.")
+        with open("mirror/file1.txt", "r") as file:
+            self.assertEqual(file.read(), "Some text in file1.txt in mirror")
+
+    def test_object_format_is_cloned(self):
+        shutil.rmtree("origin")
+        os.mkdir("origin")
+        minigit_run_in("origin", "init", "--object-format=sha256")
+        self.commit_change("origin", "file1.txt", "Some text", "Created file1.txt")
+        minigit_run("clone", "origin", "mirror")
+        with open("mirror/.minigit/config.json", "r") as file:
+            self.assertEqual(json.load(file)["object_format"], "sha256")
+        self.assertEqual(minigit_run_in("mirror", "log").stdout, minigit_run_in("origin", "log").stdout)
+        # Repositories with different object formats cannot exchange objects
+        os.mkdir("mirror_sha1")
+        minigit_run_in("mirror_sha1", "init")
+        result = minigit_run_in("mirror_sha1", "fetch", "../origin")
+        self.assertRegex(result.stdout, "uses a different object format \\(sha256\\)")
+
+    def test_push(self):
+        minigit_run("clone", "origin", "mirror")
+        minigit_run_in("mirror", "checkout", "dev_branch_1")
+        self.commit_change("mirror", "file1.txt", " in mirror", "Changed file1.txt in mirror")
+        result = minigit_run_in("mirror", "push", "../origin")
+        self.assertRegex(result.stdout, "Fast-forward dev_branch_1")
+        self.assertRegex(result.stdout, "Transferred 1 commits and 1 blobs")
+        # The branch checked out in origin is not updated
+        minigit_run_in("mirror", "checkout", "master")
+        self.commit_change("mirror", "file2.txt", " in mirror", "Changed file2.txt in mirror")
+        result = minigit_run_in("mirror", "push", "../origin", "master")
+        self.assertRegex(result.stdout, "Rejected master: branch is checked out")
+        minigit_run_in("origin", "checkout", "dev_branch_1")
+        with open("origin/file1.txt", "r") as file:
+            self.assertEqual(file.read(), "Some text in file1.txt in mirror")
+
+
+class Worktree(unittest.TestCase):
+
+    def setUp(self):
+        remove_repository()
+        shutil.rmtree("linked", ignore_errors=True)
+        minigit_run("init")
+        with open("file1.txt", "w") as file:
+            file.write("Some text in file1.txt")
+        minigit_run("add", "file1.txt")
+        minigit_run("commit", "-m", "Created file1.txt")
+        minigit_run("branch", "dev_branch_1")
+
+    def tearDown(self):
+        remove_files()
+        remove_repository()
+        shutil.rmtree("linked", ignore_errors=True)
+
+    def test_incorrect_usage(self):
+        result = minigit_run("worktree", "add", "linked")
+        self.assertRegex(result.stdout, "Usage: minigit worktree")
+        result = minigit_run("worktree", "add", "linked", "no_such_branch")
+        self.assertRegex(result.stdout, "no such branch: no_such_branch")
+
+    def test_add_and_list(self):
+        result = minigit_run("worktree", "add", "linked", "dev_branch_1")
+        self.assertEqual(result.stdout, "Created working tree linked on branch dev_branch_1.\n")
+        with open("linked/file1.txt", "r") as file:
+            self.assertEqual(file.read(), "Some text in file1.txt")
+        result = minigit_run_in("linked", "status")
+        self.assertRegex(result.stdout, "On branch dev_branch_1")
+        self.assertRegex(result.stdout, "Nothing to commit, working tree clean.")
+        result = minigit_run("worktree", "list")
+        self.assertEqual(result.stdout, os.getcwd() + " [master]\n" + os.path.abspath("linked") + " [dev_branch_1]\n")
+        # Objects are shared, not copied
+        self.assertFalse(os.path.exists("linked/.minigit/objects"))
+
+    def test_branch_checked_out_once(self):
+        minigit_run("worktree", "add", "linked", "dev_branch_1")
+        result = minigit_run("checkout", "dev_branch_1")
+        self.assertRegex(result.stdout, "Branch dev_branch_1 is checked out in another working tree.")
+        result = minigit_run("worktree", "add", "other", "master")
+        self.assertRegex(result.stdout, "Branch master is already checked out")
+        self.assertFalse(os.path.exists("other"))
+
+    def test_commit_in_linked_worktree(self):
+        minigit_run("worktree", "add", "linked", "dev_branch_1")
+        time.sleep(0.01)
+        with open("linked/file1.txt", "a") as file:
+            file.write(" changed in linked")
+        minigit_run_in("linked", "add", "file1.txt")
+        minigit_run_in("linked", "commit", "-m", "Changed file1.txt in linked")
+        # The main working tree keeps its own HEAD and index but sees the new commit
+        result = minigit_run("status")
+        self.assertRegex(result.stdout, "On branch master")
+        self.assertRegex(result.stdout, "Nothing to commit, working tree clean.")
+        result = minigit_run("merge", "dev_branch_1")
+        self.assertRegex(result.stdout, "Fast-forward")
+        with open("file1.txt", "r") as file:
+            self.assertEqual(file.read(), "Some text in file1.txt changed in linked")
+
+    def test_prune(self):
+        minigit_run("worktree", "add", "linked", "dev_branch_1")
+        shutil.rmtree("linked")
+        result = minigit_run("worktree", "list")
+        self.assertRegex(result.stdout, "linked prunable")
+        result = minigit_run("worktree", "prune")
+        self.assertEqual(result.stdout, "Pruned 1 working trees.\n")
+        result = minigit_run("checkout", "dev_branch_1")
+        self.assertEqual(result.stdout, "")
+
+
 if __name__ == '__main__':
     unittest.main()